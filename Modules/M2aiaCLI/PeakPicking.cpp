@@ -19,6 +19,7 @@ See LICENSE.txt or https://www.github.com/jtfcordes/m2aia for details.
 #include <itkImage.h>
 #include <itksys/SystemTools.hxx>
 #include <m2ImzMLSpectrumImage.h>
+#include <m2PeakMatrix.h>
 #include <m2Process.hpp>
 #include <mitkCommandLineParser.h>
 #include <mitkIOUtil.h>
@@ -114,7 +115,6 @@ int main(int argc, char *argv[])
 
     if (auto imzMLImage = dynamic_cast<m2::ImzMLSpectrumImage *>(sImage))
     {
-      const auto &xValues = imzMLImage->GetXAxis();
       int sourceId = 0;
 
       for (auto &source : imzMLImage->GetImzMLSpectrumImageSourceList())
@@ -122,27 +122,20 @@ int main(int argc, char *argv[])
         MITK_INFO << "Start peak picking for " << source.m_Spectra.size() << " spectra...";
         boost::progress_display show_progress(source.m_Spectra.size());
 
-        m2::Process::Map(source.m_Spectra.size(),
-                         threads,
-                         [&](const auto /*tId*/, const auto s, const auto e)
-                         {
-                           std::vector<float> yValues(xValues.size());
-                           std::vector<float> xValues(xValues.size());
-                           for (unsigned int spectrumId = s; spectrumId < e; ++spectrumId)
-                           {
-                             imzMLImage->GetSpectrum(spectrumId, xValues, yValues, sourceId);
-                             source.m_Spectra[spectrumId].peaks =
-                               m2::Signal::PickPeaks(xValues, yValues, SNR, peakpicking_hw, binning_tol, monoisotopick);
-                             ++show_progress;
-                           }
-                         });
+        // buffers are reused for all spectra of a lane
+        std::vector<std::vector<float>> xs(threads), ys(threads);
+        const auto pickPeaks = [&](const auto tId, const auto spectrumId)
+        {
+          imzMLImage->GetSpectrum(spectrumId, xs[tId], ys[tId], sourceId);
+          auto peaks = m2::Signal::PickPeaks(xs[tId], ys[tId], SNR, peakpicking_hw, binning_tol, monoisotopick);
+          ++show_progress;
+          return peaks;
+        };
+        source.m_Spectra.SetPeaks(m2::PeakMatrix::Build(source.m_Spectra.size(), threads, pickPeaks));
         ++sourceId;
 
-        float sumPeaks = 0;
-        for (const auto &p : source.m_Spectra)
-          sumPeaks += p.peaks.size();
-
-        MITK_INFO << "Average number of peaks " << sumPeaks / double(source.m_Spectra.size());
+        const auto &peaks = source.m_Spectra.GetPeaks();
+        MITK_INFO << "Average number of peaks " << peaks.GetNumberOfPeaks() / double(source.m_Spectra.size());
       }
     }
 
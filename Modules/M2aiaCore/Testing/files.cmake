@@ -4,4 +4,21 @@ set(MODULE_TESTS
   m2ImzMLImageIOTest.cpp
   m2CoreMappingsTest.cpp
   m2ElxUtilTest.cpp
+  m2TransposedSpectrumCacheTest.cpp
+  m2SubrangeTest.cpp
+  m2ThreadPoolTest.cpp
+  m2SpectrumMetaDataStoreTest.cpp
+  m2SpectrumReadPlanTest.cpp
+  m2SpectrumCacheTest.cpp
+  m2IonImageCacheTest.cpp
+  m2IonImageRequestSchedulerTest.cpp
+  m2SpectrumProcessingPipelineTest.cpp
+  m2RunningMedianTest.cpp
+  m2ConvolutionTest.cpp
+  m2MorphologyTest.cpp
+  m2PeakMatrixTest.cpp
+  m2BinningTest.cpp
+  m2PeakMatchingTest.cpp
+  m2BinaryDataPrefetcherTest.cpp
+  m2FileStreamPoolTest.cpp
 )
@@ -0,0 +1,85 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cstdio>
+#include <fstream>
+#include <m2BinaryDataPrefetcher.h>
+#include <mitkExceptionMacro.h>
+#include <mitkIOUtil.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <numeric>
+
+class m2BinaryDataPrefetcherTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2BinaryDataPrefetcherTestSuite);
+  MITK_TEST(Next_ReturnsBlocksInPlanOrder);
+  MITK_TEST(Next_BlockBeyondEndOfFile_Throws);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  std::string m_Path;
+  // the value of each byte is its offset modulo 256
+  std::vector<char> m_Data = std::vector<char>(1 << 16);
+
+public:
+  void setUp() override
+  {
+    std::ofstream f;
+    m_Path = mitk::IOUtil::CreateTemporaryFile(f, "m2BinaryDataPrefetcherTest_XXXXXX.ibd");
+    for (std::size_t i = 0; i < m_Data.size(); ++i)
+      m_Data[i] = char(i % 256);
+    f.write(m_Data.data(), m_Data.size());
+    f.close();
+  }
+
+  void tearDown() override { std::remove(m_Path.c_str()); }
+
+  void Next_ReturnsBlocksInPlanOrder()
+  {
+    m2::SpectrumReadPlan plan;
+    for (unsigned int i = 0; i < 64; ++i)
+      plan.Add(i, (63 - i) * 1000, 100);
+    plan.Build(0, 1000);
+    CPPUNIT_ASSERT_EQUAL(size_t(64), plan.GetBlocks().size());
+
+    // a memory limit below two blocks still uses two buffers
+    for (const std::uint64_t memoryLimit : {std::uint64_t(0), std::uint64_t(1000)})
+    {
+      m2::BinaryDataPrefetcher prefetcher(m_Path, plan, memoryLimit);
+      for (const auto &block : plan.GetBlocks())
+      {
+        const auto data = prefetcher.Next();
+        CPPUNIT_ASSERT(std::equal(data, data + block.numberOfBytes, m_Data.data() + block.offset));
+      }
+      CPPUNIT_ASSERT_THROW(prefetcher.Next(), mitk::Exception);
+    }
+  }
+
+  void Next_BlockBeyondEndOfFile_Throws()
+  {
+    m2::SpectrumReadPlan plan;
+    plan.Add(0, 0, 100);
+    plan.Add(1, m_Data.size() - 10, 100);
+    plan.Build(0, 1000);
+
+    m2::BinaryDataPrefetcher prefetcher(m_Path, plan, 1 << 20);
+    CPPUNIT_ASSERT(std::equal(m_Data.data(), m_Data.data() + 100, prefetcher.Next()));
+    CPPUNIT_ASSERT_THROW(prefetcher.Next(), mitk::Exception);
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2BinaryDataPrefetcher)
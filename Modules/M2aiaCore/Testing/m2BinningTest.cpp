@@ -0,0 +1,179 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <m2CoreCommon.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2Binning.h>
+#include <vector>
+
+class m2BinningTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2BinningTestSuite);
+  MITK_TEST(BinPeaks_SplitsAtLargestGap);
+  MITK_TEST(BinPeaks_BinsWithinTolerance);
+  MITK_TEST(PeakBinning_Parallel_EqualsBinPeaks);
+  MITK_TEST(PeakBinning_PeakMatrix_CountsSpectraPerBin);
+  MITK_TEST(BinPeaks_MonotonicGaps_SplitsOffSingleValues);
+  MITK_TEST(PeakBinning_NoSeparatingGaps_EqualsBinPeaks);
+  CPPUNIT_TEST_SUITE_END();
+
+  // peaks of n spectra around 200 features with a jitter of ~10 ppm, sorted by m/z
+  static std::vector<m2::Peak> MakePeaks(unsigned int n, unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> offset(0, 1);
+    std::normal_distribution<double> jitter(0, 10e-6);
+    std::vector<double> features(200);
+    for (unsigned int k = 0; k < features.size(); ++k)
+      features[k] = 100 + 9.5 * k + offset(generator);
+
+    std::vector<m2::Peak> peaks;
+    for (unsigned int i = 0; i < n; ++i)
+      for (auto f : features)
+        peaks.emplace_back(i, f * (1 + jitter(generator)), double(i % 3));
+    std::sort(peaks.begin(), peaks.end());
+    return peaks;
+  }
+
+  static void AssertEqualBins(const std::vector<m2::Peak> &expected, const std::vector<m2::Peak> &bins)
+  {
+    CPPUNIT_ASSERT_EQUAL(expected.size(), bins.size());
+    for (std::size_t i = 0; i < bins.size(); ++i)
+    {
+      CPPUNIT_ASSERT_EQUAL(expected[i].GetCount(), bins[i].GetCount());
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i].GetX(), bins[i].GetX(), 1e-9);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i].GetY(), bins[i].GetY(), 1e-6);
+    }
+  }
+
+  static std::vector<m2::Peak> BinParallel(const std::vector<m2::Peak> &peaks,
+                                           double tolerance,
+                                           bool absoluteDistance,
+                                           unsigned int threads)
+  {
+    std::vector<double> mzs;
+    std::vector<float> intensities;
+    for (const auto &p : peaks)
+    {
+      mzs.push_back(p.GetX());
+      intensities.push_back(p.GetY());
+    }
+    return m2::Signal::PeakBinning(tolerance, absoluteDistance, threads)(mzs.data(), intensities.data(), mzs.size());
+  }
+
+public:
+  void BinPeaks_SplitsAtLargestGap()
+  {
+    // the second and third group are closer than 2 * 5 (no separating gap), but not within 5 of their mean
+    std::vector<m2::Peak> peaks = {
+      {0, 100.0, 1}, {1, 101.0, 1}, {2, 150.0, 1}, {3, 152.0, 3}, {4, 160.0, 1}, {5, 162.0, 1}};
+    std::vector<m2::Peak> bins;
+    m2::Signal::binPeaks(peaks.begin(), peaks.end(), std::back_inserter(bins), 5, true);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), bins.size());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100.5, bins[0].GetX(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(151.0, bins[1].GetX(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, bins[1].GetY(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(3.0, bins[1].GetYMax(), 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(161.0, bins[2].GetX(), 1e-9);
+    CPPUNIT_ASSERT_EQUAL(2u, bins[2].GetCount());
+  }
+
+  void BinPeaks_BinsWithinTolerance()
+  {
+    const auto tolerance = m2::PartPerMillionToFactor(5);
+    const auto peaks = MakePeaks(50, 1);
+    std::vector<m2::Peak> bins;
+    m2::Signal::binPeaks(peaks.begin(), peaks.end(), std::back_inserter(bins), tolerance);
+
+    // each bin is a consecutive range of the sorted peaks with all of them within the tolerance of its mean
+    unsigned int count = 0;
+    auto peak = peaks.begin();
+    for (const auto &bin : bins)
+    {
+      for (unsigned int i = 0; i < bin.GetCount(); ++i, ++peak)
+        CPPUNIT_ASSERT(std::abs(peak->GetX() - bin.GetX()) <= bin.GetX() * tolerance);
+      count += bin.GetCount();
+    }
+    CPPUNIT_ASSERT_EQUAL(unsigned(peaks.size()), count);
+    CPPUNIT_ASSERT(bins.size() >= 200);
+  }
+
+  void PeakBinning_Parallel_EqualsBinPeaks()
+  {
+    const auto tolerance = m2::PartPerMillionToFactor(5);
+    const auto peaks = MakePeaks(100, 2);
+    std::vector<m2::Peak> expected;
+    m2::Signal::binPeaks(peaks.begin(), peaks.end(), std::back_inserter(expected), tolerance);
+
+    for (unsigned int threads : {1u, 4u})
+      AssertEqualBins(expected, BinParallel(peaks, tolerance, false, threads));
+  }
+
+  void PeakBinning_PeakMatrix_CountsSpectraPerBin()
+  {
+    // every spectrum holds the same three peaks, in different order of the spectra
+    std::vector<m2::Peak> peaks = {{0, 150.0, 1}, {1, 400.0, 2}, {2, 900.0, 3}};
+    const auto matrix = m2::PeakMatrix::Build(1000, 4, [&](unsigned int, unsigned int) { return peaks; });
+    const auto bins = m2::Signal::PeakBinning(m2::PartPerMillionToFactor(10), false, 4)(matrix);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), bins.size());
+    for (std::size_t i = 0; i < bins.size(); ++i)
+    {
+      CPPUNIT_ASSERT_EQUAL(1000u, bins[i].GetCount());
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(peaks[i].GetX(), bins[i].GetX(), 1e-3);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(peaks[i].GetY(), bins[i].GetY(), 1e-6);
+    }
+  }
+
+  void BinPeaks_MonotonicGaps_SplitsOffSingleValues()
+  {
+    // no separating gaps and a growing gap at each position: every split only separates the last value
+    const std::size_t n = 1 << 17;
+    std::vector<m2::Peak> peaks;
+    for (std::size_t i = 0; i < n; ++i)
+      peaks.emplace_back(i, i + i * i * 1e-9, 1);
+
+    std::vector<m2::Peak> bins;
+    m2::Signal::binPeaks(peaks.begin(), peaks.end(), std::back_inserter(bins), 1, true);
+    CPPUNIT_ASSERT_EQUAL(n - 1, bins.size());
+    CPPUNIT_ASSERT_EQUAL(2u, bins.front().GetCount());
+    CPPUNIT_ASSERT_EQUAL(1u, bins.back().GetCount());
+    AssertEqualBins(bins, BinParallel(peaks, 1, true, 4));
+  }
+
+  void PeakBinning_NoSeparatingGaps_EqualsBinPeaks()
+  {
+    // gaps in [0.005, 0.015) never exceed 2 * tolerance, so all peaks form a single segment
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> gap(0.005, 0.015);
+    std::vector<m2::Peak> peaks;
+    double mz = 100;
+    for (unsigned int i = 0; i < 200000; ++i, mz += gap(generator))
+      peaks.emplace_back(i, mz, double(i % 5));
+
+    std::vector<m2::Peak> expected;
+    m2::Signal::binPeaks(peaks.begin(), peaks.end(), std::back_inserter(expected), 0.05, true);
+    CPPUNIT_ASSERT(expected.size() > 1000);
+    for (unsigned int threads : {1u, 4u})
+      AssertEqualBins(expected, BinParallel(peaks, 0.05, true, threads));
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2Binning)
@@ -0,0 +1,76 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2Convolution.h>
+#include <vector>
+
+class m2ConvolutionTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2ConvolutionTestSuite);
+  MITK_TEST(Apply_Float_EqualsExtendedSignalConvolution);
+  MITK_TEST(Apply_Double_EqualsExtendedSignalConvolution);
+  CPPUNIT_TEST_SUITE_END();
+
+  template <class T>
+  void CheckEqualsExtendedSignalConvolution()
+  {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(-1, 1);
+
+    for (unsigned int hws : {1u, 3u, 25u})
+    {
+      std::vector<double> kernel(2 * hws + 1);
+      for (auto &k : kernel)
+        k = distribution(generator);
+      const m2::Signal::Convolution<T> convolution(kernel);
+
+      // shorter than the kernel, around the tile size and longer than several tiles
+      for (std::size_t n :
+           {std::size_t(1), std::size_t(hws), std::size_t(2 * hws + 1), std::size_t(513), std::size_t(3000)})
+      {
+        std::vector<T> signal(n), output(n);
+        for (auto &v : signal)
+          v = distribution(generator);
+
+        // reference: the signal extended by its border values
+        std::vector<double> extended(hws, signal.front());
+        extended.insert(extended.end(), signal.begin(), signal.end());
+        extended.insert(extended.end(), hws, signal.back());
+
+        convolution(signal.data(), output.data(), n);
+        for (std::size_t j = 0; j < n; ++j)
+        {
+          double expected = 0;
+          for (std::size_t i = 0; i < kernel.size(); ++i)
+            expected += T(kernel[i]) * extended[j + i];
+          CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, output[j], 1e-4);
+        }
+      }
+    }
+  }
+
+public:
+  void Apply_Float_EqualsExtendedSignalConvolution() { CheckEqualsExtendedSignalConvolution<float>(); }
+
+  void Apply_Double_EqualsExtendedSignalConvolution() { CheckEqualsExtendedSignalConvolution<double>(); }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2Convolution)
@@ -0,0 +1,77 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cstdio>
+#include <fstream>
+#include <m2FileStreamPool.h>
+#include <mitkExceptionMacro.h>
+#include <mitkIOUtil.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+
+class m2FileStreamPoolTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2FileStreamPoolTestSuite);
+  MITK_TEST(Acquire_ReusesReleasedStreams);
+  MITK_TEST(Acquire_MissingFile_Throws);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  std::string m_Path;
+
+public:
+  void setUp() override
+  {
+    std::ofstream f;
+    m_Path = mitk::IOUtil::CreateTemporaryFile(f, "m2FileStreamPoolTest_XXXXXX.ibd");
+    f << "0123456789";
+    f.close();
+  }
+
+  void tearDown() override { std::remove(m_Path.c_str()); }
+
+  void Acquire_ReusesReleasedStreams()
+  {
+    m2::FileStreamPool pool(m_Path);
+    auto a = pool.Acquire();
+    auto b = pool.Acquire();
+    CPPUNIT_ASSERT(a != b);
+
+    // a failed read does not affect the next reader of the stream
+    char c[16];
+    a->seekg(8);
+    CPPUNIT_ASSERT(!a->read(c, sizeof(c)));
+    const auto stream = a.get();
+    pool.Release(std::move(a));
+
+    auto d = pool.Acquire();
+    CPPUNIT_ASSERT(d.get() == stream);
+    d->seekg(3);
+    CPPUNIT_ASSERT(d->read(c, 2));
+    CPPUNIT_ASSERT_EQUAL('3', c[0]);
+    CPPUNIT_ASSERT_EQUAL('4', c[1]);
+    pool.Release(std::move(b));
+    pool.Release(std::move(d));
+  }
+
+  void Acquire_MissingFile_Throws()
+  {
+    m2::FileStreamPool pool(m_Path + ".missing");
+    CPPUNIT_ASSERT_THROW(pool.Acquire(), mitk::Exception);
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2FileStreamPool)
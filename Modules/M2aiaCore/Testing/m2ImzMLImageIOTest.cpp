@@ -16,9 +16,15 @@ See LICENSE.txt for details.
 
 #include "mitkIOUtil.h"
 #include <algorithm>
+#include <itksys/SystemTools.hxx>
 #include <signal/m2Normalization.h>
+#include <m2ImzMLMetaDataCache.h>
+#include <m2ImzMLParser.h>
 #include <m2ImzMLSpectrumImage.h>
+#include <m2Peak.h>
+#include <m2PeakMatrix.h>
 #include <m2TestingConfig.h>
+#include <mitkImagePixelReadAccessor.h>
 #include <mitkTestFixture.h>
 #include <mitkTestingMacros.h>
 #include <numeric>
@@ -31,10 +37,21 @@ class m2ImzMLImageIOTestSuite : public mitk::TestFixture
   CPPUNIT_TEST_SUITE(m2ImzMLImageIOTestSuite);
   MITK_TEST(LoadTestData_shouldReturnTrue);
   MITK_TEST(InitializeImageAccess_shouldReturnTrue);
+  MITK_TEST(ReadImageSpectrumMetaData_CachedEqualsParsed);
+  MITK_TEST(WriteContinuousProfile_SubRange_RoundTrip);
+  MITK_TEST(MemoryMappedBinaryData_EqualsFileStreams);
+  MITK_TEST(GetImages_EqualsGetImage);
+  MITK_TEST(ChangedStrategies_UsedWithoutInitialization);
+  MITK_TEST(InvertedMzIndex_EqualsReadsWithoutIndex);
 
   CPPUNIT_TEST_SUITE_END();
 
 private:
+  // the imzML data is loaded from a temporary copy, so that sidecars written on loading do not end up in the
+  // test data directory
+  std::string m_DataDirectory;
+  std::string m_ImzMLPath;
+
   std::vector<double> ReadDoubleVector(const std::string &fileNameInM2aiaDir, char delim = '\n')
   {
     std::vector<double> signal;
@@ -63,17 +80,118 @@ private:
     }
   }
 
+  m2::ImzMLSpectrumImage::Pointer ReadSpectrumMetaData(const std::string &path, bool useCache)
+  {
+    auto image = m2::ImzMLSpectrumImage::New();
+    image->SetUseSpectrumMetaDataCache(useCache);
+    m2::ImzMLSpectrumImage::ImzMLImageSource source;
+    source.m_ImzMLDataPath = path;
+    image->GetImzMLSpectrumImageSourceList().emplace_back(source);
+    m2::ImzMLParser::ReadImageMetaData(image);
+    m2::ImzMLParser::ReadImageSpectrumMetaData(image);
+    return image;
+  }
+
+  // loads an imzML file and initializes the image access without signal processing
+  m2::ImzMLSpectrumImage::Pointer LoadImage(const std::string &path, bool useMemoryMapping = true)
+  {
+    auto v = mitk::IOUtil::Load(path);
+    m2::ImzMLSpectrumImage::Pointer image = dynamic_cast<m2::ImzMLSpectrumImage *>(v.back().GetPointer());
+    CPPUNIT_ASSERT(image != nullptr);
+    image->SetUseMemoryMappedBinaryData(useMemoryMapping);
+    image->SetNormalizationStrategy(m2::NormalizationStrategyType::None);
+    image->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::None);
+    image->SetSmoothingStrategy(m2::SmoothingType::None);
+    image->InitializeImageAccess();
+    return image;
+  }
+
+  // exports every second data point of each spectrum of lipid.imzML as processed centroid data
+  std::string WriteProcessedCentroid()
+  {
+    auto image = LoadImage(m_ImzMLPath);
+    auto &spectra = image->GetImzMLSpectrumImageSource().m_Spectra;
+    spectra.SetPeaks(m2::PeakMatrix::Build(spectra.size(),
+                                           1,
+                                           [&](unsigned int, unsigned int id)
+                                           {
+                                             std::vector<float> mzs, ints;
+                                             image->GetSpectrum(id, mzs, ints);
+                                             std::vector<m2::Peak> peaks;
+                                             for (unsigned int i = id % 2; i < mzs.size(); i += 2)
+                                               peaks.emplace_back(i, mzs[i], ints[i]);
+                                             return peaks;
+                                           }));
+    image->SetTolerance(0);
+    image->GetExportSpectrumType().Format = m2::SpectrumFormat::ProcessedCentroid;
+    const auto path = m_DataDirectory + "/processed.imzML";
+    mitk::IOUtil::Save(image, path);
+    return path;
+  }
+
+  // pixel values of the ion image of [mz - tol, mz + tol]
+  static std::vector<m2::DisplayImagePixelType> GetImagePixels(const m2::SpectrumImageBase *image,
+                                                               double mz,
+                                                               double tol)
+  {
+    auto ionImage = mitk::Image::New();
+    ionImage->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *image->GetGeometry()->Clone());
+    image->GetImage(mz, tol, nullptr, ionImage);
+    return GetPixels(ionImage);
+  }
+
+  // ion images of overlapping, unsorted ranges around the center of the m/z axis and close to its start
+  static void AssertGetImagesEqualsGetImage(const m2::SpectrumImageBase *image)
+  {
+    const auto &xAxis = image->GetXAxis();
+    const auto center = xAxis.size() / 2;
+    const auto tol = 5 * (xAxis[center + 1] - xAxis[center]);
+    const std::vector<m2::IonImageRange> ranges = {
+      {xAxis[center], tol}, {xAxis[center / 2], tol}, {xAxis[center + 3], tol}, {xAxis[2], tol}};
+
+    std::vector<mitk::Image::Pointer> ionImages;
+    std::vector<mitk::Image *> outputs;
+    for (std::size_t k = 0; k < ranges.size(); ++k)
+    {
+      ionImages.push_back(mitk::Image::New());
+      ionImages.back()->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(),
+                                   *image->GetGeometry()->Clone());
+      outputs.push_back(ionImages.back());
+    }
+    image->GetImages(ranges, nullptr, outputs);
+    for (std::size_t k = 0; k < ranges.size(); ++k)
+      CPPUNIT_ASSERT(GetPixels(ionImages[k]) == GetImagePixels(image, ranges[k].mz, ranges[k].tol));
+  }
+
+  static std::vector<m2::DisplayImagePixelType> GetPixels(mitk::Image *image)
+  {
+    mitk::ImagePixelReadAccessor<m2::DisplayImagePixelType, 3> access(image);
+    const auto dims = image->GetDimensions();
+    const auto data = access.GetData();
+    return std::vector<m2::DisplayImagePixelType>(data, data + std::size_t(dims[0]) * dims[1] * dims[2]);
+  }
+
 public:
+  void setUp() override
+  {
+    m_DataDirectory = mitk::IOUtil::CreateTemporaryDirectory("m2ImzMLImageIOTest_XXXXXX");
+    for (const auto name : {"lipid.imzML", "lipid.ibd"})
+      itksys::SystemTools::CopyFileAlways(GetTestDataFilePath(name, M2AIA_DATA_DIR), m_DataDirectory + "/" + name);
+    m_ImzMLPath = m_DataDirectory + "/lipid.imzML";
+  }
+
+  void tearDown() override { itksys::SystemTools::RemoveADirectory(m_DataDirectory); }
+
   void LoadTestData_shouldReturnTrue()
   {
-    auto v = mitk::IOUtil::Load(GetTestDataFilePath("lipid.imzML", M2AIA_DATA_DIR));
+    auto v = mitk::IOUtil::Load(m_ImzMLPath);
     m2::ImzMLSpectrumImage::Pointer imzMLImage = dynamic_cast<m2::ImzMLSpectrumImage *>(v.back().GetPointer());
     CPPUNIT_ASSERT_ASSERTION_PASS(CPPUNIT_ASSERT(imzMLImage != nullptr));
   }
 
   void InitializeImageAccess_shouldReturnTrue()
   {
-    auto v = mitk::IOUtil::Load(GetTestDataFilePath("lipid.imzML", M2AIA_DATA_DIR));
+    auto v = mitk::IOUtil::Load(m_ImzMLPath);
     m2::ImzMLSpectrumImage::Pointer imzMLImage = dynamic_cast<m2::ImzMLSpectrumImage *>(v.back().GetPointer());
     imzMLImage->SetNormalizationStrategy(m2::NormalizationStrategyType::None);
     imzMLImage->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::None);
@@ -90,6 +208,167 @@ public:
     CPPUNIT_ASSERT_EQUAL(true, equal(begin(ints), end(ints), begin(reference)));
 	
   }
+
+  void ReadImageSpectrumMetaData_CachedEqualsParsed()
+  {
+    const auto &path = m_ImzMLPath;
+    const auto cachePath = m2::ImzMLMetaDataCache::GetDefaultPath(path);
+    itksys::SystemTools::RemoveFile(cachePath);
+
+    auto parsed = ReadSpectrumMetaData(path, false);
+    CPPUNIT_ASSERT(!itksys::SystemTools::FileExists(cachePath));
+
+    // the first read creates the cache, the second one reads it
+    ReadSpectrumMetaData(path, true);
+    CPPUNIT_ASSERT(itksys::SystemTools::FileExists(cachePath));
+    auto cached = ReadSpectrumMetaData(path, true);
+    itksys::SystemTools::RemoveFile(cachePath);
+
+    const auto &a = parsed->GetImzMLSpectrumImageSourceList().front().m_Spectra;
+    const auto &b = cached->GetImzMLSpectrumImageSourceList().front().m_Spectra;
+    CPPUNIT_ASSERT(!a.empty());
+    CPPUNIT_ASSERT_EQUAL(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+      CPPUNIT_ASSERT_EQUAL(a[i].GetMzOffset(), b[i].GetMzOffset());
+      CPPUNIT_ASSERT_EQUAL(a[i].GetIntOffset(), b[i].GetIntOffset());
+      CPPUNIT_ASSERT_EQUAL(a[i].GetMzLength(), b[i].GetMzLength());
+      CPPUNIT_ASSERT_EQUAL(a[i].GetIntLength(), b[i].GetIntLength());
+      CPPUNIT_ASSERT(a[i].GetIndex() == b[i].GetIndex());
+      CPPUNIT_ASSERT_EQUAL(a[i].GetWorld().x, b[i].GetWorld().x);
+      CPPUNIT_ASSERT_EQUAL(a[i].GetWorld().y, b[i].GetWorld().y);
+      CPPUNIT_ASSERT_EQUAL(a[i].GetWorld().z, b[i].GetWorld().z);
+      CPPUNIT_ASSERT_EQUAL(a[i].GetInFileNormalizationFactor(), b[i].GetInFileNormalizationFactor());
+    }
+    CPPUNIT_ASSERT_EQUAL(parsed->GetPropertyValue<unsigned>("number of measurements"),
+                         cached->GetPropertyValue<unsigned>("number of measurements"));
+  }
+
+  void WriteContinuousProfile_SubRange_RoundTrip()
+  {
+    auto image = LoadImage(m_ImzMLPath);
+    CPPUNIT_ASSERT(image->GetSpectrumType().Format == m2::SpectrumFormat::ContinuousProfile);
+
+    // export the second quarter of the m/z axis
+    std::vector<float> mzs, ints, xs, ys;
+    image->GetSpectrum(0, mzs, ints);
+    const auto first = mzs.size() / 4;
+    const auto last = mzs.size() / 2;
+    auto &exportType = image->GetExportSpectrumType();
+    exportType.UseLimits = true;
+    exportType.XLimMin = mzs[first];
+    exportType.XLimMax = mzs[last - 1];
+    const auto path = m_DataDirectory + "/subrange.imzML";
+    mitk::IOUtil::Save(image, path);
+
+    auto exported = LoadImage(path);
+    const auto n = image->GetImzMLSpectrumImageSource().m_Spectra.size();
+    CPPUNIT_ASSERT_EQUAL(n, exported->GetImzMLSpectrumImageSource().m_Spectra.size());
+    for (const auto id : {std::size_t(0), n / 2, n - 1})
+    {
+      image->GetSpectrum(id, mzs, ints);
+      exported->GetSpectrum(id, xs, ys);
+      CPPUNIT_ASSERT_EQUAL(last - first, xs.size());
+      CPPUNIT_ASSERT_EQUAL(last - first, ys.size());
+      CPPUNIT_ASSERT(std::equal(std::begin(xs), std::end(xs), std::begin(mzs) + first));
+      CPPUNIT_ASSERT(std::equal(std::begin(ys), std::end(ys), std::begin(ints) + first));
+    }
+  }
+
+  void MemoryMappedBinaryData_EqualsFileStreams()
+  {
+    for (const auto &path : {m_ImzMLPath, WriteProcessedCentroid()})
+    {
+      auto mapped = LoadImage(path, true);
+      auto streamed = LoadImage(path, false);
+      CPPUNIT_ASSERT(mapped->GetImzMLSpectrumImageSource().m_BinaryDataMapping != nullptr);
+      CPPUNIT_ASSERT(streamed->GetImzMLSpectrumImageSource().m_BinaryDataMapping == nullptr);
+
+      std::vector<float> mzsA, intsA, mzsB, intsB;
+      const auto n = mapped->GetImzMLSpectrumImageSource().m_Spectra.size();
+      for (unsigned int id = 0; id < n; ++id)
+      {
+        mapped->GetSpectrum(id, mzsA, intsA);
+        streamed->GetSpectrum(id, mzsB, intsB);
+        CPPUNIT_ASSERT(mzsA == mzsB);
+        CPPUNIT_ASSERT(intsA == intsB);
+      }
+
+      const auto &xAxis = mapped->GetXAxis();
+      for (const auto mz : {xAxis[xAxis.size() / 4], xAxis[xAxis.size() / 2], xAxis[3 * xAxis.size() / 4]})
+        CPPUNIT_ASSERT(GetImagePixels(mapped, mz, 0.5) == GetImagePixels(streamed, mz, 0.5));
+    }
+  }
+
+  void GetImages_EqualsGetImage()
+  {
+    auto image = LoadImage(m_ImzMLPath);
+    CPPUNIT_ASSERT(image->GetSpectrumType().Format == m2::SpectrumFormat::ContinuousProfile);
+
+    // profile data without signal processing, pooled in place
+    AssertGetImagesEqualsGetImage(image);
+
+    // kernel based processing near the borders of the ranges
+    image->SetSmoothingStrategy(m2::SmoothingType::SavitzkyGolay);
+    image->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::TopHat);
+    image->SetBaseLineCorrectionHalfWindowSize(20);
+    image->InitializeImageAccess();
+    AssertGetImagesEqualsGetImage(image);
+
+    // median pooling reorders the values of overlapping ranges
+    image->SetSmoothingStrategy(m2::SmoothingType::None);
+    image->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::None);
+    image->SetRangePoolingStrategy(m2::RangePoolingStrategyType::Median);
+    image->InitializeImageAccess();
+    AssertGetImagesEqualsGetImage(image);
+  }
+
+  void ChangedStrategies_UsedWithoutInitialization()
+  {
+    // the strategies are changed after the spectra and ion images of the old ones were generated and cached
+    auto changed = LoadImage(m_ImzMLPath);
+    const auto mz = changed->GetXAxis()[changed->GetXAxis().size() / 2];
+    GetImagePixels(changed, mz, 0.5);
+    changed->GetCachedSpectrum(0);
+    changed->SetSmoothingStrategy(m2::SmoothingType::SavitzkyGolay);
+    changed->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::TopHat);
+
+    auto initialized = LoadImage(m_ImzMLPath);
+    initialized->SetSmoothingStrategy(m2::SmoothingType::SavitzkyGolay);
+    initialized->SetBaselineCorrectionStrategy(m2::BaselineCorrectionType::TopHat);
+    initialized->InitializeImageAccess();
+
+    std::vector<float> mzs, ints, expectedMzs, expectedInts;
+    changed->GetSpectrum(0, mzs, ints);
+    initialized->GetSpectrum(0, expectedMzs, expectedInts);
+    CPPUNIT_ASSERT(ints == expectedInts);
+    CPPUNIT_ASSERT(changed->GetCachedSpectrum(0)->ys == initialized->GetCachedSpectrum(0)->ys);
+    CPPUNIT_ASSERT(GetImagePixels(changed, mz, 0.5) == GetImagePixels(initialized, mz, 0.5));
+  }
+
+  void InvertedMzIndex_EqualsReadsWithoutIndex()
+  {
+    const auto path = WriteProcessedCentroid();
+    auto indexed = LoadImage(path);
+    CPPUNIT_ASSERT(indexed->GetImzMLSpectrumImageSource().m_InvertedMzIndex != nullptr);
+    auto plain = LoadImage(path);
+    plain->SetUseInvertedMzIndex(false);
+    plain->InitializeImageAccess();
+    CPPUNIT_ASSERT(plain->GetImzMLSpectrumImageSource().m_InvertedMzIndex == nullptr);
+
+    for (const auto strategy : {m2::RangePoolingStrategyType::Sum, m2::RangePoolingStrategyType::Median})
+    {
+      indexed->SetRangePoolingStrategy(strategy);
+      plain->SetRangePoolingStrategy(strategy);
+
+      // ranges within a single bin of the index up to ranges over many bins
+      const auto &xAxis = indexed->GetXAxis();
+      for (const auto mz : {xAxis[xAxis.size() / 4], xAxis[xAxis.size() / 2], xAxis[3 * xAxis.size() / 4]})
+        for (const auto tol : {0.001, 0.05, 0.5, 5.0})
+          CPPUNIT_ASSERT(GetImagePixels(indexed, mz, tol) == GetImagePixels(plain, mz, tol));
+      AssertGetImagesEqualsGetImage(indexed);
+    }
+  }
 };
 
 MITK_TEST_SUITE_REGISTRATION(m2ImzMLImageIO)
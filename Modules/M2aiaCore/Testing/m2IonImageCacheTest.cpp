@@ -0,0 +1,87 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cmath>
+#include <m2IonImageCache.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+
+class m2IonImageCacheTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2IonImageCacheTestSuite);
+  MITK_TEST(Insert_ExceedingMemoryLimit_CompressesLeastRecentlyUsed);
+  MITK_TEST(Get_OtherKey_Misses);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  static constexpr std::size_t NumberOfPixels = 1000;
+
+  static std::vector<double> MakeImage(double value)
+  {
+    std::vector<double> image(NumberOfPixels);
+    for (std::size_t i = 0; i < image.size(); ++i)
+      image[i] = i % 3 ? value * std::sin(double(i)) : 0;
+    return image;
+  }
+
+  static void Insert(m2::IonImageCache &cache, const m2::IonImageCache::Key &key, const std::vector<double> &image)
+  {
+    cache.Insert(key, m2::Span<const double>(image.data(), image.size()));
+  }
+
+public:
+  void Insert_ExceedingMemoryLimit_CompressesLeastRecentlyUsed()
+  {
+    m2::IonImageCache cache(2 * NumberOfPixels * sizeof(double), 1 << 20);
+    for (int i = 0; i < 3; ++i)
+      Insert(cache, {100.0 + i, 0.1, 0, 1}, MakeImage(i + 1));
+
+    CPPUNIT_ASSERT_EQUAL(size_t(2), cache.GetNumberOfImages());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), cache.GetNumberOfCompressedImages());
+    CPPUNIT_ASSERT(cache.GetNumberOfCompressedBytes() < NumberOfPixels * sizeof(double));
+
+    // the compressed image is restored exactly and replaces the least recently used one
+    std::vector<double> image(NumberOfPixels);
+    CPPUNIT_ASSERT(cache.Get({100.0, 0.1, 0, 1}, m2::Span<double>(image.data(), image.size())));
+    CPPUNIT_ASSERT(image == MakeImage(1));
+    CPPUNIT_ASSERT_EQUAL(size_t(2), cache.GetNumberOfImages());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), cache.GetNumberOfCompressedImages());
+
+    CPPUNIT_ASSERT(cache.Get({101.0, 0.1, 0, 1}, m2::Span<double>(image.data(), image.size())));
+    CPPUNIT_ASSERT(image == MakeImage(2));
+  }
+
+  void Get_OtherKey_Misses()
+  {
+    m2::IonImageCache cache;
+    Insert(cache, {100.0, 0.1, 0, 1}, MakeImage(1));
+
+    std::vector<double> image(NumberOfPixels);
+    const m2::Span<double> span(image.data(), image.size());
+    CPPUNIT_ASSERT(!cache.Get({100.0, 0.2, 0, 1}, span));
+    CPPUNIT_ASSERT(!cache.Get({100.0, 0.1, 7, 1}, span));
+    CPPUNIT_ASSERT(!cache.Get({100.0, 0.1, 0, 1}, span.subspan(0, 10)));
+    CPPUNIT_ASSERT(cache.Get({100.0, 0.1, 0, 1}, span));
+    CPPUNIT_ASSERT(cache.Contains({100.0, 0.1, 0, 1}));
+    CPPUNIT_ASSERT(!cache.Contains({100.0, 0.2, 0, 1}));
+
+    // another processing hash drops all images
+    CPPUNIT_ASSERT(!cache.Get({100.0, 0.1, 0, 2}, span));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), cache.GetNumberOfImages());
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2IonImageCache)
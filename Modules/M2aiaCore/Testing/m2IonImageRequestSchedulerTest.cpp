@@ -0,0 +1,151 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <atomic>
+#include <future>
+#include <m2IonImageRequestScheduler.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <vector>
+
+class m2IonImageRequestSchedulerTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2IonImageRequestSchedulerTestSuite);
+  MITK_TEST(Submit_WhileRunning_CancelsRunningAndDropsSuperseded);
+  MITK_TEST(Submit_DifferentKeys_RunConcurrently);
+  MITK_TEST(Remove_WaitsForRunningRequestAndReleasesKey);
+  MITK_TEST(CancelAll_CancelsAllKeysAndCallsIdleCallbackOnce);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void Submit_WhileRunning_CancelsRunningAndDropsSuperseded()
+  {
+    m2::IonImageRequestScheduler scheduler;
+    std::vector<int> executed; // written by the requests of one key only, which never run concurrently
+    std::promise<void> started, submitted;
+    auto submittedFuture = submitted.get_future().share();
+    int key;
+
+    scheduler.Submit(&key,
+                     [&](const m2::CancellationToken &token)
+                     {
+                       executed.push_back(0);
+                       started.set_value();
+                       while (!token.IsCancelled())
+                         std::this_thread::yield();
+                       submittedFuture.wait();
+                       token.ThrowIfCancelled();
+                       executed.push_back(-1); // not reached
+                     });
+    started.get_future().wait();
+
+    for (int i = 1; i <= 3; ++i)
+      scheduler.Submit(&key, [&executed, i](const m2::CancellationToken &) { executed.push_back(i); });
+    submitted.set_value();
+    scheduler.Wait();
+
+    CPPUNIT_ASSERT(executed == std::vector<int>({0, 3}));
+  }
+
+  void Submit_DifferentKeys_RunConcurrently()
+  {
+    m2::IonImageRequestScheduler scheduler;
+    std::promise<void> a, b;
+    auto aFuture = a.get_future();
+    auto bFuture = b.get_future();
+    int keyA, keyB;
+
+    // each request waits for the other one to start
+    scheduler.Submit(&keyA,
+                     [&](const m2::CancellationToken &)
+                     {
+                       a.set_value();
+                       bFuture.wait();
+                     });
+    scheduler.Submit(&keyB,
+                     [&](const m2::CancellationToken &)
+                     {
+                       b.set_value();
+                       aFuture.wait();
+                     });
+    scheduler.Wait();
+  }
+
+  void Remove_WaitsForRunningRequestAndReleasesKey()
+  {
+    m2::IonImageRequestScheduler scheduler;
+    std::promise<void> started;
+    bool returned = false;
+    int key, otherKey;
+
+    scheduler.Submit(&otherKey, [](const m2::CancellationToken &) {});
+    scheduler.Submit(&key,
+                     [&](const m2::CancellationToken &token)
+                     {
+                       started.set_value();
+                       while (!token.IsCancelled())
+                         std::this_thread::yield();
+                       returned = true;
+                     });
+    started.get_future().wait();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), scheduler.GetNumberOfKeys());
+
+    scheduler.Remove(&key);
+    CPPUNIT_ASSERT(returned);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), scheduler.GetNumberOfKeys());
+
+    // removed keys can be used again
+    scheduler.Submit(&key, [](const m2::CancellationToken &) {});
+    scheduler.Wait();
+    scheduler.Remove(&key);
+    scheduler.Remove(&otherKey);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(0), scheduler.GetNumberOfKeys());
+  }
+
+  void CancelAll_CancelsAllKeysAndCallsIdleCallbackOnce()
+  {
+    m2::IonImageRequestScheduler scheduler;
+    std::promise<void> idle;
+    std::atomic<int> started{0}, idleCalls{0};
+    scheduler.SetIdleCallback(
+      [&]
+      {
+        if (idleCalls++ == 0)
+          idle.set_value();
+      });
+    int keyA, keyB;
+
+    const auto request = [&](const m2::CancellationToken &token)
+    {
+      ++started;
+      while (!token.IsCancelled())
+        std::this_thread::yield();
+    };
+    scheduler.Submit(&keyA, request);
+    scheduler.Submit(&keyB, request);
+    while (started < 2)
+      std::this_thread::yield();
+    CPPUNIT_ASSERT(!scheduler.IsIdle());
+
+    scheduler.CancelAll();
+    idle.get_future().wait();
+    CPPUNIT_ASSERT(scheduler.IsIdle());
+    scheduler.Wait();
+    CPPUNIT_ASSERT_EQUAL(1, idleCalls.load());
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2IonImageRequestScheduler)
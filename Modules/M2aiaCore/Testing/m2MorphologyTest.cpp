@@ -0,0 +1,94 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2Morphology.h>
+#include <vector>
+
+class m2MorphologyTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2MorphologyTestSuite);
+  MITK_TEST(ErosionDilation_Float_EqualWindowMinMax);
+  MITK_TEST(Opening_Double_EqualsDilationOfErosion);
+  CPPUNIT_TEST_SUITE_END();
+
+  template <class T>
+  std::vector<T> MakeSignal(std::size_t n, unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::normal_distribution<T> noise(1, 0.33);
+    std::vector<T> signal(n);
+    for (auto &v : signal)
+      v = noise(generator);
+    return signal;
+  }
+
+  // minimum or maximum of the 2s+1 values around each position; the borders repeat the first and last value
+  template <class T, class Select>
+  std::vector<T> WindowSelect(const std::vector<T> &signal, unsigned int s, Select select)
+  {
+    const std::ptrdiff_t n = signal.size();
+    std::vector<T> result(n);
+    for (std::ptrdiff_t i = 0; i < n; ++i)
+    {
+      result[i] = signal[std::max<std::ptrdiff_t>(i - s, 0)];
+      for (std::ptrdiff_t j = i - s; j <= i + std::ptrdiff_t(s); ++j)
+        result[i] = select(result[i], signal[std::min(std::max<std::ptrdiff_t>(j, 0), n - 1)]);
+    }
+    return result;
+  }
+
+public:
+  void ErosionDilation_Float_EqualWindowMinMax()
+  {
+    m2::Signal::MorphologyWorkspace<float> workspace;
+    for (unsigned int s : {0u, 1u, 2u, 10u})
+      for (std::size_t n : {std::size_t(1), std::size_t(7), std::size_t(1000)})
+      {
+        auto signal = MakeSignal<float>(n, s + n);
+        std::vector<float> erosion(n), dilation(n);
+        m2::Signal::Erosion(signal.begin(), signal.end(), s, erosion.begin(), workspace);
+        m2::Signal::Dilation(signal.begin(), signal.end(), s, dilation.begin(), workspace);
+        CPPUNIT_ASSERT(erosion == WindowSelect(signal, s, [](float a, float b) { return std::min(a, b); }));
+        CPPUNIT_ASSERT(dilation == WindowSelect(signal, s, [](float a, float b) { return std::max(a, b); }));
+      }
+  }
+
+  void Opening_Double_EqualsDilationOfErosion()
+  {
+    m2::Signal::MorphologyWorkspace<double> workspace;
+    for (unsigned int s : {0u, 2u, 100u})
+      for (std::size_t n : {std::size_t(1), std::size_t(150), std::size_t(5000)})
+      {
+        auto signal = MakeSignal<double>(n, s + n);
+        std::vector<double> expected(n), opening(n);
+        m2::Signal::Erosion(signal.begin(), signal.end(), s, expected.begin());
+        m2::Signal::Dilation(expected.begin(), expected.end(), s, expected.begin());
+
+        m2::Signal::Opening(signal.data(), signal.data() + n, s, opening.data(), workspace);
+        CPPUNIT_ASSERT(opening == expected);
+
+        // in place
+        m2::Signal::Opening(signal.data(), signal.data() + n, s, signal.data(), workspace);
+        CPPUNIT_ASSERT(signal == expected);
+      }
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2Morphology)
@@ -0,0 +1,161 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <m2CoreCommon.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2PeakDetection.h>
+#include <vector>
+
+namespace
+{
+  struct MassPeak
+  {
+    double mass;
+    double intensity;
+  };
+
+  struct Match
+  {
+    MassPeak input;
+    MassPeak reference;
+  };
+
+  /**
+   * @brief The former implementation of m2::Signal::findMatches, which compares all pairs of inputs and references.
+   */
+  template <class OutIt>
+  void AllPairsFindMatches(const std::vector<MassPeak> &inputs,
+                           const std::vector<MassPeak> &references,
+                           OutIt oIt,
+                           double tolerance)
+  {
+    for (const auto &i : inputs)
+    {
+      double diff = std::numeric_limits<double>::max();
+      const MassPeak *match = nullptr;
+      for (const auto &r : references)
+        if (std::abs(i.mass - r.mass) <= (r.mass * tolerance) && std::abs(i.intensity - r.intensity) < diff)
+        {
+          match = &r;
+          diff = std::abs(i.intensity - r.intensity);
+        }
+      if (match)
+        *oIt++ = {i, *match};
+    }
+  }
+
+  std::vector<MassPeak> MakePeaks(std::size_t n, unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> mass(100, 1000);
+    // few distinct intensities, so that ties occur
+    std::uniform_int_distribution<int> intensity(0, 3);
+    std::vector<MassPeak> peaks(n);
+    for (auto &p : peaks)
+      p = {mass(generator), double(intensity(generator))};
+    return peaks;
+  }
+} // namespace
+
+class m2PeakMatchingTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2PeakMatchingTestSuite);
+  MITK_TEST(FindMatches_Unsorted_EqualsAllPairs);
+  MITK_TEST(MatchPeaks_PeakMatrix_ReturnsNearestReference);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void FindMatches_Unsorted_EqualsAllPairs()
+  {
+    const auto tolerance = m2::PartPerMillionToFactor(50);
+    const auto inputs = MakePeaks(2000, 1);
+    auto references = MakePeaks(5000, 2);
+    // duplicate masses with other intensities
+    for (std::size_t i = 0; i < 500; ++i)
+      references.push_back({references[i].mass, references[i + 1].intensity});
+
+    std::vector<Match> expected, matches;
+    AllPairsFindMatches(inputs, references, std::back_inserter(expected), tolerance);
+    m2::Signal::findMatches(
+      inputs.begin(), inputs.end(), references.begin(), references.end(), std::back_inserter(matches), tolerance);
+
+    CPPUNIT_ASSERT(!expected.empty());
+    CPPUNIT_ASSERT_EQUAL(expected.size(), matches.size());
+    for (std::size_t i = 0; i < matches.size(); ++i)
+    {
+      CPPUNIT_ASSERT_EQUAL(expected[i].input.mass, matches[i].input.mass);
+      CPPUNIT_ASSERT_EQUAL(expected[i].reference.mass, matches[i].reference.mass);
+      CPPUNIT_ASSERT_EQUAL(expected[i].reference.intensity, matches[i].reference.intensity);
+    }
+  }
+
+  void MatchPeaks_PeakMatrix_ReturnsNearestReference()
+  {
+    const auto tolerance = m2::PartPerMillionToFactor(20);
+    std::vector<double> references;
+    for (const auto &p : MakePeaks(20000, 3))
+      references.push_back(p.mass);
+    std::sort(references.begin(), references.end());
+
+    const unsigned int numberOfSpectra = 300;
+    const auto matrix = m2::PeakMatrix::Build(numberOfSpectra,
+                                              4,
+                                              [](unsigned int, unsigned int spectrum)
+                                              {
+                                                std::vector<m2::Peak> peaks;
+                                                for (const auto &p : MakePeaks(200, 10 + spectrum))
+                                                  peaks.emplace_back(0, p.mass, p.intensity);
+                                                std::sort(peaks.begin(), peaks.end());
+                                                return peaks;
+                                              });
+
+    // nearest reference of each peak, compared against all references
+    std::vector<m2::Signal::PeakMatch> expected;
+    for (unsigned int spectrum = 0; spectrum < numberOfSpectra; ++spectrum)
+    {
+      const auto mzs = matrix[spectrum].mzs;
+      for (unsigned int peak = 0; peak < mzs.size(); ++peak)
+      {
+        const double mz = mzs[peak];
+        std::size_t nearest = references.size();
+        for (std::size_t r = 0; r < references.size(); ++r)
+          if (std::abs(mz - references[r]) <= references[r] * tolerance &&
+              (nearest == references.size() || std::abs(mz - references[r]) < std::abs(mz - references[nearest])))
+            nearest = r;
+        if (nearest != references.size())
+          expected.push_back({spectrum, peak, static_cast<std::uint32_t>(nearest)});
+      }
+    }
+
+    const auto table = m2::Signal::MatchPeaks(matrix, references, tolerance, 4);
+    CPPUNIT_ASSERT(!expected.empty());
+    CPPUNIT_ASSERT_EQUAL(expected.size(), table.size());
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+      CPPUNIT_ASSERT_EQUAL(expected[i].spectrum, table[i].spectrum);
+      CPPUNIT_ASSERT_EQUAL(expected[i].peak, table[i].peak);
+      CPPUNIT_ASSERT_EQUAL(expected[i].reference, table[i].reference);
+    }
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2PeakMatching)
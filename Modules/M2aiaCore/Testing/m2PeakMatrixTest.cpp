@@ -0,0 +1,95 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2Peak.h>
+#include <m2PeakMatrix.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <vector>
+
+class m2PeakMatrixTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2PeakMatrixTestSuite);
+  MITK_TEST(Build_Parallel_KeepsRowOrder);
+  MITK_TEST(ResizeAndAppend_KeepRows);
+  CPPUNIT_TEST_SUITE_END();
+
+  // row i holds i % 5 peaks at m/z 100*i + k with intensity k
+  static std::vector<m2::Peak> MakePeaks(unsigned int row)
+  {
+    std::vector<m2::Peak> peaks;
+    for (unsigned int k = 0; k < row % 5; ++k)
+      peaks.emplace_back(k, 100.0 * row + k, double(k));
+    return peaks;
+  }
+
+  template <class MzType>
+  void CheckRows(const m2::BasicPeakMatrix<MzType> &matrix, unsigned int firstRow, unsigned int lastRow)
+  {
+    for (unsigned int row = firstRow; row < lastRow; ++row)
+    {
+      const auto peaks = matrix[row - firstRow];
+      CPPUNIT_ASSERT_EQUAL(size_t(row % 5), peaks.size());
+      for (unsigned int k = 0; k < peaks.size(); ++k)
+      {
+        CPPUNIT_ASSERT_EQUAL(MzType(100.0 * row + k), peaks.mzs[k]);
+        CPPUNIT_ASSERT_EQUAL(float(k), peaks.intensities[k]);
+      }
+    }
+  }
+
+public:
+  void Build_Parallel_KeepsRowOrder()
+  {
+    const unsigned int n = 10000;
+    std::vector<unsigned int> calls(4, 0);
+    const auto matrix = m2::BasicPeakMatrix<double>::Build(n,
+                                                          4,
+                                                          [&](unsigned int t, unsigned int row)
+                                                          {
+                                                            ++calls[t];
+                                                            return MakePeaks(row);
+                                                          });
+    CPPUNIT_ASSERT_EQUAL(size_t(n), matrix.GetNumberOfRows());
+    CPPUNIT_ASSERT_EQUAL(size_t(2 * n), matrix.GetNumberOfPeaks());
+    CPPUNIT_ASSERT_EQUAL(n, calls[0] + calls[1] + calls[2] + calls[3]);
+    CheckRows(matrix, 0, n);
+  }
+
+  void ResizeAndAppend_KeepRows()
+  {
+    const auto makeRow = [](unsigned int, unsigned int row) { return MakePeaks(row); };
+    auto a = m2::PeakMatrix::Build(7, 2, makeRow);
+    a.Resize(4);
+    CPPUNIT_ASSERT_EQUAL(size_t(4), a.GetNumberOfRows());
+    CPPUNIT_ASSERT_EQUAL(size_t(6), a.GetNumberOfPeaks());
+    CheckRows(a, 0, 4);
+
+    a.Resize(6);
+    CPPUNIT_ASSERT(a[4].empty() && a[5].empty());
+
+    auto b = m2::PeakMatrix::Build(3, 2, makeRow);
+    a.Append(std::move(b));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), b.GetNumberOfRows());
+    CPPUNIT_ASSERT_EQUAL(size_t(9), a.GetNumberOfRows());
+    CheckRows(a, 0, 4);
+    CPPUNIT_ASSERT(a[5].empty());
+    for (unsigned int row = 0; row < 3; ++row)
+      CPPUNIT_ASSERT_EQUAL(size_t(row % 5), a[6 + row].size());
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2PeakMatrix)
@@ -0,0 +1,153 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mbilog.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2RunningMedian.h>
+#include <vector>
+
+namespace
+{
+  /**
+   * @brief The former implementation of m2::RunMedian::apply, which keeps the window in a sorted table
+   * (O(s) per sample). Reference for the results and the run time of the heap based implementation.
+   */
+  template <class T>
+  void SortedTableRunMedian(const std::vector<T> &signal, unsigned int s, std::vector<T> &output)
+  {
+    struct Node
+    {
+      double value;
+      size_t index;
+      Node *parent;
+      Node *sorted;
+    };
+
+    const size_t length = s * 2 + 1;
+    std::vector<Node> kernel(length);
+    Node *oldest = &kernel[length - 1];
+    for (size_t i = 0; i < length; i++)
+    {
+      kernel[i].value = signal.front();
+      kernel[i].parent = oldest;
+      kernel[i].index = i;
+      kernel[i].sorted = &kernel[i];
+      oldest = &kernel[i];
+    }
+
+    const auto Swap = [](Node *&a, Node *&b)
+    {
+      std::swap(a, b);
+      std::swap(a->index, b->index);
+    };
+
+    for (size_t k = 0; k < signal.size(); ++k)
+    {
+      Node *node = oldest;
+      node->value = signal[k];
+      oldest = node->parent;
+      for (size_t i = node->index; i < length - 1 && kernel[i].sorted->value > kernel[i + 1].sorted->value; i++)
+        Swap(kernel[i].sorted, kernel[i + 1].sorted);
+      for (size_t i = node->index; i > 0 && kernel[i].sorted->value < kernel[i - 1].sorted->value; i--)
+        Swap(kernel[i].sorted, kernel[i - 1].sorted);
+
+      const double median = kernel[length / 2].sorted->value;
+      output[k] = median < 0 ? kernel[length - 1].sorted->value : median;
+    }
+  }
+
+  template <class T>
+  std::vector<T> MakeSignal(size_t n, unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::normal_distribution<T> noise(0, 1);
+    std::vector<T> signal(n);
+    // negative medians occur in the first half, repeated values in the last quarter
+    for (size_t i = 0; i < n; ++i)
+      signal[i] = i < n / 2 ? noise(generator) - T(0.2) : (i < 3 * n / 4 ? std::abs(noise(generator)) : T(i % 7));
+    return signal;
+  }
+} // namespace
+
+class m2RunningMedianTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2RunningMedianTestSuite);
+  MITK_TEST(Apply_SmallSignal_ReturnsExpectedMedian);
+  MITK_TEST(Apply_Float_EqualsSortedTable);
+  MITK_TEST(Apply_Double_EqualsSortedTable);
+  MITK_TEST(Apply_LargeWindow_EqualsSortedTable);
+  CPPUNIT_TEST_SUITE_END();
+
+  template <class T>
+  void CheckEqualsSortedTable()
+  {
+    m2::RunMedian::Workspace<T> workspace;
+    for (unsigned int s : {0u, 1u, 2u, 7u, 100u})
+      for (size_t n : {size_t(1), size_t(5), size_t(2000)})
+      {
+        auto signal = MakeSignal<T>(n, s * 31 + n);
+        std::vector<T> expected(n), median(n);
+        SortedTableRunMedian(signal, s, expected);
+        m2::RunMedian::apply(signal.begin(), signal.end(), s, median.begin(), workspace);
+        CPPUNIT_ASSERT(median == expected);
+      }
+  }
+
+public:
+  void Apply_SmallSignal_ReturnsExpectedMedian()
+  {
+    std::vector<double> signal = {5, 5, 9, 5, 5, 5, 5, 0, 4, 4, 4, 6, 6, 6};
+    std::vector<double> result = {5, 5, 5, 5, 5, 5, 5, 5, 4, 4, 4, 4, 6, 6};
+
+    std::vector<double> median(signal.size());
+    m2::RunMedian::apply(signal.begin(), signal.end(), 1, median.begin()); // window size is 2*1+1
+    CPPUNIT_ASSERT(median == result);
+  }
+
+  void Apply_Float_EqualsSortedTable() { CheckEqualsSortedTable<float>(); }
+
+  void Apply_Double_EqualsSortedTable() { CheckEqualsSortedTable<double>(); }
+
+  void Apply_LargeWindow_EqualsSortedTable()
+  {
+    // the default baseline correction half window size
+    const unsigned int s = 100;
+    auto signal = MakeSignal<float>(200000, 1);
+    std::vector<float> expected(signal.size()), median(signal.size());
+    m2::RunMedian::Workspace<float> workspace;
+
+    using Clock = std::chrono::steady_clock;
+    auto t0 = Clock::now();
+    SortedTableRunMedian(signal, s, expected);
+    auto t1 = Clock::now();
+    m2::RunMedian::apply(signal.begin(), signal.end(), s, median.begin(), workspace);
+    auto t2 = Clock::now();
+
+    const auto sortedTable = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    const auto heaps = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    MITK_INFO << "Running median of " << signal.size() << " samples, window size " << 2 * s + 1
+              << ": sorted table " << sortedTable << " ms, heaps " << heaps << " ms";
+    // timings are logged only; they depend on the machine and its load
+    CPPUNIT_ASSERT(median == expected);
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2RunningMedian)
@@ -0,0 +1,79 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2SpectrumCache.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+
+class m2SpectrumCacheTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2SpectrumCacheTestSuite);
+  MITK_TEST(Insert_ExceedingMemoryLimit_EvictsLeastRecentlyUsed);
+  MITK_TEST(Get_OtherProcessingHash_DropsAllSpectra);
+  MITK_TEST(Insert_SpectrumLargerThanMemoryLimit_IsNotCached);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  // 10 x and 10 y values, i.e. 160 bytes
+  static m2::SpectrumCache::Spectrum MakeSpectrum(double value)
+  {
+    return {std::vector<double>(10, value), std::vector<double>(10, value)};
+  }
+
+public:
+  void Insert_ExceedingMemoryLimit_EvictsLeastRecentlyUsed()
+  {
+    m2::SpectrumCache cache(3 * 160);
+    for (std::uint32_t i = 0; i < 3; ++i)
+      cache.Insert({0, i, 1}, MakeSpectrum(i));
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(3 * 160), cache.GetNumberOfBytes());
+
+    // spectrum 0 is used again, so spectrum 1 is the least recently used one
+    CPPUNIT_ASSERT_EQUAL(0.0, cache.Get({0, 0, 1})->ys[0]);
+    cache.Insert({0, 3, 1}, MakeSpectrum(3));
+
+    CPPUNIT_ASSERT_EQUAL(size_t(3), cache.GetNumberOfSpectra());
+    CPPUNIT_ASSERT(cache.Contains({0, 0, 1}));
+    CPPUNIT_ASSERT(!cache.Contains({0, 1, 1}));
+    CPPUNIT_ASSERT(cache.Contains({0, 2, 1}));
+    CPPUNIT_ASSERT(!cache.Contains({1, 2, 1}));
+
+    cache.SetMemoryLimit(160);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), cache.GetNumberOfSpectra());
+    CPPUNIT_ASSERT(cache.Contains({0, 3, 1}));
+  }
+
+  void Get_OtherProcessingHash_DropsAllSpectra()
+  {
+    m2::SpectrumCache cache;
+    cache.Insert({0, 0, 1}, MakeSpectrum(0));
+    CPPUNIT_ASSERT(cache.Get({0, 0, 1}));
+
+    CPPUNIT_ASSERT(!cache.Get({0, 0, 2}));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), cache.GetNumberOfSpectra());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), cache.GetNumberOfBytes());
+  }
+
+  void Insert_SpectrumLargerThanMemoryLimit_IsNotCached()
+  {
+    m2::SpectrumCache cache(100);
+    const auto spectrum = cache.Insert({0, 0, 1}, MakeSpectrum(5));
+    CPPUNIT_ASSERT_EQUAL(5.0, spectrum->xs[9]);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), cache.GetNumberOfSpectra());
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2SpectrumCache)
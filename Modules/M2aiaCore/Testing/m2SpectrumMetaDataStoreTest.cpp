@@ -0,0 +1,159 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2Peak.h>
+#include <m2SpectrumMetaDataStore.h>
+#include <mitkExceptionMacro.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <vector>
+
+class m2SpectrumMetaDataStoreTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2SpectrumMetaDataStoreTestSuite);
+  MITK_TEST(Resize_InitializesDefaults);
+  MITK_TEST(View_SetAndGet);
+  MITK_TEST(OptionalColumns_AllocatedOnFirstUse);
+  MITK_TEST(SetIndex_OutOfRange_Throws);
+  MITK_TEST(Append_KeepsOrderAndOptionalColumns);
+  MITK_TEST(Peaks_RequireOneRowPerSpectrum);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void Resize_InitializesDefaults()
+  {
+    m2::SpectrumMetaDataStore store;
+    store.resize(3);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), store.size());
+    for (const auto s : store)
+    {
+      CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::OffsetType(0), s.GetMzOffset());
+      CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::LengthType(0), s.GetIntLength());
+      CPPUNIT_ASSERT_EQUAL(1.0, s.GetNormalizationFactor());
+      CPPUNIT_ASSERT_EQUAL(1.0, s.GetInFileNormalizationFactor());
+      CPPUNIT_ASSERT_EQUAL(0.0, s.GetWorld().z);
+      CPPUNIT_ASSERT(s.GetPeaks().empty());
+    }
+  }
+
+  void View_SetAndGet()
+  {
+    m2::SpectrumMetaDataStore store;
+    store.resize(2);
+    m2::SpectrumMetaDataStore::IndexType index;
+    index[0] = 70000;
+    index[1] = 12;
+    index[2] = 3;
+
+    const auto s = store[1];
+    s.SetMzOffset(5000000000ull);
+    s.SetIntOffset(16);
+    s.SetMzLength(100);
+    s.SetIntLength(200);
+    s.SetIndex(index);
+    s.SetNormalizationFactor(0.5);
+
+    const auto &constStore = store;
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::OffsetType(5000000000ull), constStore[1].GetMzOffset());
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::OffsetType(16), constStore[1].GetIntOffset());
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::LengthType(100), constStore[1].GetMzLength());
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::LengthType(200), constStore[1].GetIntLength());
+    CPPUNIT_ASSERT(constStore[1].GetIndex() == index);
+    CPPUNIT_ASSERT_EQUAL(0.5, constStore[1].GetNormalizationFactor());
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::OffsetType(0), constStore[0].GetMzOffset());
+  }
+
+  void OptionalColumns_AllocatedOnFirstUse()
+  {
+    m2::SpectrumMetaDataStore store;
+    store.resize(2);
+    const auto memorySize = store.GetMemorySize();
+
+    store[0].SetInFileNormalizationFactor(42.0);
+    store[1].SetWorld({1, 2, 1234567.891});
+    CPPUNIT_ASSERT(store.GetMemorySize() > memorySize);
+
+    CPPUNIT_ASSERT_EQUAL(42.0, store[0].GetInFileNormalizationFactor());
+    CPPUNIT_ASSERT_EQUAL(1.0, store[1].GetInFileNormalizationFactor());
+    CPPUNIT_ASSERT_EQUAL(0.0, store[0].GetWorld().z);
+    // world coordinates are kept in double precision
+    CPPUNIT_ASSERT_EQUAL(1234567.891, store[1].GetWorld().z);
+
+    store.resize(3);
+    CPPUNIT_ASSERT_EQUAL(1.0, store[2].GetInFileNormalizationFactor());
+  }
+
+  void SetIndex_OutOfRange_Throws()
+  {
+    m2::SpectrumMetaDataStore store;
+    store.resize(1);
+    const auto s = store[0];
+    CPPUNIT_ASSERT_THROW(s.SetIndex(0, -1), mitk::Exception);
+    CPPUNIT_ASSERT_THROW(s.SetIndex(1, 1ll << 32), mitk::Exception);
+    CPPUNIT_ASSERT_THROW(s.SetIndex(2, 1 << 16), mitk::Exception);
+    CPPUNIT_ASSERT_THROW(s.SetIndex(3, 0), mitk::Exception);
+
+    s.SetIndex(2, (1 << 16) - 1);
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::IndexType::IndexValueType((1 << 16) - 1), s.GetIndex()[2]);
+    CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::IndexType::IndexValueType(0), s.GetIndex()[0]);
+  }
+
+  void Append_KeepsOrderAndOptionalColumns()
+  {
+    m2::SpectrumMetaDataStore a, b;
+    a.AddSpectrum().SetMzOffset(1);
+    b.AddSpectrum().SetMzOffset(2);
+    const auto s = b.AddSpectrum();
+    s.SetMzOffset(3);
+    s.SetInFileNormalizationFactor(7.0);
+
+    a.Append(std::move(b));
+    CPPUNIT_ASSERT(b.empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(3), a.size());
+    for (unsigned int i = 0; i < 3; ++i)
+      CPPUNIT_ASSERT_EQUAL(m2::SpectrumMetaDataStore::OffsetType(i + 1), a[i].GetMzOffset());
+    CPPUNIT_ASSERT_EQUAL(1.0, a[0].GetInFileNormalizationFactor());
+    CPPUNIT_ASSERT_EQUAL(1.0, a[1].GetInFileNormalizationFactor());
+    CPPUNIT_ASSERT_EQUAL(7.0, a[2].GetInFileNormalizationFactor());
+  }
+
+  void Peaks_RequireOneRowPerSpectrum()
+  {
+    m2::SpectrumMetaDataStore store;
+    store.resize(2);
+    CPPUNIT_ASSERT(!store.HasPeaks());
+    CPPUNIT_ASSERT_THROW(store.SetPeaks(m2::PeakMatrix(1)), mitk::Exception);
+
+    std::vector<std::vector<m2::Peak>> peaks = {{}, {m2::Peak(0, 100.0, 1.0), m2::Peak(1, 200.0, 1.0)}};
+    store.SetPeaks(m2::PeakMatrix::Build(2, 1, [&](unsigned int, unsigned int row) { return peaks[row]; }));
+    CPPUNIT_ASSERT(store.HasPeaks());
+    CPPUNIT_ASSERT(store[0].GetPeaks().empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), store[1].GetPeaks().size());
+    CPPUNIT_ASSERT_EQUAL(200.0f, store[1].GetPeaks().mzs[1]);
+
+    // peaks are kept in the order of the spectra
+    m2::SpectrumMetaDataStore other;
+    other.resize(1);
+    store.Append(std::move(other));
+    store.resize(4);
+    CPPUNIT_ASSERT_EQUAL(size_t(4), store.GetPeaks().GetNumberOfRows());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), store[1].GetPeaks().size());
+    CPPUNIT_ASSERT(store[2].GetPeaks().empty());
+    CPPUNIT_ASSERT(store[3].GetPeaks().empty());
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2SpectrumMetaDataStore)
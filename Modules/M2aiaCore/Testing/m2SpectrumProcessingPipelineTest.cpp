@@ -0,0 +1,90 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2Baseline.h>
+#include <signal/m2Smoothing.h>
+#include <signal/m2SpectrumProcessingPipeline.h>
+#include <signal/m2Transformer.h>
+#include <vector>
+
+class m2SpectrumProcessingPipelineTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2SpectrumProcessingPipelineTestSuite);
+  MITK_TEST(Process_AllStrategies_EqualsFunctorSequence);
+  CPPUNIT_TEST_SUITE_END();
+
+  std::vector<float> MakeSpectrum(unsigned int n, unsigned int seed)
+  {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> noise(0, 10);
+    std::vector<float> ys(n);
+    for (unsigned int i = 0; i < n; ++i)
+      ys[i] = noise(generator) + 100 * std::exp(-0.01f * (float(i) - n / 2.0f) * (float(i) - n / 2.0f)) + 0.05f * i;
+    return ys;
+  }
+
+public:
+  void Process_AllStrategies_EqualsFunctorSequence()
+  {
+    const m2::SmoothingType smoothings[] = {
+      m2::SmoothingType::None, m2::SmoothingType::Gaussian, m2::SmoothingType::SavitzkyGolay};
+    const m2::BaselineCorrectionType baselines[] = {
+      m2::BaselineCorrectionType::None, m2::BaselineCorrectionType::TopHat, m2::BaselineCorrectionType::Median};
+    const m2::IntensityTransformationType transformations[] = {m2::IntensityTransformationType::None,
+                                                                m2::IntensityTransformationType::Log10,
+                                                                m2::IntensityTransformationType::Log2,
+                                                                m2::IntensityTransformationType::SquareRoot};
+    // not representable in float: the pipeline has to divide by the norm rounded to float, as the functors do
+    const double norm = 0.3;
+
+    // one workspace for all spectra, which differ in length
+    m2::Signal::SpectrumProcessingPipeline<float>::Workspace workspace;
+    unsigned int seed = 0;
+    for (auto smoothing : smoothings)
+      for (auto baseline : baselines)
+        for (auto transformation : transformations)
+          for (unsigned int n : {37u, 250u, 101u})
+          {
+            m2::Signal::SmoothingFunctor<float> smoother;
+            m2::Signal::BaselineFunctor<float> baselineSubstractor;
+            m2::Signal::IntensityTransformationFunctor<float> transformer;
+            smoother.Initialize(smoothing, 4);
+            baselineSubstractor.Initialize(baseline, 10);
+            transformer.Initialize(transformation);
+            m2::Signal::SpectrumProcessingPipeline<float> pipeline;
+            pipeline.Initialize(smoothing, 4, baseline, 10, transformation);
+
+            auto expected = MakeSpectrum(n, ++seed);
+            auto ys = expected;
+            std::vector<float> baselineBuffer(n);
+            std::transform(
+              std::begin(expected), std::end(expected), std::begin(expected), [&](auto &v) { return v / float(norm); });
+            smoother(std::begin(expected), std::end(expected));
+            baselineSubstractor(std::begin(expected), std::end(expected), std::begin(baselineBuffer));
+            transformer(std::begin(expected), std::end(expected));
+
+            pipeline(ys.data(), ys.data() + ys.size(), norm, workspace);
+            CPPUNIT_ASSERT(ys == expected);
+          }
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2SpectrumProcessingPipeline)
@@ -0,0 +1,99 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2SpectrumReadPlan.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+
+class m2SpectrumReadPlanTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2SpectrumReadPlanTestSuite);
+  MITK_TEST(Build_SortsByOffsetAndMergesAdjacentRequests);
+  MITK_TEST(Build_SplitsAtGaps);
+  MITK_TEST(Build_SplitsAtMaxBlockSize);
+  MITK_TEST(Build_MergesOverlappingRequests);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void Build_SortsByOffsetAndMergesAdjacentRequests()
+  {
+    m2::SpectrumReadPlan plan;
+    plan.Add(0, 100, 10);
+    plan.Add(1, 0, 50);
+    plan.Add(2, 50, 50);
+    plan.Build();
+
+    const auto &requests = plan.GetRequests();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), requests.size());
+    CPPUNIT_ASSERT_EQUAL(std::uint32_t(1), requests[0].spectrum);
+    CPPUNIT_ASSERT_EQUAL(std::uint32_t(2), requests[1].spectrum);
+    CPPUNIT_ASSERT_EQUAL(std::uint32_t(0), requests[2].spectrum);
+
+    const auto &blocks = plan.GetBlocks();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), blocks.size());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(0), blocks[0].offset);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(110), blocks[0].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(size_t(0), blocks[0].firstRequest);
+    CPPUNIT_ASSERT_EQUAL(size_t(3), blocks[0].lastRequest);
+  }
+
+  void Build_SplitsAtGaps()
+  {
+    m2::SpectrumReadPlan plan;
+    plan.Add(0, 0, 10);
+    plan.Add(1, 110, 10); // gap of 100 bytes is merged
+    plan.Add(2, 221, 10); // gap of 101 bytes starts a new block
+    plan.Build(100, 1 << 20);
+
+    const auto &blocks = plan.GetBlocks();
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blocks.size());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(120), blocks[0].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blocks[0].lastRequest);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(221), blocks[1].offset);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(10), blocks[1].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blocks[1].firstRequest);
+  }
+
+  void Build_SplitsAtMaxBlockSize()
+  {
+    m2::SpectrumReadPlan plan;
+    plan.Add(0, 0, 60);
+    plan.Add(1, 60, 60);
+    plan.Add(2, 120, 500); // larger than the maximum block size
+    plan.Build(100, 100);
+
+    const auto &blocks = plan.GetBlocks();
+    CPPUNIT_ASSERT_EQUAL(size_t(3), blocks.size());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(60), blocks[0].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(60), blocks[1].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(500), blocks[2].numberOfBytes);
+  }
+
+  void Build_MergesOverlappingRequests()
+  {
+    m2::SpectrumReadPlan plan;
+    plan.Add(0, 0, 100);
+    plan.Add(1, 20, 10);
+    plan.Build();
+
+    const auto &blocks = plan.GetBlocks();
+    CPPUNIT_ASSERT_EQUAL(size_t(1), blocks.size());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t(100), blocks[0].numberOfBytes);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), blocks[0].lastRequest);
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2SpectrumReadPlan)
@@ -0,0 +1,131 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <m2Span.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <signal/m2PeakDetection.h>
+
+class m2SubrangeTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2SubrangeTestSuite);
+  MITK_TEST(Subrange_BoundsAreInclusive);
+  MITK_TEST(Subrange_RangeBetweenValues_IsEmpty);
+  MITK_TEST(Subrange_RangeBelowAxis_IsEmptyAtFront);
+  MITK_TEST(Subrange_RangeAboveAxis_IsEmptyAtBack);
+  MITK_TEST(Subrange_RangeCoversAxis_ReturnsAll);
+  MITK_TEST(Subrange_EmptyAxis_IsEmpty);
+  MITK_TEST(Subrange_LowerGreaterThanUpper_IsEmpty);
+  MITK_TEST(Subrange_SpanAndFloatAxis);
+  MITK_TEST(Subrange_WithHint_EqualsSubrange);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  using ResultType = std::pair<unsigned int, unsigned int>;
+  std::vector<double> m_Axis = {1.0, 2.0, 2.0, 3.0, 5.0, 8.0};
+
+  // Reference: linear scan counting all values within [lower, upper]
+  static ResultType LinearSubrange(const std::vector<float> &mzs, double lower, double upper)
+  {
+    unsigned int first = std::find_if(mzs.begin(), mzs.end(), [&](auto mz) { return mz >= lower; }) - mzs.begin();
+    unsigned int n = std::count_if(mzs.begin(), mzs.end(), [&](auto mz) { return mz >= lower && mz <= upper; });
+    return {first, n};
+  }
+
+public:
+  void Subrange_BoundsAreInclusive()
+  {
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 2.0, 3.0) == ResultType(1, 3));
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 1.0, 1.0) == ResultType(0, 1));
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 8.0, 8.0) == ResultType(5, 1));
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 1.5, 4.0) == ResultType(1, 3));
+  }
+
+  void Subrange_RangeBetweenValues_IsEmpty()
+  {
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 3.5, 4.5) == ResultType(4, 0));
+  }
+
+  void Subrange_RangeBelowAxis_IsEmptyAtFront()
+  {
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 0.0, 0.5) == ResultType(0, 0));
+  }
+
+  void Subrange_RangeAboveAxis_IsEmptyAtBack()
+  {
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 9.0, 10.0) == ResultType(6, 0));
+  }
+
+  void Subrange_RangeCoversAxis_ReturnsAll()
+  {
+    CPPUNIT_ASSERT(m2::Signal::Subrange(m_Axis, 0.0, 10.0) == ResultType(0, 6));
+  }
+
+  void Subrange_EmptyAxis_IsEmpty()
+  {
+    std::vector<double> empty;
+    CPPUNIT_ASSERT(m2::Signal::Subrange(empty, 1.0, 2.0) == ResultType(0, 0));
+    CPPUNIT_ASSERT(m2::Signal::Subrange(empty, 1.0, 2.0, ResultType(0, 0)) == ResultType(0, 0));
+  }
+
+  void Subrange_LowerGreaterThanUpper_IsEmpty()
+  {
+    CPPUNIT_ASSERT_EQUAL(0u, m2::Signal::Subrange(m_Axis, 4.0, 1.0).second);
+  }
+
+  void Subrange_SpanAndFloatAxis()
+  {
+    std::vector<float> axis(std::begin(m_Axis), std::end(m_Axis));
+    m2::Span<const float> view(axis.data(), axis.size());
+    CPPUNIT_ASSERT(m2::Signal::Subrange(view, 2.0, 3.0) == ResultType(1, 3));
+    CPPUNIT_ASSERT(m2::Signal::Subrange(view, 2.0, 3.0, ResultType(1, 0)) == ResultType(1, 3));
+  }
+
+  void Subrange_WithHint_EqualsSubrange()
+  {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(100.0, 1000.0);
+    std::vector<float> axis(5000);
+    for (auto &mz : axis)
+      mz = distribution(generator);
+    std::sort(std::begin(axis), std::end(axis));
+
+    // ascending ranges
+    ResultType hint(0, 0);
+    for (double mz = 90.0; mz < 1010.0; mz += 0.37)
+    {
+      const auto result = m2::Signal::Subrange(axis, mz - 0.2, mz + 0.2, hint);
+      CPPUNIT_ASSERT(result == m2::Signal::Subrange(axis, mz - 0.2, mz + 0.2));
+      CPPUNIT_ASSERT(result == LinearSubrange(axis, mz - 0.2, mz + 0.2));
+      hint = result;
+    }
+
+    // unsorted ranges and invalid hints fall back to a full search
+    for (int i = 0; i < 1000; ++i)
+    {
+      const auto mz = distribution(generator);
+      const auto result = m2::Signal::Subrange(axis, mz - 0.5, mz + 0.5, hint);
+      CPPUNIT_ASSERT(result == LinearSubrange(axis, mz - 0.5, mz + 0.5));
+      hint = result;
+    }
+    CPPUNIT_ASSERT(m2::Signal::Subrange(axis, 500.0, 501.0, ResultType(10000, 0)) ==
+                   m2::Signal::Subrange(axis, 500.0, 501.0));
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2Subrange)
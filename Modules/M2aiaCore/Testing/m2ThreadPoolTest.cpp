@@ -0,0 +1,124 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <m2Process.hpp>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <random>
+#include <stdexcept>
+
+class m2ThreadPoolTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2ThreadPoolTestSuite);
+  MITK_TEST(ParallelFor_VisitsEachIndexOnce);
+  MITK_TEST(Map_MoreThreadsThanElements_VisitsEachIndexOnce);
+  MITK_TEST(ParallelFor_Nested_Completes);
+  MITK_TEST(ParallelReduce_SumsAllIndices);
+  MITK_TEST(ParallelFor_Exception_IsRethrown);
+  MITK_TEST(ParallelSort_EqualsSort);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void ParallelFor_VisitsEachIndexOnce()
+  {
+    std::vector<int> visits(10007, 0);
+    m2::Process::ParallelFor(visits.size(),
+                             8,
+                             [&](unsigned int, unsigned int a, unsigned int b)
+                             {
+                               for (unsigned int i = a; i < b; ++i)
+                                 ++visits[i];
+                             });
+    for (auto v : visits)
+      CPPUNIT_ASSERT_EQUAL(1, v);
+  }
+
+  void Map_MoreThreadsThanElements_VisitsEachIndexOnce()
+  {
+    std::vector<int> visits(5, 0);
+    m2::Process::Map(visits.size(),
+                     16,
+                     [&](unsigned int, unsigned int a, unsigned int b)
+                     {
+                       for (unsigned int i = a; i < b; ++i)
+                         ++visits[i];
+                     });
+    for (auto v : visits)
+      CPPUNIT_ASSERT_EQUAL(1, v);
+  }
+
+  void ParallelFor_Nested_Completes()
+  {
+    std::atomic<unsigned int> count{0};
+    m2::Process::ParallelFor(64,
+                             8,
+                             [&](unsigned int, unsigned int a, unsigned int b)
+                             {
+                               for (unsigned int i = a; i < b; ++i)
+                                 m2::Process::ParallelFor(
+                                   100, 8, [&](unsigned int, unsigned int c, unsigned int d) { count += d - c; });
+                             });
+    CPPUNIT_ASSERT_EQUAL(6400u, count.load());
+  }
+
+  void ParallelReduce_SumsAllIndices()
+  {
+    const auto sum = m2::Process::ParallelReduce(
+      100000ul,
+      7,
+      0ull,
+      [](unsigned long long &acc, unsigned int a, unsigned int b)
+      {
+        for (unsigned int i = a; i < b; ++i)
+          acc += i;
+      },
+      std::plus<>());
+    CPPUNIT_ASSERT_EQUAL(4999950000ull, sum);
+  }
+
+  void ParallelFor_Exception_IsRethrown()
+  {
+    CPPUNIT_ASSERT_THROW(m2::Process::ParallelFor(100,
+                                                  4,
+                                                  [](unsigned int, unsigned int a, unsigned int)
+                                                  {
+                                                    if (a > 50)
+                                                      throw std::runtime_error("worker failed");
+                                                  }),
+                         std::runtime_error);
+  }
+
+  void ParallelSort_EqualsSort()
+  {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> distribution(0, 1000);
+    for (unsigned int threads : {1u, 3u, 8u})
+      for (std::size_t n : {std::size_t(0), std::size_t(5), std::size_t(10007)})
+      {
+        std::vector<int> values(n);
+        for (auto &v : values)
+          v = distribution(generator);
+        auto expected = values;
+        std::sort(expected.begin(), expected.end());
+        m2::Process::ParallelSort(values.begin(), values.end(), threads, std::less<int>());
+        CPPUNIT_ASSERT(values == expected);
+      }
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2ThreadPool)
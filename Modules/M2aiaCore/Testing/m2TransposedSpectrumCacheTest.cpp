@@ -0,0 +1,145 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cstdio>
+#include <fstream>
+#include <m2TransposedSpectrumCache.h>
+#include <mitkExceptionMacro.h>
+#include <mitkIOUtil.h>
+#include <mitkTestFixture.h>
+#include <mitkTestingMacros.h>
+#include <numeric>
+#include <vector>
+
+class m2TransposedSpectrumCacheTestSuite : public mitk::TestFixture
+{
+  CPPUNIT_TEST_SUITE(m2TransposedSpectrumCacheTestSuite);
+  MITK_TEST(WriteAndOpen_ValuesAreTransposed);
+  MITK_TEST(Open_IncompleteCache_ReturnsNullptr);
+  MITK_TEST(Open_DifferentKey_ReturnsNullptr);
+  MITK_TEST(WriteAndOpen_Double_KeepsPrecision);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  std::string m_BinaryDataPath;
+  std::string m_CachePath;
+
+  // 5 spectra with 3 bins; value of pixel p and bin b is p * 3 + b
+  std::vector<float> m_Values = std::vector<float>(15);
+
+public:
+  void setUp() override
+  {
+    std::ofstream f;
+    m_BinaryDataPath = mitk::IOUtil::CreateTemporaryFile(f, "m2TransposedSpectrumCacheTest_XXXXXX.ibd");
+    f << "binary data";
+    f.close();
+    m_CachePath = m2::TransposedSpectrumCache::GetDefaultPath(m_BinaryDataPath);
+    std::iota(std::begin(m_Values), std::end(m_Values), 0.0f);
+  }
+
+  void tearDown() override
+  {
+    std::remove(m_CachePath.c_str());
+    std::remove(m_BinaryDataPath.c_str());
+  }
+
+  void WriteAndOpen_ValuesAreTransposed()
+  {
+    const auto key = m2::TransposedSpectrumCache::MakeKey(m_BinaryDataPath, 5, 3, 0);
+    {
+      auto cache = m2::TransposedSpectrumCache::Create(m_CachePath, key);
+      cache->Write(0, 2, m_Values.data());
+      cache->Write(2, 3, m_Values.data() + 6);
+      cache->Finalize();
+      CPPUNIT_ASSERT(cache->IsComplete());
+    }
+
+    auto cache = m2::TransposedSpectrumCache::Open(m_CachePath, key);
+    CPPUNIT_ASSERT(cache);
+    CPPUNIT_ASSERT(!cache->HoldsProcessedData());
+    for (unsigned int bin = 0; bin < 3; ++bin)
+    {
+      const auto values = cache->GetBin(bin);
+      CPPUNIT_ASSERT_EQUAL(std::size_t(5), std::size_t(values.size()));
+      for (unsigned int pixel = 0; pixel < 5; ++pixel)
+        CPPUNIT_ASSERT_EQUAL(float(pixel * 3 + bin), values[pixel]);
+    }
+
+    const auto block = cache->GetBins(1, 2);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(10), std::size_t(block.size()));
+    CPPUNIT_ASSERT_EQUAL(13.0f, block[4]);
+    CPPUNIT_ASSERT_EQUAL(14.0f, block[9]);
+  }
+
+  void Open_IncompleteCache_ReturnsNullptr()
+  {
+    const auto key = m2::TransposedSpectrumCache::MakeKey(m_BinaryDataPath, 5, 3, 0);
+    auto cache = m2::TransposedSpectrumCache::Create(m_CachePath, key);
+    cache->Write(0, 5, m_Values.data());
+    CPPUNIT_ASSERT(!m2::TransposedSpectrumCache::Open(m_CachePath, key));
+    CPPUNIT_ASSERT_THROW(cache->Write(3, 5, m_Values.data()), mitk::Exception);
+  }
+
+  void Open_DifferentKey_ReturnsNullptr()
+  {
+    auto key = m2::TransposedSpectrumCache::MakeKey(m_BinaryDataPath, 5, 3, 0);
+    auto cache = m2::TransposedSpectrumCache::Create(m_CachePath, key);
+    cache->Write(0, 5, m_Values.data());
+    cache->Finalize();
+
+    auto processedKey = key;
+    processedKey.ProcessingHash = 42;
+    CPPUNIT_ASSERT(!m2::TransposedSpectrumCache::Open(m_CachePath, processedKey));
+
+    auto modifiedKey = key;
+    modifiedKey.SourceFileSize += 1;
+    CPPUNIT_ASSERT(!m2::TransposedSpectrumCache::Open(m_CachePath, modifiedKey));
+    CPPUNIT_ASSERT(m2::TransposedSpectrumCache::Open(m_CachePath, key));
+
+    // a cache of double values is a different cache
+    auto doubleKey = key;
+    doubleKey.ValueSize = sizeof(double);
+    CPPUNIT_ASSERT(!m2::TransposedSpectrumCache::Open(m_CachePath, doubleKey));
+  }
+
+  void WriteAndOpen_Double_KeepsPrecision()
+  {
+    // not representable as float
+    std::vector<double> values(15);
+    for (unsigned int i = 0; i < values.size(); ++i)
+      values[i] = 1.0 + i * 1e-12;
+
+    const auto key = m2::TransposedSpectrumCache::MakeKey(m_BinaryDataPath, 5, 3, 0, sizeof(double));
+    {
+      auto cache = m2::TransposedSpectrumCache::Create(m_CachePath, key);
+      CPPUNIT_ASSERT_THROW(cache->Write(0, 5, m_Values.data()), mitk::Exception);
+      cache->Write(0, 5, values.data());
+      cache->Finalize();
+    }
+
+    auto cache = m2::TransposedSpectrumCache::Open(m_CachePath, key);
+    CPPUNIT_ASSERT(cache);
+    for (unsigned int bin = 0; bin < 3; ++bin)
+    {
+      const auto column = cache->GetBin<double>(bin);
+      for (unsigned int pixel = 0; pixel < 5; ++pixel)
+        CPPUNIT_ASSERT_EQUAL(values[pixel * 3 + bin], column[pixel]);
+    }
+  }
+};
+
+MITK_TEST_SUITE_REGISTRATION(m2TransposedSpectrumCache)
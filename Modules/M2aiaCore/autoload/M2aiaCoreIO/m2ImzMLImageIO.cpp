@@ -42,6 +42,20 @@ void writeData(ItFirst itFirst, ItLast itLast, OStreamType &os)
                 });
 }
 
+namespace
+{
+  /**
+   * @brief Spectra are read one by one in the order of their ids. Every ReadAheadSpectra spectra, the operating
+   * system is advised to load the binary data of the following spectra.
+   */
+  void ReadAhead(const m2::ImzMLSpectrumImage *input, unsigned int id, unsigned int sourceId)
+  {
+    constexpr unsigned int ReadAheadSpectra = 256;
+    if (id % ReadAheadSpectra == 0)
+      input->PrefetchSpectra(id, 2 * ReadAheadSpectra, sourceId);
+  }
+} // namespace
+
 namespace m2
 {
   ImzMLImageIO::ImzMLImageIO() : AbstractFileIO(mitk::Image::GetStaticNameOfClass(), IMZML_MIMETYPE(), "imzML Image")
@@ -157,8 +171,8 @@ namespace m2
     // write mzs
     {
       auto &source = sourceList.front();
-      // input->GetSpectrum(0, mzs, ints, sourceId); // get x axis
-      // bounds = {0, mzs.size()};
+      input->GetSpectrum(0, mzs, ints, sourceId); // get x axis
+      bounds = {0, mzs.size()};
       // image properties
       auto useLimits = input->GetExportSpectrumType().UseLimits;
 
@@ -170,11 +184,11 @@ namespace m2
         bounds = m2::Signal::Subrange(mzs, xLimMin, xLimMax);
       }
 
-      source.m_Spectra[0].mzOffset = 16;
-      source.m_Spectra[0].mzLength = bounds.second;
+      source.m_Spectra[0].SetMzOffset(16);
+      source.m_Spectra[0].SetMzLength(bounds.second);
 
       auto start = std::begin(mzs) + bounds.first;
-      auto end = std::end(mzs) + bounds.first + bounds.second;
+      auto end = std::begin(mzs) + bounds.first + bounds.second;
       switch (input->GetExportSpectrumType().XAxisType)
       {
         case m2::NumericType::Float:
@@ -197,20 +211,21 @@ namespace m2
     {
       for (size_t id = 0; id < source.m_Spectra.size(); ++id)
       {
-        auto &s = source.m_Spectra[id];
+        auto s = source.m_Spectra[id];
         // update mz axis info
-        s.mzLength = sourceList.front().m_Spectra[0].mzLength;
-        s.mzOffset = sourceList.front().m_Spectra[0].mzOffset;
+        s.SetMzLength(sourceList.front().m_Spectra[0].GetMzLength());
+        s.SetMzOffset(sourceList.front().m_Spectra[0].GetMzOffset());
 
         // write ints
         {
+          ReadAhead(input, id, sourceId);
           input->GetSpectrum(id, mzs, ints, sourceId);
 
-          s.intOffset = offset;
-          s.intLength = bounds.second;
+          s.SetIntOffset(offset);
+          s.SetIntLength(bounds.second);
 
           auto start = std::begin(ints) + bounds.first;
-          auto end = std::end(ints) + bounds.first + bounds.second;
+          auto end = std::begin(ints) + bounds.first + bounds.second;
 
           switch (input->GetExportSpectrumType().YAxisType)
           {
@@ -265,18 +280,18 @@ namespace m2
       mzs = mzsMasked;
 
       // update source spectra meta data to its actual values
-      source.m_Spectra[0].mzOffset = 16;
-      source.m_Spectra[0].mzLength = mzs.size();
+      source.m_Spectra[0].SetMzOffset(16);
+      source.m_Spectra[0].SetMzLength(mzs.size());
 
       switch (input->GetExportSpectrumType().XAxisType)
       {
         case m2::NumericType::Float:
           writeData<float>(std::begin(mzs), std::end(mzs), b);
-          offsetDelta = source.m_Spectra[0].mzLength * sizeof(float);
+          offsetDelta = source.m_Spectra[0].GetMzLength() * sizeof(float);
           break;
         case m2::NumericType::Double:
           writeData<double>(std::begin(mzs), std::end(mzs), b);
-          offsetDelta = source.m_Spectra[0].mzLength * sizeof(double);
+          offsetDelta = source.m_Spectra[0].GetMzLength() * sizeof(double);
           break;
       }
       offset += offsetDelta;
@@ -289,15 +304,17 @@ namespace m2
     {
       for (size_t id = 0; id < source.m_Spectra.size(); ++id)
       {
-        auto &s = source.m_Spectra[id];
+        auto s = source.m_Spectra[id];
         // update mz axis info
-        s.mzLength = sourceList.front().m_Spectra[0].mzLength;
-        s.mzOffset = sourceList.front().m_Spectra[0].mzOffset;
+        s.SetMzLength(sourceList.front().m_Spectra[0].GetMzLength());
+        s.SetMzOffset(sourceList.front().m_Spectra[0].GetMzOffset());
 
         // write ints
         {
+          ReadAhead(input, id, sourceId);
           input->GetSpectrum(id, mzs, ints, sourceId);
 
+          std::pair<unsigned int, unsigned int> subRes = {0, 0};
           for (auto p : massIndicesMask)
           {
             auto i = p.GetIndex();
@@ -309,7 +326,7 @@ namespace m2
             else
             {
               auto tol = input->ApplyTolerance(mzs[i]);
-              auto subRes = m2::Signal::Subrange(mzs, mzs[i] - tol, mzs[i] + tol);
+              subRes = m2::Signal::Subrange(mzs, mzs[i] - tol, mzs[i] + tol, subRes);
               auto s = std::next(std::begin(ints), subRes.first);
               auto e = std::next(s, subRes.second);
 
@@ -321,18 +338,18 @@ namespace m2
           ints = std::move(intsMasked);
           intsMasked.clear();
 
-          s.intOffset = offset;
-          s.intLength = ints.size();
+          s.SetIntOffset(offset);
+          s.SetIntLength(ints.size());
 
           switch (input->GetExportSpectrumType().YAxisType)
           {
             case m2::NumericType::Float:
               writeData<float>(std::begin(ints), std::end(ints), b);
-              offsetDelta = s.intLength * sizeof(float);
+              offsetDelta = s.GetIntLength() * sizeof(float);
               break;
             case m2::NumericType::Double:
               writeData<double>(std::begin(ints), std::end(ints), b);
-              offsetDelta = s.intLength * sizeof(double);
+              offsetDelta = s.GetIntLength() * sizeof(double);
               break;
           }
 
@@ -375,28 +392,32 @@ namespace m2
 
         for (unsigned int spectrumId = 0; spectrumId < source.m_Spectra.size(); ++spectrumId)
         {
-          const auto &peaks = source.m_Spectra[spectrumId].peaks;
+          // view into the peak matrix of the source
+          const auto peaks = source.m_Spectra[spectrumId].GetPeaks();
           xs.reserve(peaks.size());
           ys.reserve(peaks.size());
           // update source spectra meta data to its actual values
-          source.m_Spectra[spectrumId].mzOffset = offset;
-          source.m_Spectra[spectrumId].mzLength = peaks.size();
+          source.m_Spectra[spectrumId].SetMzOffset(offset);
+          source.m_Spectra[spectrumId].SetMzLength(peaks.size());
           xs.clear();
           ys.clear();
 
+          ReadAhead(input, spectrumId, sourceId);
           input->GetSpectrum(spectrumId, mzs, ints, sourceId);
 
-          for (const auto &p : peaks)
+          std::pair<unsigned int, unsigned int> subRes = {0, 0};
+          for (std::size_t i = 0; i < peaks.size(); ++i)
           {
-            xs.push_back(p.GetX());
+            const double mz = peaks.mzs[i];
+            xs.push_back(mz);
             if (input->GetTolerance() == 0)
             {
-              ys.push_back(p.GetY());
+              ys.push_back(peaks.intensities[i]);
             }
             else
             {
-              const auto tol = input->ApplyTolerance(mzs[p.GetIndex()]);
-              const auto subRes = m2::Signal::Subrange(mzs, mzs[p.GetIndex()] - tol, mzs[p.GetIndex()] + tol);
+              const auto tol = input->ApplyTolerance(mz);
+              subRes = m2::Signal::Subrange(mzs, mz - tol, mz + tol, subRes);
               const auto s = next(begin(ints), subRes.first);
               const auto e = next(s, subRes.second);
 
@@ -416,8 +437,8 @@ namespace m2
               break;
           }
           offset += offsetDelta;
-          source.m_Spectra[spectrumId].intOffset = offset;
-          source.m_Spectra[spectrumId].intLength = peaks.size();
+          source.m_Spectra[spectrumId].SetIntOffset(offset);
+          source.m_Spectra[spectrumId].SetIntLength(peaks.size());
 
           switch (input->GetExportSpectrumType().YAxisType)
           {
@@ -612,28 +633,28 @@ namespace m2
       {
         MITK_INFO << "Write imzML data ...";
         boost::progress_display show_progress(source.m_Spectra.size());
-        for (auto &s : source.m_Spectra)
+        for (const auto s : source.m_Spectra)
         {
-          auto x = s.index[0] + source.m_Offset[0] + 1; // start by 1
-          auto y = s.index[1] + source.m_Offset[1] + 1; // start by 1
-          auto z = s.index[2] + source.m_Offset[2] + 1; // start by 1
+          auto x = s.GetIndex()[0] + source.m_Offset[0] + 1; // start by 1
+          auto y = s.GetIndex()[1] + source.m_Offset[1] + 1; // start by 1
+          auto z = s.GetIndex()[2] + source.m_Offset[2] + 1; // start by 1
 
           context = {{"index", std::to_string(id++)},
                      {"x", std::to_string(x)},
                      {"y", std::to_string(y)},
                      {"z", std::to_string(z)},
-                     {"mz_len", std::to_string(s.mzLength)},
-                     {"mz_enc_len", std::to_string(s.mzLength * mzBytes)},
-                     {"mz_offset", std::to_string(s.mzOffset)},
-                     {"int_len", std::to_string(s.intLength)},
-                     {"int_enc_len", std::to_string(s.intLength * intBytes)},
-                     {"int_offset", std::to_string(s.intOffset)}};
+                     {"mz_len", std::to_string(s.GetMzLength())},
+                     {"mz_enc_len", std::to_string(s.GetMzLength() * mzBytes)},
+                     {"mz_offset", std::to_string(s.GetMzOffset())},
+                     {"int_len", std::to_string(s.GetIntLength())},
+                     {"int_enc_len", std::to_string(s.GetIntLength() * intBytes)},
+                     {"int_offset", std::to_string(s.GetIntOffset())}};
 
           auto nonConst_input = const_cast<m2::ImzMLSpectrumImage *>(input);
           mitk::ImagePixelReadAccessor<m2::NormImagePixelType> nacc(nonConst_input->GetNormalizationImage());
-          if (nacc.GetPixelByIndex(s.index + source.m_Offset) != 1)
+          if (nacc.GetPixelByIndex(s.GetIndex() + source.m_Offset) != 1)
           {
-            context["tic"] = std::to_string(nacc.GetPixelByIndex(s.index + source.m_Offset));
+            context["tic"] = std::to_string(nacc.GetPixelByIndex(s.GetIndex() + source.m_Offset));
           }
           f << m2::TemplateEngine::render(view, context);
           f.flush();
@@ -732,7 +753,7 @@ namespace m2
     auto pathWithoutExtension = this->GetInputLocation();
     itksys::SystemTools::ReplaceString(pathWithoutExtension, ".imzML", "");
 
-    auto source = object->GetImzMLSpectrumImageSource();
+    auto &source = object->GetImzMLSpectrumImageSource();
 
     if (itksys::SystemTools::FileExists(pathWithoutExtension + ".nrrd"))
     {
@@ -40,6 +40,7 @@ extern "C"
   M2AIACOREIO_EXPORT void GetImageArrayFloat32(m2::sys::ImageHandle *handle, double mz, double tol, float *data)
   {
     handle->m_Image->GetImage(mz, tol, nullptr, handle->m_Image);
+    handle->m_Image->SetCurrentIonImageRange(mz, tol);
     auto w = handle->m_Image->GetDimension(0);
     auto h = handle->m_Image->GetDimension(1);
     mitk::ImageReadAccessor acc(handle->m_Image.GetPointer());
@@ -51,6 +52,7 @@ extern "C"
   M2AIACOREIO_EXPORT void GetImageArrayFloat64(m2::sys::ImageHandle *handle, double mz, double tol, double *data)
   {
     handle->m_Image->GetImage(mz, tol, nullptr, handle->m_Image);
+    handle->m_Image->SetCurrentIonImageRange(mz, tol);
     auto w = handle->m_Image->GetDimension(0);
     auto h = handle->m_Image->GetDimension(1);
     mitk::ImageReadAccessor acc(handle->m_Image.GetPointer());
@@ -100,39 +102,38 @@ extern "C"
 
   M2AIACOREIO_EXPORT void GetSpectrum(m2::sys::ImageHandle *handle, unsigned int id, float *xd, float *yd)
   {
-    std::vector<float> xs, ys;
-    handle->m_Image->GetSpectrum(id, xs, ys);
-    std::copy(xs.begin(), xs.end(), xd);
-    std::copy(ys.begin(), ys.end(), yd);
+    const auto spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[id];
+    handle->m_Image->GetSpectrum(
+      id, m2::Span<float>(xd, spectrum.GetMzLength()), m2::Span<float>(yd, spectrum.GetIntLength()));
   }
 
   M2AIACOREIO_EXPORT void GetSpectra(m2::sys::ImageHandle *handle, unsigned int * id, unsigned int N, float *yd)
   {
-    std::vector<float> ys;
+    const auto &spectra = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra;
     for(unsigned int i = 0 ; i < N; ++i){
-      handle->m_Image->GetIntensities(id[i], ys);
-      std::copy(ys.begin(), ys.end(), yd + i*ys.size());
+      const auto length = spectra[id[i]].GetIntLength();
+      handle->m_Image->GetIntensities(id[i], m2::Span<float>(yd, length));
+      yd += length;
     }
   }
 
   M2AIACOREIO_EXPORT void GetIntensities(m2::sys::ImageHandle *handle, unsigned int id, float *yd)
   {
-    std::vector<float> ys;
-    handle->m_Image->GetIntensities(id, ys);
-    std::copy(ys.begin(), ys.end(), yd);
+    const auto spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[id];
+    handle->m_Image->GetIntensities(id, m2::Span<float>(yd, spectrum.GetIntLength()));
   }
 
   M2AIACOREIO_EXPORT unsigned int  GetSpectrumDepth(m2::sys::ImageHandle *handle, unsigned int id)
   {
-    const auto & spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[id];
-    return spectrum.mzLength;
+    const auto spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[id];
+    return spectrum.GetMzLength();
   }
 
   M2AIACOREIO_EXPORT void GetSpectrumPosition(m2::sys::ImageHandle *handle, unsigned int spectrumId, unsigned int *pixelPosition)
   {
-    auto &spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[spectrumId];
-    auto *p = spectrum.index.GetIndex();
-    std::copy(p, p + 3, pixelPosition);
+    const auto spectrum = handle->m_Image->GetImzMLSpectrumImageSource().m_Spectra[spectrumId];
+    const auto index = spectrum.GetIndex();
+    std::copy(index.GetIndex(), index.GetIndex() + 3, pixelPosition);
   }
 
   M2AIACOREIO_EXPORT unsigned int GetNumberOfSpectra(m2::sys::ImageHandle *handle)
@@ -7,9 +7,24 @@ set(H_FILES
   include/m2SpectrumImageDataInteractor.h
 
   include/m2IonImageReference.h
+  include/m2BinaryDataPrefetcher.h
+  include/m2CancellationToken.h
+  include/m2FileStreamPool.h
   include/m2ImzMLSpectrumImage.h
   include/m2ImzMLParser.h
+  include/m2ImzMLMetaDataCache.h
+  include/m2InvertedMzIndex.h
+  include/m2IonImageCache.h
+  include/m2IonImageRequestScheduler.h
+  include/m2MemoryMappedFile.h
+  include/m2PeakMatrix.h
+  include/m2Span.h
+  include/m2SpectrumCache.h
+  include/m2SpectrumMetaDataStore.h
+  include/m2SpectrumReadPlan.h
+  include/m2TransposedSpectrumCache.h
   include/m2FsmSpectrumImage.h
+  include/m2ThreadPool.h
   include/m2Timer.h
   include/m2SpectrumInfo.h
 
@@ -23,11 +38,13 @@ set(H_FILES
   include/signal/m2Morphology.h
   include/signal/m2Normalization.h
   include/signal/m2Binning.h
+  include/signal/m2Convolution.h
   include/signal/m2PeakDetection.h
   include/signal/m2Pooling.h
   include/signal/m2RunningMedian.h
   include/signal/m2SignalCommon.h
   include/signal/m2Smoothing.h
+  include/signal/m2SpectrumProcessingPipeline.h
   include/signal/m2Transformer.h
 )
 
@@ -38,8 +55,20 @@ set(CPP_FILES
   m2CoreObjectFactory.cpp  
   m2ElxUtil.cpp
   m2ElxRegistrationHelper.cpp
+  m2BinaryDataPrefetcher.cpp
+  m2FileStreamPool.cpp
+  m2ImzMLMetaDataCache.cpp
   m2ImzMLParser.cpp
+  m2InvertedMzIndex.cpp
+  m2IonImageCache.cpp
+  m2IonImageRequestScheduler.cpp
   m2ImzMLSpectrumImage.cpp
+  m2MemoryMappedFile.cpp
+  m2SpectrumCache.cpp
+  m2SpectrumMetaDataStore.cpp
+  m2SpectrumReadPlan.cpp
+  m2ThreadPool.cpp
+  m2TransposedSpectrumCache.cpp
   m2FsmSpectrumImage.cpp
   m2SubdivideImage2DFilter.cpp
   m2SpectrumImageDataInteractor.cpp
@@ -0,0 +1,89 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <m2SpectrumReadPlan.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Reads the blocks of a read plan ahead of their use.
+   *
+   * An I/O thread reads the blocks in plan order into a pool of recycled buffers, while the consumer processes
+   * the blocks read before (see Next()). The pool holds as many buffers as the largest block fits into memoryLimit,
+   * but at least two. Where available, the operating system is advised to read the following block in advance.
+   * The plan must outlive the prefetcher.
+   */
+  class M2AIACORE_EXPORT BinaryDataPrefetcher
+  {
+  public:
+    /**
+     * @brief Opens the file and starts reading. Throws mitk::Exception if the file can not be opened.
+     */
+    BinaryDataPrefetcher(const std::string &path, const SpectrumReadPlan &plan, std::uint64_t memoryLimit);
+    ~BinaryDataPrefetcher();
+
+    BinaryDataPrefetcher(const BinaryDataPrefetcher &) = delete;
+    BinaryDataPrefetcher &operator=(const BinaryDataPrefetcher &) = delete;
+
+    /**
+     * @brief Waits for the next block in plan order and returns its data, which is valid until the next call.
+     * Must be called once per block. Throws mitk::Exception if the block could not be read.
+     */
+    const char *Next();
+
+    /**
+     * @brief Advises the operating system that the blocks of plan are read soon. Has no effect if not supported.
+     */
+    static void WillNeed(const std::string &path, const SpectrumReadPlan &plan) noexcept;
+
+  private:
+    static constexpr std::size_t NoBuffer = std::size_t(-1);
+
+    void Run();
+    bool ReadBlock(const SpectrumReadPlan::Block &block, char *dst);
+
+    const SpectrumReadPlan &m_Plan;
+    std::string m_Path;
+    std::vector<std::vector<char>> m_Buffers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<std::size_t> m_FreeBuffers;
+    std::deque<std::size_t> m_ReadyBuffers; // in plan order
+    std::size_t m_CurrentBuffer = NoBuffer; // held by the consumer
+    std::size_t m_NumberOfConsumedBlocks = 0;
+    bool m_Failed = false;
+    bool m_Stop = false;
+
+#ifdef _WIN32
+    std::ifstream m_Stream;
+#else
+    int m_FileDescriptor = -1;
+#endif
+    std::thread m_Thread;
+  };
+
+} // namespace m2
@@ -0,0 +1,73 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <atomic>
+#include <memory>
+#include <mitkExceptionMacro.h>
+
+namespace m2
+{
+  /**
+   * @brief Thrown by operations that stopped because their cancellation token was cancelled.
+   */
+  class M2AIACORE_EXPORT OperationCanceledException : public mitk::Exception
+  {
+  public:
+    mitkExceptionClassMacro(OperationCanceledException, mitk::Exception);
+  };
+
+  /**
+   * @brief Allows to cancel a running operation. Copies share their state.
+   *
+   * The operation checks the token in regular intervals (see ThrowIfCancelled()); cancellation is cooperative
+   * and takes effect at the next check. A default constructed token is never cancelled.
+   */
+  class CancellationToken
+  {
+  public:
+    CancellationToken() = default;
+
+    static CancellationToken Create()
+    {
+      CancellationToken token;
+      token.m_Cancelled = std::make_shared<std::atomic<bool>>(false);
+      return token;
+    }
+
+    void Cancel() const noexcept
+    {
+      if (m_Cancelled)
+        *m_Cancelled = true;
+    }
+
+    bool IsCancelled() const noexcept { return m_Cancelled && m_Cancelled->load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Throws m2::OperationCanceledException if the token was cancelled.
+     */
+    void ThrowIfCancelled() const
+    {
+      if (IsCancelled())
+        mitkThrowException(m2::OperationCanceledException) << "The operation was cancelled.";
+    }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> m_Cancelled;
+  };
+
+} // namespace m2
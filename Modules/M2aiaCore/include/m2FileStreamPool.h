@@ -0,0 +1,59 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Open binary input streams of a file, shared by the threads reading it.
+   *
+   * A stream is used by one reader at a time: Acquire() hands out an idle stream or opens a new one, Release()
+   * returns it for reuse. All streams are closed when the pool is destroyed, so the file is not kept open beyond
+   * the lifetime of its owner.
+   */
+  class M2AIACORE_EXPORT FileStreamPool
+  {
+  public:
+    using StreamPointer = std::unique_ptr<std::ifstream>;
+
+    explicit FileStreamPool(const std::string &path) : m_Path(path) {}
+
+    FileStreamPool(const FileStreamPool &) = delete;
+    FileStreamPool &operator=(const FileStreamPool &) = delete;
+
+    const std::string &GetPath() const noexcept { return m_Path; }
+
+    /**
+     * @brief Stream for exclusive use by the caller. Throws mitk::Exception if the file can not be opened.
+     */
+    StreamPointer Acquire();
+
+    void Release(StreamPointer stream) noexcept;
+
+  private:
+    std::string m_Path;
+    std::mutex m_Mutex;
+    std::vector<StreamPointer> m_Streams; // idle streams
+  };
+
+} // namespace m2
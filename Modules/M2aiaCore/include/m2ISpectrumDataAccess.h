@@ -15,6 +15,7 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <functional>
 #include <vector>
 
 namespace mitk
@@ -24,6 +25,21 @@ namespace mitk
 
 namespace m2
 {
+  /**
+   * @brief A range on the spectral axis given by its center and tolerance, as used for ion image generation.
+   */
+  struct IonImageRange
+  {
+    double mz;
+    double tol;
+  };
+
+  /**
+   * @brief Called by progressive ion image generation after each coarse pass (pass = 1 .. numberOfPasses - 1).
+   * The image then holds a preview in which missing pixels repeat the value of a computed neighbour.
+   */
+  using ImageRefinementCallback = std::function<void(unsigned int pass, unsigned int numberOfPasses)>;
+
   class M2AIACORE_EXPORT ISpectrumDataAccess
   {
   public:
@@ -0,0 +1,81 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <array>
+#include <cstdint>
+#include <m2ImzMLSpectrumImage.h>
+#include <m2MemoryMappedFile.h>
+#include <string>
+
+namespace m2
+{
+  /**
+   * @brief Sidecar file holding the parsed spectrum meta data (binary offsets and lengths, pixel indices,
+   * world positions and normalization factors) of an imzML file.
+   *
+   * Reopening an imzML file with a valid sidecar skips parsing the spectrumList of the XML.
+   * A sidecar is valid if the size and modification time of the imzML file match. If only the modification
+   * time differs (e.g. the file was copied), the SHA-1 of the imzML file is compared instead; if it matches, the
+   * sidecar is rewritten with the new modification time.
+   */
+  class M2AIACORE_EXPORT ImzMLMetaDataCache
+  {
+  public:
+    using SHA1Type = std::array<unsigned char, 20>;
+
+    /**
+     * @brief Identifies the imzML file a sidecar was created for.
+     */
+    struct Key
+    {
+      std::uint64_t SourceFileSize = 0;
+      std::int64_t SourceModificationTime = 0;
+      SHA1Type SourceSHA1 = {};
+    };
+
+    static std::string GetDefaultPath(const std::string &imzMLDataPath) { return imzMLDataPath + ".m2meta"; }
+
+    /**
+     * @brief Creates a key for the given (mapped) imzML file; the SHA-1 of the whole file is computed.
+     */
+    static Key MakeKey(const MemoryMappedFile &imzMLFile);
+
+    static SHA1Type ComputeSHA1(const char *data, std::uint64_t numberOfBytes);
+
+    /**
+     * @brief Reads the spectrum meta data from the sidecar at path. Returns false if the file does not exist,
+     * has a different version or does not belong to the imzML file at imzMLDataPath.
+     * sciLs3DTagUsed is set if the z positions were given by SCiLS specific 3DPositionZ tags.
+     */
+    static bool Read(const std::string &path,
+                     const std::string &imzMLDataPath,
+                     ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                     bool &sciLs3DTagUsed);
+
+    /**
+     * @brief Writes the spectrum meta data to the sidecar at path. The file is written to a uniquely named temporary
+     * file first and renamed afterwards, so readers never see an incomplete sidecar.
+     * Throws mitk::Exception if the file can not be written.
+     */
+    static void Write(const std::string &path,
+                      const Key &key,
+                      const ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                      bool sciLs3DTagUsed);
+  };
+
+} // namespace m2
@@ -16,11 +16,16 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <m2FileStreamPool.h>
+#include <m2InvertedMzIndex.h>
+#include <m2MemoryMappedFile.h>
 #include <m2SpectrumImageBase.h>
-#include <signal/m2Baseline.h>
-#include <signal/m2Smoothing.h>
-#include <signal/m2Transformer.h>
+#include <m2SpectrumMetaDataStore.h>
+#include <m2TransposedSpectrumCache.h>
+#include <signal/m2SpectrumProcessingPipeline.h>
 #include <m2SpectrumImageProcessor.h>
+#include <memory>
+#include <mutex>
 
 namespace m2
 {
@@ -38,33 +43,97 @@ namespace m2
     itkSetEnumMacro(ImageAccessInitialized, bool);
     itkGetEnumMacro(ImageAccessInitialized, bool);
 
-    using BinaryDataOffsetType = unsigned long long;
-    using BinaryDataLengthType = unsigned long;
+    /**
+     * @brief If enabled, the *.ibd file of each source is memory mapped on InitializeImageAccess
+     * and spectra are read directly from the mapping. Falls back to file streams if mapping fails.
+     */
+    itkGetConstMacro(UseMemoryMappedBinaryData, bool);
+    itkSetMacro(UseMemoryMappedBinaryData, bool);
+    itkBooleanMacro(UseMemoryMappedBinaryData);
+
+    /**
+     * @brief If enabled, a transposed (m/z-major) copy of continuous profile spectra is kept in a sidecar file
+     * next to the *.ibd file (see m2::TransposedSpectrumCache). It is created on InitializeImageAccess if no
+     * valid cache exists and is used by GetImage, which then reads one contiguous block per ion image.
+     */
+    itkGetConstMacro(UseTransposedCache, bool);
+    itkSetMacro(UseTransposedCache, bool);
+    itkBooleanMacro(UseTransposedCache);
+
+    /**
+     * @brief If enabled, the transposed cache holds normalized and processed (smoothing, baseline correction,
+     * intensity transformation) intensities. Otherwise raw intensities are stored, which are only used
+     * if no signal processing is selected.
+     */
+    itkGetConstMacro(TransposedCacheHoldsProcessedData, bool);
+    itkSetMacro(TransposedCacheHoldsProcessedData, bool);
+    itkBooleanMacro(TransposedCacheHoldsProcessedData);
+
+    /**
+     * @brief If enabled, an inverted m/z index (see m2::InvertedMzIndex) is built for processed centroid and
+     * processed profile data on InitializeImageAccess. GetImage then only reads the data points inside
+     * the requested m/z range instead of the m/z axis of every spectrum.
+     * The index takes 8 bytes per data point and is not built if its size would exceed InvertedMzIndexMemoryLimit
+     * (bytes).
+     */
+    itkGetConstMacro(UseInvertedMzIndex, bool);
+    itkSetMacro(UseInvertedMzIndex, bool);
+    itkBooleanMacro(UseInvertedMzIndex);
+
+    itkGetConstMacro(InvertedMzIndexMemoryLimit, unsigned long long);
+    itkSetMacro(InvertedMzIndexMemoryLimit, unsigned long long);
+
+    /**
+     * @brief If enabled, the parsed spectrum meta data is stored in a sidecar file next to the *.imzML file
+     * (see m2::ImzMLMetaDataCache). Reopening the file reads the sidecar instead of parsing the XML.
+     */
+    itkGetConstMacro(UseSpectrumMetaDataCache, bool);
+    itkSetMacro(UseSpectrumMetaDataCache, bool);
+    itkBooleanMacro(UseSpectrumMetaDataCache);
+
+    /**
+     * @brief Memory (bytes) used to read ahead in passes over all spectra (InitializeImageAccess), shared by all
+     * threads. An I/O thread per worker reads the following blocks of spectra while the current block is processed
+     * (see m2::BinaryDataPrefetcher); for memory mapped data the operating system is advised to load the pages in
+     * advance. 0 disables reading ahead.
+     */
+    itkGetConstMacro(ReadAheadMemoryLimit, unsigned long long);
+    itkSetMacro(ReadAheadMemoryLimit, unsigned long long);
+
+    /**
+     * @brief Advises the operating system that the binary data of the spectra [first, first + count) of a source is
+     * read soon. Used by sequential readers of single spectra (e.g. the export), which do not read through a plan.
+     */
+    void PrefetchSpectra(unsigned int first, unsigned int count, unsigned int source = 0) const;
+
+    using BinaryDataOffsetType = m2::SpectrumMetaDataStore::OffsetType;
+    using BinaryDataLengthType = m2::SpectrumMetaDataStore::LengthType;
 
     void GetImage(double mz, double tol, const mitk::Image *mask, mitk::Image *img) const override;
+    /**
+     * @brief Sources of at least 2^18 spectra are generated progressively if onRefinement is given.
+     */
+    void GetImage(double mz,
+                  double tol,
+                  const mitk::Image *mask,
+                  mitk::Image *img,
+                  const CancellationToken &token,
+                  const ImageRefinementCallback &onRefinement = nullptr) const override;
 
     /**
-     * @brief The BinarySpectrumMetaData structure holds meta data for a single spectrum.
-     *
+     * @brief Generates all ion images in a single pass over the binary data.
+     * Each spectrum is read once for the window enclosing all ranges. Kernel based processing (smoothing, baseline
+     * correction) is applied to the padded window of each range as by GetImage, so the images equal those of GetImage.
      */
-    struct BinarySpectrumMetaData
-    {
-      BinaryDataOffsetType mzOffset;
-      BinaryDataOffsetType intOffset;
-      BinaryDataLengthType mzLength;
-      BinaryDataLengthType intLength;
-      // size_t id;
-      itk::Index<3> index;
-      struct
-      {
-        float x, y, z;
-      } world;
-      // In imzML-file defined normalization constant
-      m2::NormImagePixelType normalizationFactor = 1.0;
-      m2::NormImagePixelType inFileNormalizationFactor = 1.0;
-      std::vector<m2::Peak> peaks;
-    };
-    using SpectrumVectorType = std::vector<BinarySpectrumMetaData>;
+    void GetImages(const std::vector<IonImageRange> &ranges,
+                   const mitk::Image *mask,
+                   const std::vector<mitk::Image *> &images,
+                   const CancellationToken &token = CancellationToken()) const override;
+
+    /**
+     * @brief Meta data of all spectra of an image source (structure of arrays, see m2::SpectrumMetaDataStore).
+     */
+    using SpectrumVectorType = m2::SpectrumMetaDataStore;
 
     /**
      * @brief The ImzMLImageSource structure represent the meta information of an imzML-file.
@@ -76,7 +145,7 @@ namespace m2
       std::string m_MaskDataPath;
       std::string m_PointsDataPath;
 
-      // For each spectrum in the image exists a meta data object
+      // Meta data of each spectrum in the image
       SpectrumVectorType m_Spectra;
 
       // Pixel data of each image source is placed with respect to this offset
@@ -85,6 +154,18 @@ namespace m2
 
       // Transformations are applied if available using elastix transformix
       std::vector<std::string> m_Transformations;
+
+      // Read-only mapping of the binary data file; nullptr if binary data is read using file streams
+      std::shared_ptr<m2::MemoryMappedFile> m_BinaryDataMapping;
+
+      // Streams of the binary data file if it is not mapped; closed when the last copy of the source is destroyed
+      std::shared_ptr<m2::FileStreamPool> m_BinaryDataStreams;
+
+      // Transposed copy of the spectra (continuous profile only); nullptr if not in use
+      std::shared_ptr<m2::TransposedSpectrumCache> m_TransposedCache;
+
+      // m/z index of all data points (processed data only); nullptr if not in use
+      std::shared_ptr<m2::InvertedMzIndex> m_InvertedMzIndex;
     };
     using SourceListType = std::vector<ImzMLImageSource>;
 
@@ -105,6 +186,14 @@ namespace m2
                      std::vector<float> &xs,
                      unsigned int source = 0) const override;
 
+    /**
+     * @brief Writes spectrum id into caller-provided memory, e.g. to reuse it for all spectra of a loop.
+     * xs and ys must hold at least GetMzLength() and GetIntLength() values of the spectrum (see m_Spectra);
+     * throws mitk::Exception otherwise.
+     */
+    void GetSpectrum(unsigned int id, m2::Span<float> xs, m2::Span<float> ys, unsigned int source = 0) const;
+    void GetIntensities(unsigned int id, m2::Span<float> ys, unsigned int source = 0) const;
+
     template <class OffsetType, class LengthType, class DataType>
     static void binaryDataToVector(std::ifstream &f, OffsetType offset, LengthType length, DataType *vec) noexcept
     {
@@ -146,6 +235,17 @@ namespace m2
 
     bool m_ImageAccessInitialized = false;
     bool m_ImageGeometryInitialized = false;
+    bool m_UseMemoryMappedBinaryData = sizeof(void *) == 8;
+    bool m_UseTransposedCache = false;
+    bool m_TransposedCacheHoldsProcessedData = false;
+    bool m_UseInvertedMzIndex = true;
+    unsigned long long m_InvertedMzIndexMemoryLimit = 4ull << 30;
+    bool m_UseSpectrumMetaDataCache = true;
+    unsigned long long m_ReadAheadMemoryLimit = 256ull << 20;
+
+    void InitializeBinaryDataMapping();
+
+    std::vector<unsigned int> GetNeighbourSpectra(unsigned int id, unsigned int source) override;
 
     ImzMLSpectrumImage();
     ~ImzMLSpectrumImage() override;
@@ -159,7 +259,25 @@ namespace m2
 
     public:
       explicit Processor(m2::ImzMLSpectrumImage *owner) : p(owner) {}
-      void GetImagePrivate(double mz, double tol, const mitk::Image *mask, mitk::Image *image);
+      void GetImagePrivate(double mz, double tol, const mitk::Image *mask, mitk::Image *image) override
+      {
+        GetImagePrivate(mz, tol, mask, image, CancellationToken(), nullptr);
+      }
+
+      /**
+       * @brief The token is checked between blocks of pixels. With onRefinement, sources read from the binary data
+       * are processed in coarse-to-fine passes.
+       */
+      void GetImagePrivate(double mz,
+                           double tol,
+                           const mitk::Image *mask,
+                           mitk::Image *image,
+                           const CancellationToken &token,
+                           const ImageRefinementCallback &onRefinement) override;
+      void GetImagesPrivate(const std::vector<IonImageRange> &ranges,
+                            const mitk::Image *mask,
+                            const std::vector<mitk::Image *> &images,
+                            const CancellationToken &token) override;
       // void GetSpectrumPrivate(unsigned int, std::vector<float> &, std::vector<float> &, unsigned int) override {}
 
       void InitializeImageAccess();
@@ -191,7 +309,7 @@ namespace m2
       void InitializeImageAccessProcessedData();
 
       
-      static double GetNormalizationFactor(m2::NormalizationStrategyType strategy, MassAxisType * xFirst, MassAxisType * xLast, IntensityType * yFirst, IntensityType * yLast){
+      static double GetNormalizationFactor(m2::NormalizationStrategyType strategy, const MassAxisType * xFirst, const MassAxisType * xLast, IntensityType * yFirst, IntensityType * yLast){
                using namespace std;
             switch (strategy)
             {
@@ -217,9 +335,54 @@ namespace m2
 
       using XIteratorType = typename std::vector<MassAxisType>::iterator;
       using YIteratorType = typename std::vector<IntensityType>::iterator;
-      m2::Signal::SmoothingFunctor<IntensityType> m_Smoother;
-      m2::Signal::BaselineFunctor<IntensityType> m_BaselineSubstractor;
-      m2::Signal::IntensityTransformationFunctor<IntensityType> m_Transformer;
+
+      /**
+       * @brief Signal processing for the strategies of the image that were set when it was taken. The strategies
+       * may change after InitializeImageAccess (e.g. by the GUI before each ion image request), so ion images,
+       * spectra and the processed transposed cache take one snapshot per call and use its processingHash as key
+       * of what they cache.
+       */
+      struct ProcessingSnapshot
+      {
+        std::uint64_t processingHash;
+        // no smoothing, baseline correction or intensity transformation
+        bool rawIntensities;
+        m2::BaselineCorrectionType baselineCorrectionStrategy;
+        unsigned int baselineCorrectionHalfWindowSize;
+        m2::Signal::SpectrumProcessingPipeline<IntensityType> pipeline;
+      };
+
+      /**
+       * @brief The snapshot for the current strategies. It is rebuilt only if they changed since the last call.
+       */
+      std::shared_ptr<const ProcessingSnapshot> GetProcessingSnapshot() const;
+
+      mutable std::mutex m_ProcessingSnapshotMutex;
+      mutable std::shared_ptr<const ProcessingSnapshot> m_ProcessingSnapshot;
+
+      /**
+       * @brief Processing parameters of an ion image request, taken once at its start. A request reads neither the
+       * strategies of the image nor the members above afterwards and keeps its scratch data per thread of the
+       * request, so several ion images of the same image can be generated concurrently.
+       */
+      struct ImageRequestConfiguration
+      {
+        SpectrumInfo spectrumType;
+        unsigned int numberOfThreads;
+        bool useNormalization;
+        // normalization factors are taken from the normalization image (see UseExternalNormalization)
+        bool externalNormalization;
+        m2::RangePoolingStrategyType poolingStrategy;
+        // no smoothing, baseline correction or intensity transformation
+        bool rawIntensities;
+        m2::BaselineCorrectionType baselineCorrectionStrategy;
+        unsigned int baselineCorrectionHalfWindowSize;
+        std::uint64_t processingHash;
+        SpectrumArtifactVectorType xAxis;
+        m2::Signal::SpectrumProcessingPipeline<IntensityType> pipeline;
+      };
+
+      ImageRequestConfiguration GetImageRequestConfiguration() const;
 
 
       virtual void GetYValues(unsigned int id, std::vector<float> &yd, unsigned int source = 0)
@@ -238,12 +401,32 @@ namespace m2
       {
         GetXValues<double>(id, yd, source);
       }
+      void GetYValues(unsigned int id, m2::Span<float> yd, unsigned int source = 0) override
+      {
+        GetYValues<float>(id, yd, source);
+      }
+      void GetYValues(unsigned int id, m2::Span<double> yd, unsigned int source = 0) override
+      {
+        GetYValues<double>(id, yd, source);
+      }
+      void GetXValues(unsigned int id, m2::Span<float> xd, unsigned int source = 0) override
+      {
+        GetXValues<float>(id, xd, source);
+      }
+      void GetXValues(unsigned int id, m2::Span<double> xd, unsigned int source = 0) override
+      {
+        GetXValues<double>(id, xd, source);
+      }
 
     private:
       template <class OutputType>
       void GetYValues(unsigned int id, std::vector<OutputType> &yd, unsigned int source = 0);
       template <class OutputType>
       void GetXValues(unsigned int id, std::vector<OutputType> &xd, unsigned int source = 0);
+      template <class OutputType>
+      void GetYValues(unsigned int id, m2::Span<OutputType> yd, unsigned int source = 0);
+      template <class OutputType>
+      void GetXValues(unsigned int id, m2::Span<OutputType> xd, unsigned int source = 0);
     };
 
     std::unique_ptr<ProcessorBase> m_Processor;
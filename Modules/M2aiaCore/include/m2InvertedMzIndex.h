@@ -0,0 +1,107 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstdint>
+#include <m2Span.h>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Inverted index mapping m/z values to the spectra containing them.
+   *
+   * The m/z range [min, max] is divided into equally sized bins. For each bin a posting list holds one entry
+   * per data point (spectrum id and position within the spectrum). All posting lists are stored consecutively
+   * (CSR layout), so the candidates of an m/z range are a single contiguous block.
+   *
+   * The m/z values are not stored: data points of the bins between the first and the last bin overlapping a
+   * range are within the range, only those of the two boundary bins have to be checked against their m/z values
+   * in the file (see Candidates).
+   *
+   * The index is filled in two passes: the number of entries per bin is counted first (see Allocate()),
+   * afterwards the entries are written to their slots (see GetWritableEntries()).
+   */
+  class M2AIACORE_EXPORT InvertedMzIndex
+  {
+  public:
+    struct Entry
+    {
+      std::uint32_t spectrum;
+      std::uint32_t position;
+    };
+
+    /**
+     * @brief Entries of the bins overlapping an m/z range. The entries of the first (lowerBoundary) and of the
+     * last bin (upperBoundary) may be outside of the range; all entries of the bins in between (inner) are inside.
+     * If the range overlaps a single bin, its entries are the lowerBoundary.
+     */
+    struct Candidates
+    {
+      Span<const Entry> lowerBoundary;
+      Span<const Entry> inner;
+      Span<const Entry> upperBoundary;
+    };
+
+    InvertedMzIndex(double min, double max, std::uint32_t numberOfBins);
+
+    std::uint32_t GetNumberOfBins() const noexcept { return m_NumberOfBins; }
+
+    /**
+     * @brief Bin of the given m/z value; values outside of [min, max] are assigned to the first or last bin.
+     * The bin does not decrease with the m/z value, also for rounded values. Data points have to be assigned
+     * to the bin of their m/z value as read from the file, converted to double.
+     */
+    std::uint32_t GetBin(double mz) const noexcept
+    {
+      const auto bin = (mz - m_Min) / m_BinSize;
+      if (bin < 0)
+        return 0;
+      if (bin >= m_NumberOfBins)
+        return m_NumberOfBins - 1;
+      return static_cast<std::uint32_t>(bin);
+    }
+
+    /**
+     * @brief Allocates the posting lists for the given number of entries per bin.
+     * Returns the position of the first entry of each bin.
+     */
+    const std::vector<std::uint64_t> &Allocate(const std::vector<std::uint64_t> &entriesPerBin);
+
+    Entry *GetWritableEntries() noexcept { return m_Entries.data(); }
+
+    /**
+     * @brief The entries of the bins overlapping [lower, upper]; see Candidates.
+     */
+    Candidates GetCandidates(double lower, double upper) const noexcept;
+
+    std::uint64_t GetNumberOfEntries() const noexcept { return m_Entries.size(); }
+
+    /**
+     * @brief Size of the posting lists in bytes if the given number of entries is indexed.
+     */
+    static std::uint64_t GetMemorySize(std::uint64_t numberOfEntries) noexcept { return numberOfEntries * sizeof(Entry); }
+
+  private:
+    double m_Min;
+    double m_BinSize;
+    std::uint32_t m_NumberOfBins;
+    std::vector<std::uint64_t> m_BinOffsets;
+    std::vector<Entry> m_Entries;
+  };
+
+} // namespace m2
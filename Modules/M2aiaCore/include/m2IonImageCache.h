@@ -0,0 +1,185 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstdint>
+#include <list>
+#include <m2Span.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Thread-safe cache of ion images.
+   *
+   * Images are identified by their range, the mask they were generated with and a hash of the processing
+   * parameters (see Key). The cache only holds images of a single processing hash: accessing it with another hash
+   * drops all entries.
+   * Images are kept uncompressed up to the memory limit. The least recently used images beyond it are compressed
+   * and retained up to the compressed memory limit; they are decompressed and moved back on access.
+   */
+  class M2AIACORE_EXPORT IonImageCache
+  {
+  public:
+    struct Key
+    {
+      double Center = 0;
+      double Tolerance = 0;
+      // 0 if no mask is used
+      std::uint64_t MaskId = 0;
+      std::uint64_t ProcessingHash = 0;
+
+      bool operator==(const Key &other) const noexcept
+      {
+        return Center == other.Center && Tolerance == other.Tolerance && MaskId == other.MaskId &&
+               ProcessingHash == other.ProcessingHash;
+      }
+    };
+
+    static constexpr std::uint64_t DefaultMemoryLimit = 128ull << 20;
+    static constexpr std::uint64_t DefaultCompressedMemoryLimit = 128ull << 20;
+
+    explicit IonImageCache(std::uint64_t memoryLimit = DefaultMemoryLimit,
+                           std::uint64_t compressedMemoryLimit = DefaultCompressedMemoryLimit)
+      : m_MemoryLimit(memoryLimit), m_CompressedMemoryLimit(compressedMemoryLimit)
+    {
+    }
+
+    /**
+     * @brief Copies the cached image into image and marks it as most recently used. Returns false if the image is
+     * not cached or its number of pixels differs from image.size().
+     */
+    bool Get(const Key &key, Span<double> image);
+
+    /**
+     * @brief True if the image is cached, compressed or not. Does not change the order of use.
+     */
+    bool Contains(const Key &key) const;
+
+    /**
+     * @brief Adds a copy of image.
+     */
+    void Insert(const Key &key, Span<const double> image);
+
+    void Clear();
+
+    void SetMemoryLimit(std::uint64_t bytes);
+    std::uint64_t GetMemoryLimit() const;
+    void SetCompressedMemoryLimit(std::uint64_t bytes);
+    std::uint64_t GetCompressedMemoryLimit() const;
+
+    std::uint64_t GetNumberOfBytes() const;
+    std::uint64_t GetNumberOfCompressedBytes() const;
+    std::size_t GetNumberOfImages() const;
+    std::size_t GetNumberOfCompressedImages() const;
+
+  private:
+    struct KeyHash
+    {
+      std::size_t operator()(const Key &key) const noexcept
+      {
+        return std::hash<double>()(key.Center) ^ (std::hash<double>()(key.Tolerance) << 1) ^
+               std::hash<std::uint64_t>()(key.MaskId ^ key.ProcessingHash);
+      }
+    };
+
+    struct Entry
+    {
+      Key key;
+      std::vector<double> values;
+    };
+
+    struct CompressedEntry
+    {
+      Key key;
+      std::size_t numberOfValues;
+      std::shared_ptr<const std::string> data;
+    };
+
+    template <class EntryType>
+    struct Tier
+    {
+      std::list<EntryType> entries; // most recently used first
+      std::unordered_map<Key, typename std::list<EntryType>::iterator, KeyHash> index;
+      std::uint64_t numberOfBytes = 0;
+
+      void PushFront(EntryType entry)
+      {
+        numberOfBytes += GetNumberOfBytes(entry);
+        entries.push_front(std::move(entry));
+        index[entries.front().key] = entries.begin();
+      }
+
+      EntryType PopBack()
+      {
+        EntryType entry = std::move(entries.back());
+        entries.pop_back();
+        index.erase(entry.key);
+        numberOfBytes -= GetNumberOfBytes(entry);
+        return entry;
+      }
+
+      void Remove(const Key &key)
+      {
+        auto it = index.find(key);
+        if (it == index.end())
+          return;
+        numberOfBytes -= GetNumberOfBytes(*it->second);
+        entries.erase(it->second);
+        index.erase(it);
+      }
+
+      void Clear()
+      {
+        entries.clear();
+        index.clear();
+        numberOfBytes = 0;
+      }
+    };
+
+    static std::uint64_t GetNumberOfBytes(const Entry &entry) noexcept { return entry.values.size() * sizeof(double); }
+    static std::uint64_t GetNumberOfBytes(const CompressedEntry &entry) noexcept { return entry.data->size(); }
+
+    static std::string Compress(const std::vector<double> &values);
+    static void Decompress(const std::string &data, Span<double> values);
+
+    void Invalidate(std::uint64_t processingHash);
+
+    /**
+     * @brief Moves images beyond the memory limit out of the uncompressed tier. Called with the mutex held.
+     */
+    std::vector<Entry> EvictUncompressed();
+
+    /**
+     * @brief Compresses the given images and adds them to the compressed tier. Called without the mutex held.
+     */
+    void Retain(std::vector<Entry> evicted);
+
+    mutable std::mutex m_Mutex;
+    Tier<Entry> m_Images;
+    Tier<CompressedEntry> m_CompressedImages;
+    std::uint64_t m_ProcessingHash = 0;
+    std::uint64_t m_MemoryLimit;
+    std::uint64_t m_CompressedMemoryLimit;
+  };
+
+} // namespace m2
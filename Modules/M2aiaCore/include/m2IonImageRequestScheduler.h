@@ -0,0 +1,117 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <m2CancellationToken.h>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace m2
+{
+  /**
+   * @brief Runs ion image requests with at most one request per key (e.g. a data node) in flight.
+   *
+   * Submitting a request cancels the running request of the same key (see CancellationToken) and replaces a
+   * request of that key that did not start yet. Hence, only the latest request of a key is executed after the
+   * running one returned, regardless of how many requests were submitted meanwhile. Requests of different keys
+   * run concurrently.
+   */
+  class M2AIACORE_EXPORT IonImageRequestScheduler
+  {
+  public:
+    /**
+     * @brief A request should check the token between blocks of work. m2::OperationCanceledException thrown
+     * by a request is expected; other exceptions are logged.
+     */
+    using Request = std::function<void(const CancellationToken &token)>;
+
+    IonImageRequestScheduler() = default;
+
+    /**
+     * @brief Cancels all requests and waits for the running ones.
+     */
+    ~IonImageRequestScheduler();
+
+    IonImageRequestScheduler(const IonImageRequestScheduler &) = delete;
+    IonImageRequestScheduler &operator=(const IonImageRequestScheduler &) = delete;
+
+    void Submit(const void *key, Request request);
+
+    /**
+     * @brief Cancels the running request of key and drops its waiting request.
+     */
+    void Cancel(const void *key);
+
+    /**
+     * @brief Cancels the requests of all keys like Cancel().
+     */
+    void CancelAll();
+
+    /**
+     * @brief Cancels the requests of key like Cancel(), waits for the running one and releases the state kept for
+     * key. Call it when the key is no longer used (e.g. the data node was removed).
+     */
+    void Remove(const void *key);
+
+    /**
+     * @brief Number of keys the scheduler keeps state for.
+     */
+    std::size_t GetNumberOfKeys() const;
+
+    /**
+     * @brief Blocks until no request is running or waiting.
+     */
+    void Wait();
+
+    /**
+     * @brief True if no request is running or waiting.
+     */
+    bool IsIdle() const;
+
+    /**
+     * @brief callback is invoked without lock by the thread of the last running request after it returned and
+     * left the scheduler idle (e.g. to start deferred background work).
+     */
+    void SetIdleCallback(std::function<void()> callback);
+
+  private:
+    struct Slot
+    {
+      Request pending;
+      CancellationToken token; // of the running request
+      bool running = false;
+      std::thread thread;
+    };
+
+    void Run(const void *key);
+
+    /**
+     * @brief IsIdle() with m_Mutex locked by the caller.
+     */
+    bool IsIdleLocked() const;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::map<const void *, Slot> m_Slots;
+    std::function<void()> m_IdleCallback;
+  };
+
+} // namespace m2
@@ -0,0 +1,112 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstdint>
+#include <m2Span.h>
+#include <memory>
+#include <string>
+
+namespace m2
+{
+  /**
+   * @brief Memory mapping of a file.
+   * The whole file is mapped read-only on Open(). Typed views into the mapping are handed out by GetSpan().
+   * Create() creates a file of a given size and maps it for writing.
+   * Throws mitk::Exception if the file can not be opened or mapped.
+   */
+  class M2AIACORE_EXPORT MemoryMappedFile
+  {
+  public:
+    MemoryMappedFile() = default;
+    explicit MemoryMappedFile(const std::string &path);
+    ~MemoryMappedFile();
+
+    MemoryMappedFile(const MemoryMappedFile &) = delete;
+    MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+    void Open(const std::string &path);
+    void Create(const std::string &path, std::uint64_t size);
+    void Close() noexcept;
+
+    /**
+     * @brief Writes modified pages of a writable mapping back to the file.
+     */
+    void Flush();
+
+    bool IsOpen() const noexcept { return m_Data != nullptr; }
+    const std::string &GetPath() const noexcept { return m_Path; }
+    std::uint64_t GetSize() const noexcept { return m_Size; }
+    const char *GetData() const noexcept { return m_Data; }
+    char *GetWritableData() const noexcept { return m_Writable ? const_cast<char *>(m_Data) : nullptr; }
+
+    /**
+     * @brief Returns true if [offset, offset + numberOfBytes) lies within the mapped file.
+     */
+    bool Contains(std::uint64_t offset, std::uint64_t numberOfBytes) const noexcept
+    {
+      return offset <= m_Size && numberOfBytes <= m_Size - offset;
+    }
+
+    /**
+     * @brief Advises the operating system that [offset, offset + numberOfBytes) is accessed soon, so that the pages
+     * are read asynchronously. Has no effect if not supported.
+     */
+    void WillNeed(std::uint64_t offset, std::uint64_t numberOfBytes) const noexcept;
+
+    /**
+     * @brief Typed view of length elements starting at byte offset.
+     * An empty span is returned if the range exceeds the file or the address is not aligned for T;
+     * in that case the data has to be copied (see Read()).
+     */
+    template <class T>
+    Span<const T> GetSpan(std::uint64_t offset, std::uint64_t length) const noexcept
+    {
+      if (!m_Data || !Contains(offset, length * sizeof(T)))
+        return {};
+      const char *address = m_Data + offset;
+      if (reinterpret_cast<std::uintptr_t>(address) % alignof(T) != 0)
+        return {};
+      return Span<const T>(reinterpret_cast<const T *>(address), length);
+    }
+
+    /**
+     * @brief Copies length elements starting at byte offset into dst.
+     * Throws mitk::Exception if the range exceeds the mapped file.
+     */
+    template <class T>
+    void Read(std::uint64_t offset, std::uint64_t length, T *dst) const
+    {
+      ReadBytes(offset, length * sizeof(T), reinterpret_cast<char *>(dst));
+    }
+
+  private:
+    void ReadBytes(std::uint64_t offset, std::uint64_t numberOfBytes, char *dst) const;
+
+    std::string m_Path;
+    const char *m_Data = nullptr;
+    std::uint64_t m_Size = 0;
+    bool m_Writable = false;
+#ifdef _WIN32
+    void *m_FileHandle = nullptr;
+    void *m_MappingHandle = nullptr;
+#else
+    int m_FileDescriptor = -1;
+#endif
+  };
+
+} // namespace m2
@@ -15,6 +15,7 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <cmath>
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -0,0 +1,226 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <m2Process.hpp>
+#include <m2Span.h>
+#include <type_traits>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Peak lists of many spectra (e.g. the peaks picked per pixel) in compressed sparse row layout.
+   *
+   * Row i holds the peaks of spectrum i. The m/z values and intensities of all rows are stored in two consecutive
+   * columns, row i occupies [offsets[i], offsets[i+1]) of both. A peak takes sizeof(MzType) + sizeof(float) bytes;
+   * a std::vector<m2::Peak> per spectrum would take 48 bytes per peak plus the vector itself.
+   *
+   * Rows are accessed through views into the columns (see Row); views are invalidated if the matrix is modified.
+   */
+  template <class MzType>
+  class BasicPeakMatrix
+  {
+  public:
+    using IntensityType = float;
+
+    /**
+     * @brief Read-only view of the peaks of one row.
+     */
+    struct Row
+    {
+      Span<const MzType> mzs;
+      Span<const IntensityType> intensities;
+
+      std::size_t size() const noexcept { return mzs.size(); }
+      bool empty() const noexcept { return mzs.empty(); }
+    };
+
+    BasicPeakMatrix() = default;
+
+    /**
+     * @brief A matrix of numberOfRows empty rows.
+     */
+    explicit BasicPeakMatrix(std::size_t numberOfRows) : m_Offsets(numberOfRows + 1, 0) {}
+
+    /**
+     * @brief Builds a matrix of numberOfRows rows in parallel.
+     *
+     * rowFunction(laneId, row) is called once per row, with laneId in [0, T) as for m2::Process::ParallelFor,
+     * and returns the peaks of the row as a container of m2::Peak (or any type providing GetX() and GetY()).
+     * The rows are processed in chunks; the peaks of a chunk are collected in a lane-local buffer and copied to
+     * exactly sized chunk buffers. After the row sizes are known, the m/z values and the intensities of the chunks
+     * are moved to the matrix one column after the other, releasing each chunk buffer right after its copy.
+     * The lane buffers are released before the columns are allocated, so the transient memory is bounded by the
+     * chunk buffers plus one column, about 1.5 times the size of the matrix for single precision m/z values.
+     */
+    template <class RowFunction>
+    static BasicPeakMatrix Build(std::size_t numberOfRows, unsigned int T, RowFunction rowFunction)
+    {
+      struct Lane
+      {
+        std::vector<MzType> mzs;
+        std::vector<IntensityType> intensities;
+      };
+
+      struct Chunk
+      {
+        std::vector<MzType> mzs;
+        std::vector<IntensityType> intensities;
+      };
+
+      BasicPeakMatrix matrix(numberOfRows);
+      if (numberOfRows == 0)
+        return matrix;
+
+      T = std::max(1u, T);
+      const auto grainSize = static_cast<unsigned int>(std::max<std::size_t>(1, numberOfRows / (16ul * T)));
+      std::vector<Lane> lanes(T);
+      std::vector<Chunk> chunks((numberOfRows + grainSize - 1) / grainSize);
+      auto &offsets = matrix.m_Offsets;
+
+      // the number of peaks of row i is stored at offsets[i+1]
+      m2::Process::ParallelFor(numberOfRows,
+                               T,
+                               [&](unsigned int t, unsigned int a, unsigned int b)
+                               {
+                                 auto &lane = lanes[t];
+                                 lane.mzs.clear();
+                                 lane.intensities.clear();
+                                 for (unsigned int row = a; row < b; ++row)
+                                 {
+                                   const auto &peaks = rowFunction(t, row);
+                                   for (const auto &p : peaks)
+                                   {
+                                     lane.mzs.push_back(static_cast<MzType>(p.GetX()));
+                                     lane.intensities.push_back(static_cast<IntensityType>(p.GetY()));
+                                   }
+                                   offsets[row + 1] = peaks.size();
+                                 }
+                                 auto &chunk = chunks[a / grainSize];
+                                 chunk.mzs.assign(lane.mzs.begin(), lane.mzs.end());
+                                 chunk.intensities.assign(lane.intensities.begin(), lane.intensities.end());
+                               },
+                               grainSize);
+      lanes.clear();
+
+      for (std::size_t row = 0; row < numberOfRows; ++row)
+        offsets[row + 1] += offsets[row];
+
+      // one column after the other, so that only one column is allocated while all chunk buffers are held
+      const auto CopyColumn = [&](auto &column, auto chunkColumn)
+      {
+        column.resize(offsets.back());
+        m2::Process::ParallelFor(chunks.size(),
+                                 T,
+                                 [&](unsigned int, unsigned int a, unsigned int b)
+                                 {
+                                   for (unsigned int c = a; c < b; ++c)
+                                   {
+                                     auto &source = chunks[c].*chunkColumn;
+                                     std::copy(source.begin(), source.end(), column.begin() + offsets[c * grainSize]);
+                                     std::decay_t<decltype(source)>().swap(source);
+                                   }
+                                 },
+                                 1);
+      };
+      CopyColumn(matrix.m_Mzs, &Chunk::mzs);
+      CopyColumn(matrix.m_Intensities, &Chunk::intensities);
+      return matrix;
+    }
+
+    std::size_t GetNumberOfRows() const noexcept { return m_Offsets.empty() ? 0 : m_Offsets.size() - 1; }
+    std::size_t GetNumberOfPeaks() const noexcept { return m_Mzs.size(); }
+
+    Row operator[](std::size_t row) const noexcept
+    {
+      const auto first = m_Offsets[row];
+      const auto length = m_Offsets[row + 1] - first;
+      return Row{Span<const MzType>(m_Mzs.data() + first, length),
+                 Span<const IntensityType>(m_Intensities.data() + first, length)};
+    }
+
+    /**
+     * @brief The m/z values of all rows, row by row.
+     */
+    Span<const MzType> GetMzs() const noexcept { return Span<const MzType>(m_Mzs.data(), m_Mzs.size()); }
+
+    /**
+     * @brief The intensities of all rows, row by row.
+     */
+    Span<const IntensityType> GetIntensities() const noexcept
+    {
+      return Span<const IntensityType>(m_Intensities.data(), m_Intensities.size());
+    }
+
+    /**
+     * @brief Changes the number of rows. New rows are empty, removed rows release their peaks.
+     */
+    void Resize(std::size_t numberOfRows)
+    {
+      if (m_Offsets.empty())
+        m_Offsets.push_back(0);
+      m_Offsets.resize(numberOfRows + 1, m_Offsets.back());
+      m_Mzs.resize(m_Offsets.back());
+      m_Intensities.resize(m_Offsets.back());
+    }
+
+    /**
+     * @brief Moves all rows of other behind the rows of this matrix.
+     */
+    void Append(BasicPeakMatrix &&other)
+    {
+      if (other.m_Offsets.empty())
+        return;
+      if (m_Offsets.empty())
+      {
+        *this = std::move(other);
+        return;
+      }
+      const auto shift = m_Offsets.back();
+      std::transform(std::next(other.m_Offsets.begin()),
+                     other.m_Offsets.end(),
+                     std::back_inserter(m_Offsets),
+                     [shift](std::uint64_t offset) { return offset + shift; });
+      m_Mzs.insert(m_Mzs.end(), other.m_Mzs.begin(), other.m_Mzs.end());
+      m_Intensities.insert(m_Intensities.end(), other.m_Intensities.begin(), other.m_Intensities.end());
+      other = BasicPeakMatrix();
+    }
+
+    /**
+     * @brief Approximate number of bytes occupied by the matrix.
+     */
+    std::size_t GetMemorySize() const noexcept
+    {
+      return m_Offsets.size() * sizeof(std::uint64_t) + m_Mzs.size() * (sizeof(MzType) + sizeof(IntensityType));
+    }
+
+  private:
+    std::vector<std::uint64_t> m_Offsets;
+    std::vector<MzType> m_Mzs;
+    std::vector<IntensityType> m_Intensities;
+  };
+
+  /**
+   * @brief Peak matrix with m/z values in single precision, as used for the peaks picked per pixel.
+   */
+  using PeakMatrix = BasicPeakMatrix<float>;
+
+} // namespace m2
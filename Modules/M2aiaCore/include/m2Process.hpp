@@ -16,48 +16,136 @@ See LICENSE.txt for details.
 ===================================================================*/
 
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
-#include <thread>
+#include <iterator>
+#include <m2ThreadPool.h>
+#include <mitkExceptionMacro.h>
 #include <vector>
 
 namespace m2
 {
+  /**
+   * @brief Parallel loops executed by the process-wide m2::ThreadPool.
+   *
+   * The worker is called with a lane id in [0, T) and an index range [startIdx, endIdx). Lanes are executed
+   * by one thread at a time, so per-lane data (e.g. accumulators indexed by the lane id) does not need locking.
+   * Calls may be nested.
+   */
   struct Process
   {
-    static void Map(
-      unsigned long int N,
-      unsigned int T,
-      const std::function<void(unsigned int threadId, unsigned int startIdx, unsigned int endIdx)> &worker)
-    {
-      std::vector<std::thread> threads;
-      threads.clear();
-      unsigned int n = N / T;
+    using WorkerType = std::function<void(unsigned int threadId, unsigned int startIdx, unsigned int endIdx)>;
 
+    /**
+     * @brief Static partitioning: each of the T lanes is called once with one of T equally sized ranges.
+     */
+    static void Map(unsigned long int N, unsigned int T, const WorkerType &worker)
+    {
       if (N < 1)
         mitkThrow() << "The number of input unit is < 1!";
 
       if (T < 1)
         mitkThrow() << "The number of threads is < 1!";
 
-      if (n == 0)
-      { // recursively reduce threads to get non-zero n
-        Map(N, T / 2, worker);
-      }
+      // every lane gets at least one element
+      T = static_cast<unsigned int>(std::min<unsigned long int>(N, T));
+      const unsigned int n = N / T;
+      const unsigned int r = N % T;
+      ThreadPool::GetInstance().Run(T,
+                                    [&](unsigned int t)
+                                    {
+                                      if (t != (T - 1))
+                                        worker(t, t * n, (t + 1) * n);
+                                      else
+                                        worker(t, t * n, (t + 1) * n + r);
+                                    });
+    }
 
-      // start the workers
-      unsigned int r = N % T;
-      for (unsigned int t = 0; t < T; ++t)
-      {
-        if (t != (T - 1))
-          threads.emplace_back(std::thread(worker, t, t * n, (t + 1) * n));
-        else
-          threads.emplace_back(std::thread(worker, t, t * n, (t + 1) * n + r));
-      }
+    /**
+     * @brief Dynamic partitioning: the T lanes claim chunks of grainSize elements until all are processed, so
+     * that lanes finishing early take over remaining work. The worker is called once per chunk.
+     * A grainSize of 0 selects ~16 chunks per lane. Nothing is done for N == 0.
+     */
+    static void ParallelFor(unsigned long int N, unsigned int T, const WorkerType &worker, unsigned int grainSize = 0)
+    {
+      if (N < 1)
+        return;
+
+      if (T < 1)
+        mitkThrow() << "The number of threads is < 1!";
 
-      // wait until the work is done
-      for (auto &t : threads)
-        t.join();
+      if (grainSize == 0)
+        grainSize = static_cast<unsigned int>(std::max<unsigned long int>(1, N / (16ul * T)));
+
+      const unsigned long int numberOfChunks = (N + grainSize - 1) / grainSize;
+      T = static_cast<unsigned int>(std::min<unsigned long int>(numberOfChunks, T));
+
+      std::atomic<unsigned long int> nextChunk{0};
+      ThreadPool::GetInstance().Run(T,
+                                    [&](unsigned int t)
+                                    {
+                                      for (auto chunk = nextChunk++; chunk < numberOfChunks; chunk = nextChunk++)
+                                      {
+                                        const auto a = chunk * grainSize;
+                                        worker(t, a, std::min<unsigned long int>(N, a + grainSize));
+                                      }
+                                    });
+    }
+
+    /**
+     * @brief ParallelFor with one accumulator per lane, initialized by identity. map(accumulator, startIdx, endIdx)
+     * is called for each chunk; the accumulators are combined by reduce(a, b) in lane order.
+     */
+    template <class ValueType, class MapType, class ReduceType>
+    static ValueType ParallelReduce(
+      unsigned long int N, unsigned int T, const ValueType &identity, MapType map, ReduceType reduce)
+    {
+      std::vector<ValueType> accumulators(std::max(1u, T), identity);
+      ParallelFor(N, T, [&](unsigned int t, unsigned int a, unsigned int b) { map(accumulators[t], a, b); });
+
+      ValueType result = identity;
+      for (auto &accumulator : accumulators)
+        result = reduce(result, accumulator);
+      return result;
+    }
+
+    /**
+     * @brief Sorts [first, last) with T lanes: T parts are sorted independently and merged pairwise afterwards.
+     */
+    template <class ItType, class CompareType>
+    static void ParallelSort(ItType first, ItType last, unsigned int T, CompareType comp)
+    {
+      const unsigned long int n = std::distance(first, last);
+      if (n < 2)
+        return;
+
+      if (T < 1)
+        mitkThrow() << "The number of threads is < 1!";
+
+      const auto part = (n + T - 1) / T;
+      const auto at = [&](unsigned long int i) { return std::next(first, std::min(n, i)); };
+      ParallelFor(
+        T,
+        T,
+        [&](unsigned int, unsigned int a, unsigned int b)
+        {
+          for (unsigned long int p = a; p < b; ++p)
+            std::sort(at(p * part), at((p + 1) * part), comp);
+        },
+        1);
+
+      for (auto width = part; width < n; width *= 2)
+        ParallelFor(
+          (n + 2 * width - 1) / (2 * width),
+          T,
+          [&](unsigned int, unsigned int a, unsigned int b)
+          {
+            for (unsigned long int p = a; p < b; ++p)
+              std::inplace_merge(at(2 * p * width), at((2 * p + 1) * width), at((2 * p + 2) * width), comp);
+          },
+          1);
     }
 
     template <class ElementType, class BinaryReduceOperationFunctionType, class UnaryFinalizeOperationFunctionType>
@@ -0,0 +1,57 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <cstddef>
+
+namespace m2
+{
+  /**
+   * @brief Non-owning view of a contiguous sequence of elements.
+   * Provides the container interface (begin/end, cbegin/cend, size) used by the signal processing functions.
+   */
+  template <class T>
+  class Span
+  {
+  public:
+    using value_type = T;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    Span() noexcept = default;
+    Span(T *data, std::size_t size) noexcept : m_Data(data), m_Size(size) {}
+
+    T *data() const noexcept { return m_Data; }
+    std::size_t size() const noexcept { return m_Size; }
+    bool empty() const noexcept { return m_Size == 0; }
+
+    T &operator[](std::size_t i) const noexcept { return m_Data[i]; }
+    T &front() const noexcept { return m_Data[0]; }
+    T &back() const noexcept { return m_Data[m_Size - 1]; }
+
+    iterator begin() const noexcept { return m_Data; }
+    iterator end() const noexcept { return m_Data + m_Size; }
+    const_iterator cbegin() const noexcept { return m_Data; }
+    const_iterator cend() const noexcept { return m_Data + m_Size; }
+
+    Span subspan(std::size_t offset, std::size_t count) const noexcept { return Span(m_Data + offset, count); }
+
+  private:
+    T *m_Data = nullptr;
+    std::size_t m_Size = 0;
+  };
+
+} // namespace m2
@@ -0,0 +1,107 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Thread-safe least recently used cache of processed spectra.
+   *
+   * Spectra are identified by their source, their id and a hash of the processing parameters they were processed
+   * with. The cache only holds spectra of a single processing hash: accessing it with another hash drops all
+   * entries. The least recently used spectra are dropped as long as the cached values exceed the memory limit.
+   */
+  class M2AIACORE_EXPORT SpectrumCache
+  {
+  public:
+    struct Key
+    {
+      std::uint32_t Source = 0;
+      std::uint32_t Spectrum = 0;
+      std::uint64_t ProcessingHash = 0;
+
+      bool operator==(const Key &other) const noexcept
+      {
+        return Source == other.Source && Spectrum == other.Spectrum && ProcessingHash == other.ProcessingHash;
+      }
+    };
+
+    struct Spectrum
+    {
+      std::vector<double> xs;
+      std::vector<double> ys;
+    };
+    using SpectrumPointer = std::shared_ptr<const Spectrum>;
+
+    static constexpr std::uint64_t DefaultMemoryLimit = 64ull << 20;
+
+    explicit SpectrumCache(std::uint64_t memoryLimit = DefaultMemoryLimit) : m_MemoryLimit(memoryLimit) {}
+
+    /**
+     * @brief Returns the cached spectrum and marks it as most recently used; nullptr if it is not cached.
+     */
+    SpectrumPointer Get(const Key &key);
+
+    bool Contains(const Key &key) const;
+
+    /**
+     * @brief Adds a spectrum and returns it. A spectrum larger than the memory limit is returned but not cached.
+     */
+    SpectrumPointer Insert(const Key &key, Spectrum spectrum);
+
+    void Clear();
+
+    void SetMemoryLimit(std::uint64_t bytes);
+    std::uint64_t GetMemoryLimit() const;
+    std::uint64_t GetNumberOfBytes() const;
+    std::size_t GetNumberOfSpectra() const;
+
+  private:
+    struct KeyHash
+    {
+      std::size_t operator()(const Key &key) const noexcept
+      {
+        return std::hash<std::uint64_t>()((std::uint64_t(key.Source) << 32 | key.Spectrum) ^ key.ProcessingHash);
+      }
+    };
+    using EntryList = std::list<std::pair<Key, SpectrumPointer>>;
+
+    static std::uint64_t GetNumberOfBytes(const Spectrum &spectrum) noexcept
+    {
+      return (spectrum.xs.size() + spectrum.ys.size()) * sizeof(double);
+    }
+
+    void Invalidate(std::uint64_t processingHash);
+    void Evict();
+
+    mutable std::mutex m_Mutex;
+    EntryList m_Entries; // most recently used first
+    std::unordered_map<Key, EntryList::iterator, KeyHash> m_Index;
+    std::uint64_t m_ProcessingHash = 0;
+    std::uint64_t m_NumberOfBytes = 0;
+    std::uint64_t m_MemoryLimit;
+  };
+
+} // namespace m2
@@ -17,11 +17,15 @@ See LICENSE.txt for details.
 #include <itkMultiThreaderBase.h>
 #include <M2aiaCoreExports.h>
 #include <itkMetaDataObject.h>
+#include <m2CancellationToken.h>
 #include <m2CoreCommon.h>
 #include <m2ElxRegistrationHelper.h>
 #include <m2ISpectrumDataAccess.h>
+#include <m2IonImageCache.h>
 #include <m2IonImageReference.h>
+#include <m2IonImageRequestScheduler.h>
 #include <m2Peak.h>
+#include <m2SpectrumCache.h>
 #include <m2SpectrumInfo.h>
 #include <mitkBaseData.h>
 #include <mitkImage.h>
@@ -77,6 +81,20 @@ namespace m2
       MITK_WARN(GetStaticNameOfClass()) << "GetYValues[float] is not implemented!";
     }
 
+    /**
+     * @brief Processed spectrum id of source (see GetXValues/GetYValues), taken from the spectrum cache if possible.
+     * The spectra of the 8-neighbourhood of its pixel are loaded into the cache in the background; a later call
+     * cancels this loading without waiting for it.
+     */
+    SpectrumCache::SpectrumPointer GetCachedSpectrum(unsigned int id, unsigned int source = 0);
+
+    SpectrumCache &GetSpectrumCache() noexcept { return m_SpectrumCache; }
+
+    /**
+     * @brief Hash of the normalization and signal processing parameters. Never 0.
+     */
+    std::uint64_t GetProcessingHash() const;
+
 
 
 
@@ -144,6 +162,61 @@ namespace m2
     const SpectrumArtifactVectorType &GetXAxis() const;
 
     void GetImage(double mz, double tol, const mitk::Image *mask, mitk::Image *img) const override;
+
+    /**
+     * @brief Records the range of the ion image shown by this image in its properties and meta data
+     * (x_range_center, x_range_tol). GetImage does not change them, so that ion images of the same image can be
+     * generated concurrently; the caller that displays the result sets the range.
+     */
+    void SetCurrentIonImageRange(double mz, double tol);
+
+    /**
+     * @brief Like GetImage, but stops with m2::OperationCanceledException once token is cancelled. The content of
+     * img is undefined in this case. Implementations may generate large images progressively and call onRefinement
+     * (if set) whenever img holds a refined preview; it is called from a worker thread.
+     * The default implementation neither checks the token nor publishes previews.
+     */
+    virtual void GetImage(double mz,
+                          double tol,
+                          const mitk::Image *mask,
+                          mitk::Image *img,
+                          const CancellationToken &token,
+                          const ImageRefinementCallback &onRefinement = nullptr) const;
+
+    /**
+     * @brief Like GetImage, but the ion image is taken from the ion image cache if it was generated before with the
+     * same mask and processing parameters. img must be of type DisplayImagePixelType.
+     */
+    void GetCachedImage(double mz,
+                        double tol,
+                        const mitk::Image *mask,
+                        mitk::Image *img,
+                        const CancellationToken &token = CancellationToken(),
+                        const ImageRefinementCallback &onRefinement = nullptr);
+
+    /**
+     * @brief Generates the ion images of ranges in the background and adds them to the ion image cache, so that a
+     * later GetCachedImage for one of these ranges returns immediately. Ranges that are cached already are skipped;
+     * at most as many images are generated as fit into the ion image cache besides the currently displayed one.
+     * Stops with m2::OperationCanceledException once token is cancelled.
+     */
+    void PrefetchImages(const std::vector<IonImageRange> &ranges,
+                        const mitk::Image *mask,
+                        const CancellationToken &token);
+
+    IonImageCache &GetIonImageCache() noexcept { return m_IonImageCache; }
+
+    /**
+     * @brief Generates one ion image per range; images[i] receives the ion image of ranges[i].
+     * Like for GetImage, the output images have to be initialized with the geometry of this image.
+     * The default implementation calls GetImage for each range. Stops with m2::OperationCanceledException once
+     * token is cancelled.
+     */
+    virtual void GetImages(const std::vector<IonImageRange> &ranges,
+                           const mitk::Image *mask,
+                           const std::vector<mitk::Image *> &images,
+                           const CancellationToken &token = CancellationToken()) const;
+
     void InsertImageArtifact(const std::string &key, mitk::Image *img);
 
     template <class T>
@@ -219,6 +292,28 @@ namespace m2
 
     SpectrumImageBase();
     ~SpectrumImageBase() override;
+
+    /**
+     * @brief Ids of the spectra of source in the 8-neighbourhood of the pixel of spectrum id. The default
+     * implementation returns none, i.e. GetCachedSpectrum() does not prefetch.
+     */
+    virtual std::vector<unsigned int> GetNeighbourSpectra(unsigned int /*id*/, unsigned int /*source*/)
+    {
+      return {};
+    }
+
+    /**
+     * @brief Cancels the background loading of GetCachedSpectrum() and waits for it. Must be called before
+     * the processing state of a derived class changes or is destroyed.
+     */
+    void StopSpectrumPrefetch();
+
+    IonImageCache::Key GetIonImageCacheKey(double mz, double tol, const mitk::Image *mask) const;
+
+    SpectrumCache m_SpectrumCache;
+    IonImageCache m_IonImageCache;
+    IonImageRequestScheduler m_SpectrumPrefetchScheduler; // a single key: this image
+
     bool m_IsDataAccessInitialized = false;
 
     SpectrumArtifactVectorType m_XAxis;
@@ -16,6 +16,9 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <m2CancellationToken.h>
+#include <m2ISpectrumDataAccess.h>
+#include <m2Span.h>
 #include <mitkImage.h>
 #include <vector>
 
@@ -30,9 +33,43 @@ namespace m2
     virtual void GetXValues(unsigned int /*id*/, std::vector<float> &, unsigned int /*source*/) {};
     virtual void GetXValues(unsigned int /*id*/, std::vector<double> &, unsigned int /*source*/) {};
 
+    /**
+     * @brief Write the values of a spectrum into caller-provided memory, which must hold all values of the spectrum.
+     */
+    virtual void GetYValues(unsigned int /*id*/, m2::Span<float>, unsigned int /*source*/) {};
+    virtual void GetYValues(unsigned int /*id*/, m2::Span<double>, unsigned int /*source*/) {};
+    virtual void GetXValues(unsigned int /*id*/, m2::Span<float>, unsigned int /*source*/) {};
+    virtual void GetXValues(unsigned int /*id*/, m2::Span<double>, unsigned int /*source*/) {};
+
     virtual void InitializeImageAccess() {};
     virtual void InitializeGeometry() {};
     virtual void GetImagePrivate(double /*x*/ , double  /*tol*/, const mitk::Image * /*mask*/, mitk::Image * /*target*/) {};
+
+    /**
+     * @brief Like GetImagePrivate, but throws m2::OperationCanceledException once token is cancelled and may
+     * publish previews of target through onRefinement (if set). By default neither is used.
+     */
+    virtual void GetImagePrivate(double x,
+                                 double tol,
+                                 const mitk::Image *mask,
+                                 mitk::Image *target,
+                                 const CancellationToken & /*token*/,
+                                 const ImageRefinementCallback & /*onRefinement*/)
+    {
+      GetImagePrivate(x, tol, mask, target);
+    }
+
+    /**
+     * @brief Generates one ion image per range. By default GetImagePrivate is called for each range.
+     */
+    virtual void GetImagesPrivate(const std::vector<IonImageRange> &ranges,
+                                  const mitk::Image *mask,
+                                  const std::vector<mitk::Image *> &images,
+                                  const CancellationToken &token)
+    {
+      for (size_t i = 0; i < ranges.size(); ++i)
+        GetImagePrivate(ranges[i].mz, ranges[i].tol, mask, images[i], token, nullptr);
+    }
   };
 
 } // namespace m2
\ No newline at end of file
@@ -0,0 +1,224 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <itkIndex.h>
+#include <m2CoreCommon.h>
+#include <m2PeakMatrix.h>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Meta data of the spectra of an image source, stored as structure of arrays.
+   *
+   * Each property (binary data offsets and lengths, pixel index, normalization factors) is held in a column
+   * with one entry per spectrum. Spectra are accessed through lightweight views (see View and ConstView)
+   * returned by operator[] and the iterators; views are invalidated if the number of spectra changes.
+   *
+   * World coordinates and in-file normalization factors are rarely present. Their columns are allocated on first
+   * use, which is not thread-safe: the first Set call must not run concurrently with other accesses to the store.
+   * Peaks picked per spectrum are held in a PeakMatrix with one row per spectrum (see SetPeaks()).
+   */
+  class M2AIACORE_EXPORT SpectrumMetaDataStore
+  {
+  public:
+    using OffsetType = std::uint64_t;
+    using LengthType = std::uint32_t;
+    using IndexType = itk::Index<3>;
+
+    struct WorldCoordinates
+    {
+      double x, y, z;
+    };
+
+    /**
+     * @brief Read-only view of a single spectrum.
+     */
+    class ConstView
+    {
+    public:
+      ConstView(const SpectrumMetaDataStore *store, std::size_t id) noexcept : m_Store(store), m_Id(id) {}
+
+      std::size_t GetId() const noexcept { return m_Id; }
+
+      OffsetType GetMzOffset() const noexcept { return m_Store->m_MzOffsets[m_Id]; }
+      OffsetType GetIntOffset() const noexcept { return m_Store->m_IntOffsets[m_Id]; }
+      LengthType GetMzLength() const noexcept { return m_Store->m_MzLengths[m_Id]; }
+      LengthType GetIntLength() const noexcept { return m_Store->m_IntLengths[m_Id]; }
+
+      IndexType GetIndex() const noexcept
+      {
+        IndexType index;
+        index[0] = m_Store->m_IndexX[m_Id];
+        index[1] = m_Store->m_IndexY[m_Id];
+        index[2] = m_Store->m_IndexZ[m_Id];
+        return index;
+      }
+
+      WorldCoordinates GetWorld() const noexcept
+      {
+        return m_Store->m_World.empty() ? WorldCoordinates{0, 0, 0} : m_Store->m_World[m_Id];
+      }
+
+      NormImagePixelType GetNormalizationFactor() const noexcept { return m_Store->m_NormalizationFactors[m_Id]; }
+
+      NormImagePixelType GetInFileNormalizationFactor() const noexcept
+      {
+        return m_Store->m_InFileNormalizationFactors.empty() ? 1.0 : m_Store->m_InFileNormalizationFactors[m_Id];
+      }
+
+      /**
+       * @brief View of the peaks of the spectrum; empty if no peaks were set.
+       */
+      PeakMatrix::Row GetPeaks() const noexcept;
+
+    protected:
+      const SpectrumMetaDataStore *m_Store;
+      std::size_t m_Id;
+    };
+
+    /**
+     * @brief Writable view of a single spectrum. Like a pointer, a const view still allows modification.
+     */
+    class View : public ConstView
+    {
+    public:
+      View(SpectrumMetaDataStore *store, std::size_t id) noexcept : ConstView(store, id), m_WritableStore(store) {}
+
+      void SetMzOffset(OffsetType offset) const noexcept { m_WritableStore->m_MzOffsets[m_Id] = offset; }
+      void SetIntOffset(OffsetType offset) const noexcept { m_WritableStore->m_IntOffsets[m_Id] = offset; }
+      void SetMzLength(LengthType length) const noexcept { m_WritableStore->m_MzLengths[m_Id] = length; }
+      void SetIntLength(LengthType length) const noexcept { m_WritableStore->m_IntLengths[m_Id] = length; }
+
+      void SetIndex(const IndexType &index) const
+      {
+        for (unsigned int d = 0; d < 3; ++d)
+          SetIndex(d, index[d]);
+      }
+
+      /**
+       * @brief Throws mitk::Exception if value is negative or exceeds the index column of dim (32 bit for x and y,
+       * 16 bit for z).
+       */
+      void SetIndex(unsigned int dim, IndexType::IndexValueType value) const;
+
+      void SetWorld(const WorldCoordinates &world) const;
+
+      void SetNormalizationFactor(NormImagePixelType factor) const noexcept
+      {
+        m_WritableStore->m_NormalizationFactors[m_Id] = factor;
+      }
+
+      void SetInFileNormalizationFactor(NormImagePixelType factor) const;
+
+    private:
+      SpectrumMetaDataStore *m_WritableStore;
+    };
+
+    template <class ViewType, class StorePointerType>
+    class Iterator
+    {
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = ViewType;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = ViewType;
+
+      Iterator(StorePointerType store, std::size_t id) noexcept : m_Store(store), m_Id(id) {}
+
+      ViewType operator*() const noexcept { return ViewType(m_Store, m_Id); }
+      Iterator &operator++() noexcept
+      {
+        ++m_Id;
+        return *this;
+      }
+      Iterator operator++(int) noexcept { return Iterator(m_Store, m_Id++); }
+      bool operator==(const Iterator &other) const noexcept { return m_Id == other.m_Id; }
+      bool operator!=(const Iterator &other) const noexcept { return m_Id != other.m_Id; }
+
+    private:
+      StorePointerType m_Store;
+      std::size_t m_Id;
+    };
+
+    using iterator = Iterator<View, SpectrumMetaDataStore *>;
+    using const_iterator = Iterator<ConstView, const SpectrumMetaDataStore *>;
+
+    std::size_t size() const noexcept { return m_MzOffsets.size(); }
+    bool empty() const noexcept { return m_MzOffsets.empty(); }
+
+    /**
+     * @brief Changes the number of spectra. New spectra are zero-initialized with a normalization factor of 1.
+     */
+    void resize(std::size_t numberOfSpectra);
+    void reserve(std::size_t numberOfSpectra);
+    void clear() noexcept;
+
+    View operator[](std::size_t id) noexcept { return View(this, id); }
+    ConstView operator[](std::size_t id) const noexcept { return ConstView(this, id); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size()); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size()); }
+
+    /**
+     * @brief Appends a zero-initialized spectrum and returns its view.
+     */
+    View AddSpectrum();
+
+    /**
+     * @brief Moves all spectra of other behind the spectra of this store.
+     */
+    void Append(SpectrumMetaDataStore &&other);
+
+    bool HasPeaks() const noexcept { return m_Peaks.GetNumberOfRows() != 0; }
+
+    /**
+     * @brief Replaces the peaks of all spectra. Throws mitk::Exception if the number of rows differs from size().
+     */
+    void SetPeaks(PeakMatrix peaks);
+
+    const PeakMatrix &GetPeaks() const noexcept { return m_Peaks; }
+
+    /**
+     * @brief Approximate number of bytes occupied by the columns and the peaks.
+     */
+    std::size_t GetMemorySize() const noexcept;
+
+  private:
+    std::vector<OffsetType> m_MzOffsets;
+    std::vector<OffsetType> m_IntOffsets;
+    std::vector<LengthType> m_MzLengths;
+    std::vector<LengthType> m_IntLengths;
+    std::vector<std::uint32_t> m_IndexX;
+    std::vector<std::uint32_t> m_IndexY;
+    std::vector<std::uint16_t> m_IndexZ;
+    std::vector<NormImagePixelType> m_NormalizationFactors;
+
+    // optional columns; empty if not used
+    std::vector<WorldCoordinates> m_World;
+    std::vector<NormImagePixelType> m_InFileNormalizationFactors;
+    PeakMatrix m_Peaks;
+  };
+
+} // namespace m2
@@ -0,0 +1,74 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Plans the reads of the byte ranges of spectra from a binary data file.
+   *
+   * Requests are sorted by file offset and neighbouring requests are merged into blocks, so that many small reads
+   * in pixel order become a few large reads in file order. A request is merged into the current block if it starts
+   * at most maxGap bytes behind the block and the block does not grow beyond maxBlockSize bytes. A request larger
+   * than maxBlockSize forms a block of its own.
+   */
+  class M2AIACORE_EXPORT SpectrumReadPlan
+  {
+  public:
+    struct Request
+    {
+      std::uint32_t spectrum;
+      std::uint64_t offset;
+      std::uint64_t numberOfBytes;
+    };
+
+    /**
+     * @brief Contiguous byte range of the file holding the requests [firstRequest, lastRequest).
+     */
+    struct Block
+    {
+      std::uint64_t offset;
+      std::uint64_t numberOfBytes;
+      std::size_t firstRequest;
+      std::size_t lastRequest;
+    };
+
+    static constexpr std::uint64_t DefaultMaxGap = std::uint64_t(64) << 10;
+    static constexpr std::uint64_t DefaultMaxBlockSize = std::uint64_t(8) << 20;
+
+    void Clear() noexcept;
+    void Reserve(std::size_t numberOfRequests);
+    void Add(std::uint32_t spectrum, std::uint64_t offset, std::uint64_t numberOfBytes);
+
+    /**
+     * @brief Sorts the requests by offset and merges them into blocks. Must be called after the last Add().
+     */
+    void Build(std::uint64_t maxGap = DefaultMaxGap, std::uint64_t maxBlockSize = DefaultMaxBlockSize);
+
+    const std::vector<Request> &GetRequests() const noexcept { return m_Requests; }
+    const std::vector<Block> &GetBlocks() const noexcept { return m_Blocks; }
+
+  private:
+    std::vector<Request> m_Requests;
+    std::vector<Block> m_Blocks;
+  };
+
+} // namespace m2
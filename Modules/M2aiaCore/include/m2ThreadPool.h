@@ -0,0 +1,74 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace m2
+{
+  /**
+   * @brief Process-wide pool of worker threads.
+   *
+   * Work is submitted as a job of a number of lanes; each lane is executed exactly once by one thread.
+   * The calling thread executes lanes of its own job as well and only waits for lanes that are already
+   * running on other threads. Therefore Run() may be called from within a lane (nested parallelism)
+   * without the risk of a deadlock, even if all workers are busy.
+   *
+   * The first exception thrown by a lane is rethrown by Run() after all lanes finished.
+   */
+  class M2AIACORE_EXPORT ThreadPool
+  {
+  public:
+    static ThreadPool &GetInstance();
+
+    explicit ThreadPool(unsigned int numberOfWorkers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int GetNumberOfWorkers() const noexcept { return static_cast<unsigned int>(m_Workers.size()); }
+
+    /**
+     * @brief Executes task(lane) for all lanes in [0, numberOfLanes) and blocks until all lanes finished.
+     */
+    void Run(unsigned int numberOfLanes, const std::function<void(unsigned int lane)> &task);
+
+  private:
+    struct Job;
+
+    void WorkerLoop();
+
+    /**
+     * @brief Executes unclaimed lanes of the job until none are left.
+     */
+    static void Execute(Job &job);
+
+    std::vector<std::thread> m_Workers;
+    std::deque<std::shared_ptr<Job>> m_Jobs;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Stop = false;
+  };
+
+} // namespace m2
@@ -0,0 +1,145 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+
+#include <M2aiaCoreExports.h>
+#include <cstdint>
+#include <m2MemoryMappedFile.h>
+#include <m2Span.h>
+#include <memory>
+#include <string>
+
+namespace m2
+{
+  /**
+   * @brief Sidecar file holding the intensities of continuous profile spectra in m/z-major order.
+   *
+   * For each bin of the common m/z axis the values of all pixels (spectra of one image source) are stored
+   * contiguously, i.e. the spectrum matrix is stored transposed. An ion image of the bins [first, first + n)
+   * is pooled from a single contiguous block of n * NumberOfPixels values.
+   * Values are stored in the intensity type of the source (float or double, see Key::ValueSize), so ion images
+   * pooled from the cache equal those read from the binary data. They are stored either raw or after
+   * normalization and signal processing (see Key).
+   */
+  class M2AIACORE_EXPORT TransposedSpectrumCache
+  {
+  public:
+    /**
+     * @brief Identifies the content of a cache file. A cache is only used if all values match.
+     */
+    struct Key
+    {
+      std::uint64_t NumberOfPixels = 0;
+      std::uint64_t NumberOfBins = 0;
+      std::uint64_t SourceFileSize = 0;
+      std::int64_t SourceModificationTime = 0;
+      // 0 for raw intensities, otherwise a hash of the processing parameters
+      std::uint64_t ProcessingHash = 0;
+      // size of a value in bytes: sizeof(float) or sizeof(double)
+      std::uint64_t ValueSize = sizeof(float);
+
+      bool operator==(const Key &other) const noexcept;
+      bool operator!=(const Key &other) const noexcept { return !(*this == other); }
+    };
+
+    static std::string GetDefaultPath(const std::string &binaryDataPath) { return binaryDataPath + ".m2t"; }
+
+    /**
+     * @brief Creates a key for the given binary data file (size and modification time are queried).
+     */
+    static Key MakeKey(const std::string &binaryDataPath,
+                       std::uint64_t numberOfPixels,
+                       std::uint64_t numberOfBins,
+                       std::uint64_t processingHash,
+                       std::uint64_t valueSize = sizeof(float));
+
+    /**
+     * @brief Opens an existing and completely written cache file. Returns nullptr if the file does not exist,
+     * is incomplete or was created for a different key.
+     */
+    static std::shared_ptr<TransposedSpectrumCache> Open(const std::string &path, const Key &key);
+
+    /**
+     * @brief Creates a new cache file. Values are added by Write() and the file is completed by Finalize().
+     * Throws mitk::Exception if the file can not be created.
+     */
+    static std::shared_ptr<TransposedSpectrumCache> Create(const std::string &path, const Key &key);
+
+    /**
+     * @brief Writes the values of numberOfPixels consecutive spectra starting at firstPixel.
+     * values holds the spectra one after another (numberOfPixels x NumberOfBins). Threads may write
+     * disjoint pixel ranges concurrently. Throws mitk::Exception if sizeof(T) differs from Key::ValueSize.
+     */
+    template <class T>
+    void Write(std::uint64_t firstPixel, std::uint64_t numberOfPixels, const T *values)
+    {
+      auto dst = reinterpret_cast<T *>(GetWritableValues(firstPixel, numberOfPixels, sizeof(T)));
+      const auto nBins = m_Key.NumberOfBins;
+      const auto nPixels = m_Key.NumberOfPixels;
+
+      // transpose: contiguous writes of numberOfPixels values per bin
+      for (std::uint64_t bin = 0; bin < nBins; ++bin)
+      {
+        auto row = dst + bin * nPixels + firstPixel;
+        for (std::uint64_t p = 0; p < numberOfPixels; ++p)
+          row[p] = values[p * nBins + bin];
+      }
+    }
+
+    /**
+     * @brief Flushes all values to disk and marks the file as complete. The cache is read-only afterwards.
+     */
+    void Finalize();
+
+    bool IsComplete() const noexcept { return m_Complete; }
+    const Key &GetKey() const noexcept { return m_Key; }
+    bool HoldsProcessedData() const noexcept { return m_Key.ProcessingHash != 0; }
+
+    /**
+     * @brief Values of all pixels for the given bin. sizeof(T) has to equal Key::ValueSize.
+     */
+    template <class T = float>
+    Span<const T> GetBin(std::uint64_t bin) const noexcept
+    {
+      return GetBins<T>(bin, 1);
+    }
+
+    /**
+     * @brief Values of all pixels for the bins [firstBin, firstBin + numberOfBins); bin-major.
+     * sizeof(T) has to equal Key::ValueSize.
+     */
+    template <class T = float>
+    Span<const T> GetBins(std::uint64_t firstBin, std::uint64_t numberOfBins) const noexcept
+    {
+      return Span<const T>(reinterpret_cast<const T *>(m_Values) + firstBin * m_Key.NumberOfPixels,
+                           numberOfBins * m_Key.NumberOfPixels);
+    }
+
+  private:
+    TransposedSpectrumCache() = default;
+
+    /**
+     * @brief Start of the values; throws mitk::Exception if the pixel range or the value size are invalid.
+     */
+    char *GetWritableValues(std::uint64_t firstPixel, std::uint64_t numberOfPixels, std::uint64_t valueSize);
+
+    MemoryMappedFile m_File;
+    Key m_Key;
+    const char *m_Values = nullptr;
+    bool m_Complete = false;
+  };
+
+} // namespace m2
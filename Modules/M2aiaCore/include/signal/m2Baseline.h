@@ -32,7 +32,6 @@ namespace m2
     private:
       BaselineCorrectionType m_strategy;
       int m_hws;
-      const std::function<ItValueType(const ItValueType &, const ItValueType &)> substractBaseline = [](const ItValueType & a, const ItValueType &b){return std::max(ItValueType(0),a-b);};
 
     public:
       void Initialize(BaselineCorrectionType strategy, int hws)
@@ -43,20 +42,30 @@ namespace m2
 
       void operator()(typename std::vector<ItValueType>::iterator start,
                       typename std::vector<ItValueType>::iterator end,
-                      typename std::vector<ItValueType>::iterator baseline_start)
+                      typename std::vector<ItValueType>::iterator baseline_start) const
       {
+        // a lambda instead of a std::function, so that the subtraction is inlined into the loops
+        const auto substractBaseline = [](const ItValueType &a, const ItValueType &b)
+        { return std::max(ItValueType(0), a - b); };
         switch (m_strategy)
         {
           case m2::BaselineCorrectionType::TopHat:
-            m2::Signal::Erosion(start, end, m_hws, baseline_start);
-            m2::Signal::Dilation(
-              baseline_start, std::next(baseline_start, distance(start, end)), m_hws, baseline_start);
+          {
+            if (start == end)
+              break;
+            // reused by all spectra processed on this thread (e.g. per spectrum in FsmSpectrumImage)
+            thread_local MorphologyWorkspace<ItValueType> workspace;
+            m2::Signal::Opening(&*start, &*start + std::distance(start, end), m_hws, &*baseline_start, workspace);
             std::transform(start, end, baseline_start, start, substractBaseline);
             break;
+          }
           case m2::BaselineCorrectionType::Median:
-            m2::RunMedian::apply(start, end, m_hws, baseline_start);
+          {
+            thread_local RunMedian::Workspace<ItValueType> workspace;
+            m2::RunMedian::apply(start, end, m_hws, baseline_start, workspace);
             std::transform(start, end, baseline_start, start, substractBaseline);
             break;
+          }
           case m2::BaselineCorrectionType::None:
             break;
         }
@@ -16,72 +16,481 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <m2Peak.h>
+#include <m2PeakMatrix.h>
+#include <m2Process.hpp>
 #include <numeric>
+#include <utility>
+#include <vector>
 
 namespace m2
 {
   namespace Signal
   {
-
-    template <class PeakItFirst, class PeakItLast, class OutIterType>
-    inline void binPeaks(
-      PeakItFirst s, PeakItLast e, OutIterType output, double tolerance, bool absoluteDistance = false)
+    namespace Binning
     {
-      if (s == e)
-        return;
+      /**
+       * @brief Maximum distance of a peak at x to the mean of its bin.
+       */
+      inline double Tolerance(double x, double tolerance, bool absoluteDistance) noexcept
+      {
+        return absoluteDistance ? tolerance : x * tolerance;
+      }
 
-      unsigned int size = 0;
-      const auto accPeak = std::accumulate(s, e, Peak());
-      const auto meanX = accPeak.GetX();
+      /**
+       * @brief True if no bin can contain both neighbors a <= b.
+       *
+       * A range containing both spans at least b - a, so one of its ends is further than (b - a) / 2 from its mean.
+       * For a relative tolerance the mean is at most the last value v of the range, and v - (b - a) > 2 * v *
+       * tolerance follows from b - a > 2 * b * tolerance for any v >= b.
+       */
+      inline bool IsSeparating(double a, double b, double tolerance, bool absoluteDistance) noexcept
+      {
+        return b - a > 2 * Tolerance(b, tolerance, absoluteDistance);
+      }
 
-      bool dirty = false;
-      decltype(s) i = s;
-      while (i != e)
+      /**
+       * @brief Range queries on the sorted values x(first), ..., x(last - 1): the mean of a range and the positions
+       * of its largest gap and of its separating gaps (see IsSeparating). Gap i is x(i) - x(i - 1).
+       *
+       * The values are divided into blocks of BlockSize values. The sum of each block and its largest, first and
+       * last separating gap are stored, and segment trees over the blocks combine the gaps of consecutive blocks.
+       * A query scans the partial blocks at both ends of a range and takes the full blocks in between from the
+       * prefix sums or the trees, so it takes O(BlockSize + log n) time. The memory is O(n / BlockSize).
+       *
+       * Ranges of up to 2 * BlockSize values are evaluated directly. Longer ranges are summed relative to x(first),
+       * which keeps the rounding error of the mean small compared to the tolerances used for binning.
+       */
+      template <class XFunction>
+      class RangeQueries
       {
-        if (std::abs(i->GetX() - meanX) >= ((meanX * tolerance) * (!absoluteDistance) + (absoluteDistance * tolerance)))
+      public:
+        static constexpr std::size_t BlockSize = 32;
+        static constexpr std::size_t None = std::size_t(-1);
+
+        RangeQueries(XFunction x, double tolerance, bool absoluteDistance)
+          : m_X(x), m_Tolerance(tolerance), m_AbsoluteDistance(absoluteDistance)
         {
-          dirty = true;
-          break;
         }
-        ++i;
-      }
 
-      if (dirty && size >= 2)
+        /**
+         * @brief Prepares the queries for [first, last); the blocks are evaluated with the given number of threads.
+         */
+        void Reset(std::size_t first, std::size_t last, unsigned int threads = 1)
+        {
+          m_First = first;
+          m_Last = std::max(first, last);
+          m_X0 = m_Last > m_First ? m_X(first) : 0;
+          const auto numberOfBlocks = (m_Last - m_First + BlockSize - 1) / BlockSize;
+          m_Leaves = 1;
+          while (m_Leaves < numberOfBlocks)
+            m_Leaves *= 2;
+          m_BlockSums.assign(numberOfBlocks + 1, 0);
+          m_LargestGaps.assign(2 * m_Leaves, None);
+          m_FirstSeparatingGaps.assign(2 * m_Leaves, None);
+          m_LastSeparatingGaps.assign(2 * m_Leaves, None);
+
+          // the sum of block k is stored at m_BlockSums[k + 1] until the prefix sums are formed
+          const auto EvaluateBlocks = [&](std::size_t a, std::size_t b)
+          {
+            for (auto k = a; k < b; ++k)
+            {
+              const auto s = BlockStart(k);
+              const auto e = std::min(s + BlockSize, m_Last);
+              double sum = 0;
+              for (auto i = s; i < e; ++i)
+                sum += m_X(i) - m_X0;
+              m_BlockSums[k + 1] = sum;
+              const auto gapStart = std::max(s, m_First + 1);
+              m_LargestGaps[m_Leaves + k] = ScanLargestGap(gapStart, e);
+              m_FirstSeparatingGaps[m_Leaves + k] = ScanFirstSeparatingGap(gapStart, e);
+              m_LastSeparatingGaps[m_Leaves + k] = ScanLastSeparatingGap(gapStart, e);
+            }
+          };
+          if (threads > 1)
+            m2::Process::ParallelFor(
+              numberOfBlocks, threads, [&](unsigned int, unsigned int a, unsigned int b) { EvaluateBlocks(a, b); });
+          else
+            EvaluateBlocks(0, numberOfBlocks);
+
+          std::partial_sum(m_BlockSums.begin(), m_BlockSums.end(), m_BlockSums.begin());
+          for (auto node = m_Leaves - 1; node > 0; --node)
+          {
+            m_LargestGaps[node] = LargerGap(m_LargestGaps[2 * node], m_LargestGaps[2 * node + 1]);
+            m_FirstSeparatingGaps[node] =
+              FirstGap(m_FirstSeparatingGaps[2 * node], m_FirstSeparatingGaps[2 * node + 1]);
+            m_LastSeparatingGaps[node] = LastGap(m_LastSeparatingGaps[2 * node], m_LastSeparatingGaps[2 * node + 1]);
+          }
+        }
+
+        /**
+         * @brief Mean of x(a), ..., x(b - 1).
+         */
+        double Mean(std::size_t a, std::size_t b) const
+        {
+          if (b - a <= 2 * BlockSize)
+          {
+            double sum = 0;
+            for (auto i = a; i < b; ++i)
+              sum += m_X(i);
+            return sum / double(b - a);
+          }
+          // full blocks [l, r)
+          const auto l = (a - m_First + BlockSize - 1) / BlockSize;
+          const auto r = (b - m_First) / BlockSize;
+          double sum = m_BlockSums[r] - m_BlockSums[l];
+          for (auto i = a; i < BlockStart(l); ++i)
+            sum += m_X(i) - m_X0;
+          for (auto i = BlockStart(r); i < b; ++i)
+            sum += m_X(i) - m_X0;
+          return m_X0 + sum / double(b - a);
+        }
+
+        /**
+         * @brief Largest gap within [a, b), i.e. gap i with a < i < b (the first one on ties); None if b - a < 2.
+         */
+        std::size_t LargestGap(std::size_t a, std::size_t b) const
+        {
+          return Query(a + 1, b, m_LargestGaps, &RangeQueries::ScanLargestGap, &RangeQueries::LargerGap);
+        }
+
+        /**
+         * @brief First separating gap i with a < i < b; None if there is none.
+         */
+        std::size_t FirstSeparatingGap(std::size_t a, std::size_t b) const
+        {
+          return Query(
+            a + 1, b, m_FirstSeparatingGaps, &RangeQueries::ScanFirstSeparatingGap, &RangeQueries::FirstGap);
+        }
+
+        /**
+         * @brief Last separating gap i with a < i < b; None if there is none.
+         */
+        std::size_t LastSeparatingGap(std::size_t a, std::size_t b) const
+        {
+          return Query(a + 1, b, m_LastSeparatingGaps, &RangeQueries::ScanLastSeparatingGap, &RangeQueries::LastGap);
+        }
+
+        /**
+         * @brief True if all values of [a, b) are within the tolerance of their mean.
+         */
+        bool IsBin(std::size_t a, std::size_t b) const
+        {
+          if (b - a < 2)
+            return true;
+          const double mean = Mean(a, b);
+          const double maxDistance = Tolerance(mean, m_Tolerance, m_AbsoluteDistance);
+          return mean - m_X(a) <= maxDistance && m_X(b - 1) - mean <= maxDistance;
+        }
+
+      private:
+        using ScanFunction = std::size_t (RangeQueries::*)(std::size_t, std::size_t) const;
+        using CombineFunction = std::size_t (RangeQueries::*)(std::size_t, std::size_t) const;
+
+        std::size_t BlockStart(std::size_t k) const noexcept { return m_First + k * BlockSize; }
+
+        double Gap(std::size_t i) const { return m_X(i) - m_X(i - 1); }
+
+        std::size_t LargerGap(std::size_t i, std::size_t j) const
+        {
+          if (i == None || j == None)
+            return i == None ? j : i;
+          const auto gi = Gap(i);
+          const auto gj = Gap(j);
+          return (gi > gj || (gi == gj && i < j)) ? i : j;
+        }
+
+        std::size_t FirstGap(std::size_t i, std::size_t j) const { return std::min(i, j); }
+
+        std::size_t LastGap(std::size_t i, std::size_t j) const
+        {
+          if (i == None || j == None)
+            return i == None ? j : i;
+          return std::max(i, j);
+        }
+
+        std::size_t ScanLargestGap(std::size_t a, std::size_t b) const
+        {
+          auto result = None;
+          for (auto i = a; i < b; ++i)
+            if (result == None || Gap(i) > Gap(result))
+              result = i;
+          return result;
+        }
+
+        std::size_t ScanFirstSeparatingGap(std::size_t a, std::size_t b) const
+        {
+          for (auto i = a; i < b; ++i)
+            if (IsSeparating(m_X(i - 1), m_X(i), m_Tolerance, m_AbsoluteDistance))
+              return i;
+          return None;
+        }
+
+        std::size_t ScanLastSeparatingGap(std::size_t a, std::size_t b) const
+        {
+          for (auto i = b; i > a; --i)
+            if (IsSeparating(m_X(i - 2), m_X(i - 1), m_Tolerance, m_AbsoluteDistance))
+              return i - 1;
+          return None;
+        }
+
+        // combines the gaps [lo, hi); partial blocks are scanned, full blocks are taken from the tree
+        std::size_t Query(std::size_t lo,
+                          std::size_t hi,
+                          const std::vector<std::size_t> &tree,
+                          ScanFunction scan,
+                          CombineFunction combine) const
+        {
+          if (hi <= lo + 2 * BlockSize)
+            return (this->*scan)(lo, hi);
+
+          auto l = (lo - m_First + BlockSize - 1) / BlockSize;
+          auto r = (hi - m_First) / BlockSize;
+          auto result = (this->*combine)((this->*scan)(lo, BlockStart(l)), (this->*scan)(BlockStart(r), hi));
+          for (l += m_Leaves, r += m_Leaves; l < r; l /= 2, r /= 2)
+          {
+            if (l & 1)
+              result = (this->*combine)(result, tree[l++]);
+            if (r & 1)
+              result = (this->*combine)(result, tree[--r]);
+          }
+          return result;
+        }
+
+        XFunction m_X;
+        double m_Tolerance;
+        bool m_AbsoluteDistance;
+        std::size_t m_First = 0;
+        std::size_t m_Last = 0;
+        std::size_t m_Leaves = 1;
+        double m_X0 = 0;
+        std::vector<double> m_BlockSums;
+        std::vector<std::size_t> m_LargestGaps;
+        std::vector<std::size_t> m_FirstSeparatingGaps;
+        std::vector<std::size_t> m_LastSeparatingGaps;
+      };
+
+      template <class XFunction>
+      constexpr std::size_t RangeQueries<XFunction>::BlockSize;
+
+      template <class XFunction>
+      constexpr std::size_t RangeQueries<XFunction>::None;
+
+      /**
+       * @brief Groups the sorted values x(first), ..., x(last - 1) into bins and calls bin(a, b) for each bin [a, b)
+       * in ascending order.
+       *
+       * The values are split into segments at separating gaps (see IsSeparating). A range is a bin if all of its
+       * values are within the tolerance of its mean, otherwise it is split at its largest gap (the first one on
+       * ties) and both parts are processed in turn. Ranges are kept on an explicit stack instead of recursion.
+       * Means and largest gaps are taken from RangeQueries, so binning takes O(n log n) time even if each split
+       * only separates a single value, e.g. for monotonically growing gaps.
+       */
+      template <class XFunction, class BinFunction>
+      inline void ForEachBin(std::size_t first,
+                             std::size_t last,
+                             XFunction x,
+                             double tolerance,
+                             bool absoluteDistance,
+                             BinFunction bin)
       {
-        decltype(s) pivot;
+        RangeQueries<XFunction> queries(x, tolerance, absoluteDistance);
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        while (first < last)
         {
-          decltype(s) s0 = s;
-          decltype(s) s1 = std::next(s);
-          pivot = s1;
-          double max = 0; // max distance of mz neighbors is split position
-          while (s1 != e)
+          auto segmentEnd = first + 1;
+          while (segmentEnd != last && !IsSeparating(x(segmentEnd - 1), x(segmentEnd), tolerance, absoluteDistance))
+            ++segmentEnd;
+
+          if (segmentEnd - first > 1)
+            queries.Reset(first, segmentEnd);
+          ranges.emplace_back(first, segmentEnd);
+          while (!ranges.empty())
           {
-            if (s1->GetX() - s0->GetX() > max)
+            const auto a = ranges.back().first;
+            const auto b = ranges.back().second;
+            ranges.pop_back();
+            if (queries.IsBin(a, b))
             {
-              max = s1->GetX() - s0->GetX();
-              pivot = s1;
+              bin(a, b);
+              continue;
             }
-            ++s1;
-            ++s0;
+            const auto pivot = queries.LargestGap(a, b);
+            ranges.emplace_back(pivot, b);
+            ranges.emplace_back(a, pivot);
           }
+          first = segmentEnd;
         }
+      }
+    } // namespace Binning
 
-        binPeaks(s, pivot, output, tolerance, absoluteDistance);
-        binPeaks(pivot, e, output, tolerance, absoluteDistance);
+    /**
+     * @brief Bins the peaks [s, e), which have to be sorted by m/z (random access iterators), see
+     * Binning::ForEachBin. Each bin is written to output as the sum of its peaks (see m2::Peak::Insert).
+     */
+    template <class PeakItFirst, class PeakItLast, class OutIterType>
+    inline void binPeaks(
+      PeakItFirst s, PeakItLast e, OutIterType output, double tolerance, bool absoluteDistance = false)
+    {
+      Binning::ForEachBin(
+        0,
+        std::distance(s, e),
+        [s](std::size_t i) { return s[i].GetX(); },
+        tolerance,
+        absoluteDistance,
+        [&](std::size_t a, std::size_t b)
+        {
+          m2::Peak newPeak = s[a];
+          for (auto i = a + 1; i < b; ++i)
+            newPeak.Insert(s[i]);
+          (*output) = newPeak;
+          ++output;
+        });
+    }
+
+    /**
+     * @brief Bins the peaks of many spectra, e.g. all peaks of a PeakMatrix, across spectra.
+     *
+     * The peaks are sorted by m/z once (see m2::Process::ParallelSort) and binned as by binPeaks. The sorted peaks
+     * are divided top-down into pieces that are binned in parallel: a range is split at the separating gap closest
+     * to its middle or, if it contains none and is not a bin, at its largest gap, as ForEachBin would split it. So
+     * the pieces are binned independently without changing the result, also for dense data without separating gaps.
+     * Apart from the sorted copy of the input, memory is only required for the bins.
+     *
+     * Each bin is returned as m2::Peak: GetX() is the centroid m/z, GetY() the mean and GetYMax() the maximum
+     * intensity, GetCount() the number of binned peaks (e.g. the number of spectra showing the peak). The index of
+     * the bins is 0.
+     */
+    class PeakBinning
+    {
+    public:
+      PeakBinning(double tolerance, bool absoluteDistance = false, unsigned int threads = 1)
+        : m_Tolerance(tolerance), m_AbsoluteDistance(absoluteDistance), m_Threads(std::max(1u, threads))
+      {
+      }
+
+      /**
+       * @brief Bins n peaks given by their m/z values and intensities. The m/z values have to be sorted.
+       */
+      template <class MzType, class IntensityType>
+      std::vector<Peak> operator()(const MzType *mzs, const IntensityType *intensities, std::size_t n) const
+      {
+        return Apply(
+          n, [mzs](std::size_t i) { return double(mzs[i]); }, [intensities](std::size_t i) { return intensities[i]; });
       }
-      else
+
+      /**
+       * @brief Bins all peaks of the matrix.
+       */
+      template <class MzType>
+      std::vector<Peak> operator()(const BasicPeakMatrix<MzType> &matrix) const
+      {
+        using PeakType = std::pair<MzType, typename BasicPeakMatrix<MzType>::IntensityType>;
+        const auto mzs = matrix.GetMzs();
+        const auto intensities = matrix.GetIntensities();
+        std::vector<PeakType> peaks(mzs.size());
+        m2::Process::ParallelFor(peaks.size(),
+                                 m_Threads,
+                                 [&](unsigned int, unsigned int a, unsigned int b)
+                                 {
+                                   for (unsigned int i = a; i < b; ++i)
+                                     peaks[i] = PeakType(mzs[i], intensities[i]);
+                                 });
+        m2::Process::ParallelSort(peaks.begin(),
+                                  peaks.end(),
+                                  m_Threads,
+                                  [](const PeakType &a, const PeakType &b) { return a.first < b.first; });
+        return Apply(
+          peaks.size(),
+          [&peaks](std::size_t i) { return double(peaks[i].first); },
+          [&peaks](std::size_t i) { return peaks[i].second; });
+      }
+
+    private:
+      template <class XFunction, class YFunction>
+      std::vector<Peak> Apply(std::size_t n, XFunction x, YFunction y) const
       {
-        // output a new peak
-        m2::Peak newPeak = *s;
-        ++s;
+        using Range = std::pair<std::size_t, std::size_t>;
+        Binning::RangeQueries<XFunction> queries(x, m_Tolerance, m_AbsoluteDistance);
+        queries.Reset(0, n, m_Threads);
+
+        // ranges larger than pieceSize are split; the number of splits is bounded, as a split may only separate a
+        // single value from a range without separating gaps (remaining ranges are binned as they are)
+        const auto pieceSize = std::max<std::size_t>(64, n / (16 * m_Threads));
+        auto remainingSplits = 64 * (n / pieceSize + 1);
+        std::vector<Range> pieces;
+        std::vector<Range> ranges;
+        if (n > 0)
+          ranges.emplace_back(0, n);
+        while (!ranges.empty())
+        {
+          const auto a = ranges.back().first;
+          const auto b = ranges.back().second;
+          ranges.pop_back();
+          if (b - a <= pieceSize || remainingSplits == 0)
+          {
+            pieces.emplace_back(a, b);
+            continue;
+          }
+          --remainingSplits;
+
+          const auto mid = a + (b - a) / 2;
+          const auto right = queries.FirstSeparatingGap(mid - 1, b);
+          const auto left = queries.LastSeparatingGap(a, mid);
+          auto pivot = (right == queries.None || (left != queries.None && mid - left <= right - mid)) ? left : right;
+          if (pivot == queries.None)
+          {
+            if (queries.IsBin(a, b))
+            {
+              pieces.emplace_back(a, b);
+              continue;
+            }
+            pivot = queries.LargestGap(a, b);
+          }
+          ranges.emplace_back(pivot, b);
+          ranges.emplace_back(a, pivot);
+        }
 
-        std::for_each(s, e, [&newPeak](const Peak &p) { newPeak.Insert(p); });
+        std::vector<std::vector<Peak>> pieceBins(pieces.size());
+        m2::Process::ParallelFor(pieces.size(),
+                                 m_Threads,
+                                 [&](unsigned int, unsigned int a, unsigned int b)
+                                 {
+                                   for (auto p = a; p < b; ++p)
+                                     Binning::ForEachBin(pieces[p].first,
+                                                         pieces[p].second,
+                                                         x,
+                                                         m_Tolerance,
+                                                         m_AbsoluteDistance,
+                                                         [&](std::size_t s, std::size_t e)
+                                                         {
+                                                           Peak bin;
+                                                           for (auto i = s; i < e; ++i)
+                                                             bin.Insert(0, x(i), y(i));
+                                                           pieceBins[p].push_back(bin);
+                                                         });
+                                 });
 
-        (*output) = newPeak;
-        ++output;
+        std::vector<Peak> bins;
+        bins.reserve(std::accumulate(pieceBins.begin(),
+                                     pieceBins.end(),
+                                     std::size_t(0),
+                                     [](std::size_t sum, const std::vector<Peak> &v) { return sum + v.size(); }));
+        for (auto &piece : pieceBins)
+        {
+          bins.insert(bins.end(), piece.begin(), piece.end());
+          piece = std::vector<Peak>();
+        }
+        return bins;
       }
-    }
+
+      double m_Tolerance;
+      bool m_AbsoluteDistance;
+      unsigned int m_Threads;
+    };
 
     template <class XIt, class YIt, class OutIterType>
     inline void binning(
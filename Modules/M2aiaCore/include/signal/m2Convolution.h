@@ -0,0 +1,121 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace m2
+{
+  namespace Signal
+  {
+    /**
+     * @brief Convolution of signals with a kernel of odd size (e.g. Savitzky-Golay or Gaussian smoothing). Values
+     * beyond the borders of a signal repeat its first and last value.
+     *
+     * The kernel is converted to the value type of the signal once. Output values that need border values are
+     * computed with clamped indices, so the signal is not copied into an extended buffer. The remaining values are
+     * computed in tiles that fit into the L1 cache: for each kernel coefficient, the tile accumulates the scaled and
+     * shifted input in a contiguous loop, which the compiler vectorizes for the target instruction set. Each output
+     * value still sums the products of the kernel coefficients in kernel order.
+     */
+    template <class T>
+    class Convolution
+    {
+    public:
+      Convolution() = default;
+
+      template <class KernelType>
+      explicit Convolution(const std::vector<KernelType> &kernel) : m_Kernel(kernel.begin(), kernel.end())
+      {
+      }
+
+      /**
+       * @brief True if no kernel was given, in which case the convolution must not be applied.
+       */
+      bool IsEmpty() const noexcept { return m_Kernel.empty(); }
+
+      std::size_t GetHalfWindowSize() const noexcept { return m_Kernel.size() / 2; }
+
+      /**
+       * @brief Writes the convolution of input[0..n) to output[0..n). The ranges must not overlap.
+       */
+      void operator()(const T *input, T *output, std::size_t n) const noexcept
+      {
+        const std::size_t w = m_Kernel.size();
+        const std::size_t hws = w / 2;
+        if (n == 0 || w == 0)
+          return;
+
+        if (n <= 2 * hws)
+        {
+          ConvolveBorder(input, output, n, 0, n);
+          return;
+        }
+
+        ConvolveBorder(input, output, n, 0, hws);
+        ConvolveInterior(input, output, hws, n - hws);
+        ConvolveBorder(input, output, n, n - hws, n);
+      }
+
+    private:
+      // 4 kB of doubles, so that the tile and the corresponding input stay in the L1 cache
+      static constexpr std::size_t TileSize = 512;
+
+      // output[j] for j in [first, last) with indices clamped to [0, n)
+      void ConvolveBorder(const T *input, T *output, std::size_t n, std::size_t first, std::size_t last) const noexcept
+      {
+        const std::size_t w = m_Kernel.size();
+        const std::ptrdiff_t hws = w / 2;
+        for (std::size_t j = first; j < last; ++j)
+        {
+          T acc = T(0);
+          for (std::size_t i = 0; i < w; ++i)
+          {
+            const std::ptrdiff_t k = std::ptrdiff_t(j + i) - hws;
+            acc = acc + m_Kernel[i] * input[std::min<std::ptrdiff_t>(std::max<std::ptrdiff_t>(k, 0), n - 1)];
+          }
+          output[j] = acc;
+        }
+      }
+
+      // output[j] for j in [first, last), where all input indices are in range
+      void ConvolveInterior(const T *input, T *output, std::size_t first, std::size_t last) const noexcept
+      {
+        const std::size_t w = m_Kernel.size();
+        const std::size_t hws = w / 2;
+        const T *kernel = m_Kernel.data();
+        T acc[TileSize];
+        for (std::size_t tileStart = first; tileStart < last; tileStart += TileSize)
+        {
+          const std::size_t length = last - tileStart < TileSize ? last - tileStart : TileSize;
+          const T *x = input + tileStart - hws;
+          std::fill(acc, acc + length, T(0));
+          for (std::size_t i = 0; i < w; ++i, ++x)
+          {
+            const T k = kernel[i];
+            for (std::size_t j = 0; j < length; ++j)
+              acc[j] = acc[j] + k * x[j];
+          }
+          std::copy(acc, acc + length, output + tileStart);
+        }
+      }
+
+      std::vector<T> m_Kernel;
+    };
+
+  } // namespace Signal
+} // namespace m2
@@ -17,98 +17,195 @@ See LICENSE.txt for details.
 
 #include <M2aiaCoreExports.h>
 #include <algorithm>
-#include <cstring>
 #include <functional>
+#include <iterator>
 #include <vector>
 namespace m2
 {
   namespace Signal
   {
-    template <class IteratorType, class U>
-    void MorphologicalOperation(IteratorType start, IteratorType end, unsigned int s, IteratorType output, U cmp = U()) noexcept
+    /**
+     * @brief Buffers of the morphological operations; they grow to the largest signal and can be reused.
+     */
+    template <class T>
+    struct MorphologyWorkspace
     {
-      unsigned int n = std::distance(start,end);
-      using T = typename IteratorType::value_type;
       std::vector<T> f, g, h;
-      unsigned int fn, k, q, i, r, j, gi, hi;
-
-      q = s;
-      k = 2 * q + 1;
-
-      fn = n + 2 * q + (k - (n % k));
-      f.resize(fn, 0);
-      g.resize(fn, 0);
-      h.resize(fn, 0);
+    };
 
-      T *data_y = &(*start);
-      T *data_f = f.data();
-      T *data_g = g.data();
-      T *data_h = h.data();
-      T *data_out = &(*output);
+    namespace Morphology
+    {
+      /**
+       * @brief Selects the larger value as std::max does; compiles to a branchless maximum for float and double.
+       */
+      struct Maximum
+      {
+        template <class T>
+        T operator()(const T &a, const T &b) const noexcept
+        {
+          return a < b ? b : a;
+        }
+      };
 
-      memcpy(data_f + q, data_y, n * sizeof(T));
-      for (i = 0; i < q; ++i)
+      /**
+       * @brief Selects the smaller value as std::min does.
+       */
+      struct Minimum
       {
-        data_f[i] = data_f[q];
-        data_h[i] = data_f[q];
+        template <class T>
+        T operator()(const T &a, const T &b) const noexcept
+        {
+          return b < a ? b : a;
+        }
+      };
+
+      /**
+       * @brief Resizes the buffers of the workspace for a signal of n values and a window of 2q+1 values. The buffers
+       * are not cleared; the van Herk/Gil-Werman passes write every value they read.
+       */
+      template <class T>
+      unsigned int PrepareWorkspace(MorphologyWorkspace<T> &workspace, unsigned int n, unsigned int q)
+      {
+        const unsigned int k = 2 * q + 1;
+        const unsigned int fn = n + 2 * q + (k - (n % k));
+        workspace.f.resize(fn);
+        workspace.g.resize(fn);
+        workspace.h.resize(fn);
+        return fn;
       }
-      r = q + n - 1;
-      for (i = q + n; i < fn; ++i)
+
+      /**
+       * @brief Repeats the first and last value of the signal in f[q, q+n) to the borders of f.
+       */
+      template <class T>
+      void ExtendBorders(T *f, unsigned int n, unsigned int q, unsigned int fn) noexcept
       {
-        data_f[i] = data_f[r];
-        data_g[i] = data_f[r];
+        std::fill(f, f + q, f[q]);
+        std::fill(f + q + n, f + fn, f[q + n - 1]);
       }
 
-      for (i = q, r = i + k - 1; i < n + q; i += k, r += k)
+      /**
+       * @brief Van Herk/Gil-Werman running selection over windows of 2q+1 values of the extended signal f: running
+       * selections from the left (g) and from the right (h) within blocks of the window size, merged in one pass.
+       * Writes the n results to out, which may point to f + q.
+       */
+      template <class T, class Select>
+      void VanHerk(const T *f, T *g, T *h, unsigned int n, unsigned int q, T *out, Select select) noexcept
       {
-        data_g[i] = data_f[i];
-        data_h[r] = data_f[r];
+        const unsigned int k = 2 * q + 1;
+        const unsigned int fn = n + 2 * q + (k - (n % k));
+        unsigned int i, r, j, gi, hi;
 
-        for (j = 1, gi = i + 1, hi = r - 1; j < k; ++j, ++gi, --hi)
+        for (i = 0; i < q; ++i)
+          h[i] = f[q];
+        r = q + n - 1;
+        for (i = q + n; i < fn; ++i)
+          g[i] = f[r];
+
+        for (i = q, r = i + k - 1; i < n + q; i += k, r += k)
         {
-          if (cmp(data_g[gi - 1], data_f[gi]))
-          {
-            data_g[gi] = data_f[gi];
-          }
-          else
-          {
-            data_g[gi] = data_g[gi - 1];
-          }
-          if (cmp(data_h[hi + 1], data_f[hi]))
-          {
-            data_h[hi] = data_f[hi];
-          }
-          else
+          g[i] = f[i];
+          h[r] = f[r];
+
+          for (j = 1, gi = i + 1, hi = r - 1; j < k; ++j, ++gi, --hi)
           {
-            data_h[hi] = data_h[hi + 1];
+            g[gi] = select(g[gi - 1], f[gi]);
+            h[hi] = select(h[hi + 1], f[hi]);
           }
         }
-      }
 
-      for (i = 0, gi = k - 1, hi = 0; i < n; ++i, ++gi, ++hi)
-      {
-        if (cmp(data_g[gi], data_h[hi]))
-        {
-          data_out[i] = data_h[hi];
-        }
-        else
-        {
-          data_out[i] = data_g[gi];
-        }
+        for (i = 0, gi = k - 1, hi = 0; i < n; ++i, ++gi, ++hi)
+          out[i] = select(g[gi], h[hi]);
       }
+    } // namespace Morphology
+
+    template <class IteratorType, class U>
+    void MorphologicalOperation(IteratorType start,
+                                IteratorType end,
+                                unsigned int s,
+                                IteratorType output,
+                                MorphologyWorkspace<typename std::iterator_traits<IteratorType>::value_type> &workspace,
+                                U cmp = U())
+    {
+      using T = typename std::iterator_traits<IteratorType>::value_type;
+      const unsigned int n = std::distance(start, end);
+      if (n == 0)
+        return;
+      const unsigned int fn = Morphology::PrepareWorkspace(workspace, n, s);
+      T *f = workspace.f.data();
+
+      std::copy(start, end, f + s);
+      Morphology::ExtendBorders(f, n, s, fn);
+      Morphology::VanHerk(f,
+                          workspace.g.data(),
+                          workspace.h.data(),
+                          n,
+                          s,
+                          &(*output),
+                          [&cmp](const T &a, const T &b) { return cmp(a, b) ? b : a; });
+    }
+
+    template <class IteratorType, class U>
+    void MorphologicalOperation(IteratorType start, IteratorType end, unsigned int s, IteratorType output, U cmp = U())
+    {
+      MorphologyWorkspace<typename std::iterator_traits<IteratorType>::value_type> workspace;
+      MorphologicalOperation(start, end, s, output, workspace, cmp);
     }
 
     template <class IteratorType>
-    void Dilation(IteratorType start, IteratorType end, unsigned int s, IteratorType output) noexcept
+    void Dilation(IteratorType start, IteratorType end, unsigned int s, IteratorType output)
     {
       m2::Signal::MorphologicalOperation<IteratorType, std::less<>>(start, end, s, output);
     }
 
     template <class IteratorType>
-    void Erosion(IteratorType start, IteratorType end, unsigned int s, IteratorType output) noexcept
+    void Erosion(IteratorType start, IteratorType end, unsigned int s, IteratorType output)
     {
       m2::Signal::MorphologicalOperation<IteratorType, std::greater<>>(start, end, s, output);
     }
 
+    template <class IteratorType>
+    void Dilation(IteratorType start,
+                  IteratorType end,
+                  unsigned int s,
+                  IteratorType output,
+                  MorphologyWorkspace<typename std::iterator_traits<IteratorType>::value_type> &workspace)
+    {
+      m2::Signal::MorphologicalOperation(start, end, s, output, workspace, std::less<>());
+    }
+
+    template <class IteratorType>
+    void Erosion(IteratorType start,
+                 IteratorType end,
+                 unsigned int s,
+                 IteratorType output,
+                 MorphologyWorkspace<typename std::iterator_traits<IteratorType>::value_type> &workspace)
+    {
+      m2::Signal::MorphologicalOperation(start, end, s, output, workspace, std::greater<>());
+    }
+
+    /**
+     * @brief Opening (erosion followed by dilation) with a window of 2s+1 values, e.g. the baseline of a TopHat
+     * baseline correction. Equals Dilation(Erosion(signal)), but the erosion writes its result directly into the
+     * extended signal of the dilation and both use the buffers of the workspace. output may equal start.
+     */
+    template <class T>
+    void Opening(const T *start, const T *end, unsigned int s, T *output, MorphologyWorkspace<T> &workspace)
+    {
+      const unsigned int n = end - start;
+      if (n == 0)
+        return;
+      const unsigned int fn = Morphology::PrepareWorkspace(workspace, n, s);
+      T *f = workspace.f.data();
+      T *g = workspace.g.data();
+      T *h = workspace.h.data();
+
+      std::copy(start, end, f + s);
+      Morphology::ExtendBorders(f, n, s, fn);
+      Morphology::VanHerk(f, g, h, n, s, f + s, Morphology::Minimum());
+      Morphology::ExtendBorders(f, n, s, fn);
+      Morphology::VanHerk(f, g, h, n, s, output, Morphology::Maximum());
+    }
+
   }; // namespace Signal
 } // namespace m2
@@ -17,6 +17,7 @@ See LICENSE.txt for details.
 
 #include <M2aiaCoreExports.h>
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <mitkExceptionMacro.h>
 #include <numeric>
@@ -16,7 +16,15 @@ See LICENSE.txt for details.
 #pragma once
 
 #include <M2aiaCoreExports.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <m2CoreCommon.h>
+#include <m2PeakMatrix.h>
+#include <m2Process.hpp>
+#include <numeric>
 #include <signal/m2MedianAbsoluteDeviation.h>
 #include <signal/m2Binning.h>
 #include <vector>
@@ -26,35 +34,6 @@ namespace m2
 {
   namespace Signal
   {
-    template <class FirstIt, class LastIt, class RefFirstIt, class RefLastIt, class OutFirstIt>
-    inline void findMatches(
-      FirstIt iIt, LastIt iItEnd, RefFirstIt rIt, RefLastIt rItEnd, OutFirstIt oIt, double tolerance)
-    {
-      for (; iIt != iItEnd; ++iIt)
-      {
-        double diff = std::numeric_limits<double>::max();
-        decltype(rIt) rItTemp = rItEnd;
-        decltype(rIt) rItCp = rIt;
-        for (; rItCp != rItEnd; ++rItCp)
-        {
-          if (std::abs(iIt->mass - rItCp->mass) <= (rItCp->mass * tolerance))
-          {
-            if (std::abs(iIt->intensity - rItCp->intensity) < diff)
-            {
-              rItTemp = rItCp;
-              diff = std::abs(iIt->intensity - rItCp->intensity);
-            }
-          }
-        }
-        if (rItTemp != rItEnd)
-        {
-          (*oIt) = {*iIt, *rItTemp};
-          ++oIt;
-        }
-      }
-    }
-
-    
     template <typename IntsItFirst, typename IntsItLast, typename MzsItFirst, typename PeakMzIntDestItFirst>
     inline auto localMaxima(IntsItFirst intsInFirst,
                             IntsItLast intsInLast,
@@ -367,32 +346,255 @@ namespace m2
       return peaks;
     }
 
+    /**
+     * @brief Exponential search for the first element in [first, last) for which comp(element, value) is false.
+     * The range has to be partitioned with respect to comp. Requires O(log d) comparisons, where d is the distance
+     * of the result from first.
+     */
+    template <class ItType, class ValueType, class CompareType>
+    inline ItType GallopingSearch(ItType first, ItType last, const ValueType &value, CompareType comp) noexcept
+    {
+      typename std::iterator_traits<ItType>::difference_type step = 1;
+      while (step < std::distance(first, last) && comp(*std::next(first, step), value))
+      {
+        std::advance(first, step);
+        step *= 2;
+      }
+      const auto bound = step < std::distance(first, last) ? std::next(first, step + 1) : last;
+      return std::lower_bound(first, bound, value, comp);
+    }
+
+    /**
+     * @brief Returns the index of the first element of mzs in [lower, upper] and the number of elements
+     * within the closed interval [lower, upper]. mzs has to be sorted in ascending order.
+     * If no element is within the interval, the length is 0 and the index is the position where lower would be
+     * inserted (mzs.size() if lower exceeds all elements).
+     */
     template <class MassAxisType>
     inline auto Subrange(const MassAxisType &mzs, const double &lower, const double &upper) noexcept
       -> std::pair<unsigned int, unsigned int>
     {
-      auto start = mzs.cend() - 1;
-      auto end = mzs.cend();
-      for (auto it = mzs.cbegin(); it < mzs.cend(); ++it)
+      const auto start = std::lower_bound(mzs.cbegin(), mzs.cend(), lower);
+      const auto end =
+        std::upper_bound(start, mzs.cend(), upper, [](const double &v, const auto &mz) { return v < mz; });
+      return {std::distance(mzs.cbegin(), start), std::distance(start, end)};
+    }
+
+    /**
+     * @brief Subrange(mzs, lower, upper) using the result of a previous call as hint.
+     * If the ranges are processed in ascending order, the search starts at the previous result and
+     * requires O(log d) comparisons for a distance d between two consecutive results. Unsorted ranges
+     * or invalid hints fall back to a binary search over all elements; the result is always the same as of
+     * Subrange(mzs, lower, upper).
+     */
+    template <class MassAxisType>
+    inline auto Subrange(const MassAxisType &mzs,
+                         const double &lower,
+                         const double &upper,
+                         const std::pair<unsigned int, unsigned int> &hint) noexcept
+      -> std::pair<unsigned int, unsigned int>
+    {
+      const auto size = static_cast<unsigned int>(std::distance(mzs.cbegin(), mzs.cend()));
+      // all elements in front of the hint have to be less than lower
+      if (hint.first > size || (hint.first > 0 && !(*std::next(mzs.cbegin(), hint.first - 1) < lower)))
+        return Subrange(mzs, lower, upper);
+
+      using ValueType = typename std::iterator_traits<decltype(mzs.cbegin())>::value_type;
+      const auto start = GallopingSearch(std::next(mzs.cbegin(), hint.first),
+                                         mzs.cend(),
+                                         lower,
+                                         [](const ValueType &mz, const double &v) { return mz < v; });
+      const auto end =
+        GallopingSearch(start, mzs.cend(), upper, [](const ValueType &mz, const double &v) { return !(v < mz); });
+      return {std::distance(mzs.cbegin(), start), std::distance(start, end)};
+    }
+
+    /**
+     * @brief The references r that match the mass x within a relative tolerance, i.e. |x - r| <= r * tolerance.
+     * The references have to be sorted by mass; mass(reference) returns the mass of a reference.
+     *
+     * If the masses are queried in ascending order, the window is advanced from the previous one by galloping
+     * (two-pointer merge of the queries and the references), which requires O(log d) comparisons for a distance
+     * d between two consecutive windows. A query below the previous one restarts at the first reference.
+     */
+    template <class RefIt, class MassFunction>
+    class ReferenceWindow
+    {
+    public:
+      ReferenceWindow(RefIt first, RefIt last, double tolerance, MassFunction mass)
+        : m_First(first), m_Last(last), m_Begin(first), m_Tolerance(tolerance), m_Mass(mass)
+      {
+      }
+
+      std::pair<RefIt, RefIt> operator()(double x)
+      {
+        if (x < m_X)
+          m_Begin = m_First;
+        m_X = x;
+
+        // the same expressions as |x - r| <= r * tolerance for r < x and r >= x, both monotonic in r
+        m_Begin = GallopingSearch(m_Begin,
+                                  m_Last,
+                                  x,
+                                  [this](const auto &reference, double v)
+                                  {
+                                    const double r = m_Mass(reference);
+                                    return v - r > r * m_Tolerance;
+                                  });
+        const auto end = GallopingSearch(m_Begin,
+                                         m_Last,
+                                         x,
+                                         [this](const auto &reference, double v)
+                                         {
+                                           const double r = m_Mass(reference);
+                                           return !(r - v > r * m_Tolerance);
+                                         });
+        return {m_Begin, end};
+      }
+
+    private:
+      RefIt m_First, m_Last, m_Begin;
+      double m_Tolerance;
+      MassFunction m_Mass;
+      double m_X = std::numeric_limits<double>::lowest();
+    };
+
+    template <class RefIt, class MassFunction>
+    inline ReferenceWindow<RefIt, MassFunction> MakeReferenceWindow(RefIt first,
+                                                                    RefIt last,
+                                                                    double tolerance,
+                                                                    MassFunction mass)
+    {
+      return ReferenceWindow<RefIt, MassFunction>(first, last, tolerance, mass);
+    }
+
+    /**
+     * @brief For each input (element with members mass and intensity), the reference with the closest intensity
+     * among all references with |input.mass - reference.mass| <= reference.mass * tolerance is written to oIt as
+     * {input, reference}, in the order of the inputs. On ties, the first reference is taken.
+     *
+     * Inputs and references are sorted by mass (as iterators, the elements are not copied) and matched by
+     * ReferenceWindow, i.e. in O((N + M) log(N + M)) instead of comparing all pairs.
+     */
+    template <class FirstIt, class LastIt, class RefFirstIt, class RefLastIt, class OutFirstIt>
+    inline void findMatches(
+      FirstIt iIt, LastIt iItEnd, RefFirstIt rIt, RefLastIt rItEnd, OutFirstIt oIt, double tolerance)
+    {
+      std::vector<FirstIt> inputs;
+      for (; iIt != iItEnd; ++iIt)
+        inputs.push_back(iIt);
+
+      // references with their position, which decides on ties
+      std::vector<std::pair<RefFirstIt, std::size_t>> references;
+      for (; rIt != rItEnd; ++rIt)
+        references.emplace_back(rIt, references.size());
+
+      const auto byMass = [](const auto &a, const auto &b) { return a.first->mass < b.first->mass; };
+      std::sort(references.begin(), references.end(), byMass);
+
+      std::vector<std::size_t> order(inputs.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(),
+                order.end(),
+                [&inputs](std::size_t a, std::size_t b) { return inputs[a]->mass < inputs[b]->mass; });
+
+      const auto noMatch = references.size();
+      std::vector<std::size_t> matches(inputs.size(), noMatch);
+      auto window = MakeReferenceWindow(references.cbegin(),
+                                        references.cend(),
+                                        tolerance,
+                                        [](const std::pair<RefFirstIt, std::size_t> &r) { return r.first->mass; });
+      for (auto i : order)
       {
-        if (*it >= lower)
+        const auto candidates = window(inputs[i]->mass);
+        double diff = std::numeric_limits<double>::max();
+        for (auto r = candidates.first; r != candidates.second; ++r)
         {
-          start = it;
-          break;
+          const double d = std::abs(inputs[i]->intensity - r->first->intensity);
+          if (d < diff || (d == diff && matches[i] != noMatch && r->second < references[matches[i]].second))
+          {
+            matches[i] = std::distance(references.cbegin(), r);
+            diff = d;
+          }
         }
       }
-      for (auto it = mzs.cbegin(); it < mzs.cend(); ++it)
+
+      for (std::size_t i = 0; i < inputs.size(); ++i)
       {
-        if (*it > upper)
+        if (matches[i] != noMatch)
         {
-          end = it;
-          break;
+          (*oIt) = {*inputs[i], *references[matches[i]].first};
+          ++oIt;
         }
       }
+    }
 
-      // auto start = std::upper_bound(std::begin(mzs), std::end(mzs), lower) - 1;
-      // auto end = std::upper_bound(std::begin(mzs), std::end(mzs), upper) - 1;
-      return {std::distance(std::begin(mzs), start), std::distance(start, end)};
+    /**
+     * @brief Row of the match table of MatchPeaks: peak number peak of spectrum (row) spectrum matches the
+     * reference at position reference.
+     */
+    struct PeakMatch
+    {
+      std::uint32_t spectrum;
+      std::uint32_t peak;
+      std::uint32_t reference;
+    };
+
+    /**
+     * @brief Annotates the peaks of all spectra of a peak matrix with reference masses (e.g. a metabolite or lipid
+     * list), in parallel over the spectra.
+     *
+     * A peak matches the references r with |mz - r| <= r * tolerance; of those, the one with the closest mass is
+     * reported (the first one on ties). The references have to be sorted in ascending order. The peaks of a
+     * spectrum are matched by a ReferenceWindow and should be sorted by m/z as well (as returned by PickPeaks).
+     * The returned table is ordered by spectrum and peak.
+     */
+    template <class MzType, class ReferenceContainer>
+    inline std::vector<PeakMatch> MatchPeaks(const BasicPeakMatrix<MzType> &peaks,
+                                             const ReferenceContainer &references,
+                                             double tolerance,
+                                             unsigned int T = 1)
+    {
+      const auto first = std::cbegin(references);
+      const auto last = std::cend(references);
+      const std::size_t numberOfRows = peaks.GetNumberOfRows();
+      const unsigned int grainSize = std::max<std::size_t>(1, numberOfRows / (16 * std::max(1u, T)));
+
+      // the matches of each chunk of rows, concatenated in order of the chunks
+      std::vector<std::vector<PeakMatch>> chunks((numberOfRows + grainSize - 1) / grainSize);
+      m2::Process::ParallelFor(
+        numberOfRows,
+        T,
+        [&](unsigned int, unsigned int a, unsigned int b)
+        {
+          auto &chunk = chunks[a / grainSize];
+          auto window = MakeReferenceWindow(first, last, tolerance, [](const auto &r) { return double(r); });
+          for (auto spectrum = a; spectrum < b; ++spectrum)
+          {
+            const auto mzs = peaks[spectrum].mzs;
+            for (std::uint32_t peak = 0; peak < mzs.size(); ++peak)
+            {
+              const double mz = mzs[peak];
+              const auto candidates = window(mz);
+              if (candidates.first == candidates.second)
+                continue;
+              const auto nearest = std::min_element(candidates.first,
+                                                    candidates.second,
+                                                    [mz](const auto &r0, const auto &r1)
+                                                    { return std::abs(mz - double(r0)) < std::abs(mz - double(r1)); });
+              chunk.push_back({spectrum, peak, static_cast<std::uint32_t>(std::distance(first, nearest))});
+            }
+          }
+        },
+        grainSize);
+
+      std::vector<PeakMatch> table;
+      for (auto &chunk : chunks)
+      {
+        table.insert(table.end(), chunk.begin(), chunk.end());
+        chunk = std::vector<PeakMatch>();
+      }
+      return table;
     }
 
   }; // namespace Signal
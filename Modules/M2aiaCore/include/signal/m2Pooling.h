@@ -15,8 +15,13 @@ See LICENSE.txt for details.
 ===================================================================*/
 #pragma once
 #include <M2aiaCoreExports.h>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
 #include <signal/m2Normalization.h>
 #include <signal/m2SignalCommon.h>
+#include <type_traits>
+#include <vector>
 
 namespace m2
 {
@@ -24,29 +29,121 @@ namespace m2
 
   namespace Signal
   {
+    /**
+     * @brief Pooling of a range of values with the strategy given at compile time. Only the selected strategy is
+     * instantiated for an iterator type.
+     */
+    template <RangePoolingStrategyType Strategy>
+    struct RangePooler
+    {
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Apply(ItFirst, ItLast)
+      {
+        return 0;
+      }
+    };
+
+    template <>
+    struct RangePooler<RangePoolingStrategyType::Sum>
+    {
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Apply(ItFirst first, ItLast last)
+      {
+        return std::accumulate(first, last, PoolingValue(0));
+      }
+    };
+
+    template <>
+    struct RangePooler<RangePoolingStrategyType::Mean>
+    {
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Apply(ItFirst first, ItLast last)
+      {
+        return std::accumulate(first, last, PoolingValue(0)) / PoolingValue(std::distance(first, last));
+      }
+    };
+
+    template <>
+    struct RangePooler<RangePoolingStrategyType::Maximum>
+    {
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Apply(ItFirst first, ItLast last)
+      {
+        return *std::max_element(first, last);
+      }
+    };
+
+    /**
+     * @brief The median reorders mutable ranges; read-only ranges are copied first.
+     */
+    template <>
+    struct RangePooler<RangePoolingStrategyType::Median>
+    {
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Apply(ItFirst first, ItLast last)
+      {
+        using ReferenceType = typename std::iterator_traits<ItFirst>::reference;
+        return Median<PoolingValue>(first, last, std::is_const<std::remove_reference_t<ReferenceType>>());
+      }
+
+    private:
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Median(ItFirst first, ItLast last, std::false_type /*isConst*/)
+      {
+        return m2::Signal::Median(first, last);
+      }
+
+      template <typename PoolingValue, class ItFirst, class ItLast>
+      static PoolingValue Median(ItFirst first, ItLast last, std::true_type /*isConst*/)
+      {
+        std::vector<typename std::iterator_traits<ItFirst>::value_type> values(first, last);
+        return m2::Signal::Median(values.begin(), values.end());
+      }
+    };
+
     template <typename PoolingValue, class ItFirst, class ItLast>
     PoolingValue RangePooling(ItFirst first, ItLast last, RangePoolingStrategyType strategy)
     {
-      PoolingValue val = 0;
       switch (strategy)
       {
-        case RangePoolingStrategyType::None:
-          break;
         case RangePoolingStrategyType::Sum:
-          val = std::accumulate(first, last, PoolingValue(0));
-          break;
+          return RangePooler<RangePoolingStrategyType::Sum>::Apply<PoolingValue>(first, last);
         case RangePoolingStrategyType::Mean:
-          val = std::accumulate(first, last, PoolingValue(0)) / PoolingValue(std::distance(first, last));
-          break;
+          return RangePooler<RangePoolingStrategyType::Mean>::Apply<PoolingValue>(first, last);
         case RangePoolingStrategyType::Maximum:
-          val = *std::max_element(first, last);
-          break;
+          return RangePooler<RangePoolingStrategyType::Maximum>::Apply<PoolingValue>(first, last);
         case RangePoolingStrategyType::Median:
-          val = m2::Signal::Median(first, last);
-          break;
+          return RangePooler<RangePoolingStrategyType::Median>::Apply<PoolingValue>(first, last);
+        case RangePoolingStrategyType::None:
+        default:
+          return 0;
       }
+    }
+
+    template <typename PoolingValue, class It>
+    using RangePoolingFunction = PoolingValue (*)(It, It);
 
-      return val;
+    /**
+     * @brief Returns the pooling of the strategy specialized for the iterator type, to be selected once per ion
+     * image instead of dispatching the strategy for every pixel.
+     */
+    template <typename PoolingValue, class It>
+    RangePoolingFunction<PoolingValue, It> GetRangePoolingFunction(RangePoolingStrategyType strategy)
+    {
+      switch (strategy)
+      {
+        case RangePoolingStrategyType::Sum:
+          return &RangePooler<RangePoolingStrategyType::Sum>::Apply<PoolingValue, It, It>;
+        case RangePoolingStrategyType::Mean:
+          return &RangePooler<RangePoolingStrategyType::Mean>::Apply<PoolingValue, It, It>;
+        case RangePoolingStrategyType::Maximum:
+          return &RangePooler<RangePoolingStrategyType::Maximum>::Apply<PoolingValue, It, It>;
+        case RangePoolingStrategyType::Median:
+          return &RangePooler<RangePoolingStrategyType::Median>::Apply<PoolingValue, It, It>;
+        case RangePoolingStrategyType::None:
+        default:
+          return &RangePooler<RangePoolingStrategyType::None>::Apply<PoolingValue, It, It>;
+      }
     }
   }
 } // namespace m2
@@ -24,118 +24,209 @@ SOFTWARE.
 #pragma once
 
 #include <M2aiaCoreExports.h>
-#include <algorithm>
-#include <cstring>
-#include <stdlib.h>
+#include <cstddef>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 namespace m2
 {
+  /**
+   * @brief Running median of a signal, e.g. as its baseline.
+   *
+   * The value at position i is the median of the window of the 2s+1 samples up to and including i; samples before
+   * the signal repeat its first value. Where the median is negative, the maximum of the window is used instead.
+   *
+   * The lower half of the window is kept in a max-heap and the upper half in a min-heap, both rooted at the median.
+   * A new sample replaces the oldest one in its heap position and is sifted to its place, which costs O(log s)
+   * comparisons. The window maximum is tracked in a monotonic queue.
+   */
   class M2AIACORE_EXPORT RunMedian
   {
   public:
-    template <class IteratorType>
-    static void apply(IteratorType start, IteratorType end, unsigned int s, IteratorType baseline_start) noexcept
+    /**
+     * @brief Filter memory of RunMedian::apply; it grows to the largest window and can be reused for many signals.
+     */
+    template <class T>
+    class Workspace
     {
-      MedfiltData data;
-      s = s * 2 + 1;
-      MedfiltNode *nodes = new MedfiltNode[s];
-
-      medfilt_init(&data, nodes, s, *start);
-
-      auto oit = baseline_start;
-      
-      for (auto it = start; it != end; ++it)
-      {
-        double min, mid, max;
-        medfilt(&data, *it, &mid, &min, &max);
-        if (mid < 0)
-          *oit = max;
-        else
-          *oit = mid;
-        ++oit;
-      }
+      friend class RunMedian;
+      std::vector<T> m_Values;                // the window as ring buffer
+      std::vector<int> m_Positions;           // heap node of each value of the window
+      std::vector<int> m_Nodes;               // window index of each heap node; node 0 is the median
+      std::vector<T> m_MaxValues;             // decreasing candidates for the maximum of the window ...
+      std::vector<std::ptrdiff_t> m_MaxTimes; // ... and their sample positions, as ring buffers
+    };
 
-      delete nodes;
-    }
-  protected:
-    typedef struct MedfiltNode
+    template <class IteratorType>
+    static void apply(IteratorType start, IteratorType end, unsigned int s, IteratorType baseline_start)
     {
-      double value;
-      size_t index; // Node index in the sorted table
-      struct MedfiltNode *parent;
-      struct MedfiltNode *sorted;
-    } MedfiltNode;
+      Workspace<typename std::iterator_traits<IteratorType>::value_type> workspace;
+      apply(start, end, s, baseline_start, workspace);
+    }
 
-    typedef struct MedfiltData
+    template <class IteratorType>
+    static void apply(IteratorType start,
+                      IteratorType end,
+                      unsigned int s,
+                      IteratorType baseline_start,
+                      Workspace<typename std::iterator_traits<IteratorType>::value_type> &workspace);
+
+  private:
+    /**
+     * @brief Heap nodes are numbered -s..s: the median is node 0, the max-heap holds the nodes -1..-s (children of
+     * node i are 2i and 2i-1) and the min-heap the nodes 1..s (children 2i and 2i+1).
+     */
+    template <class T>
+    struct Heaps
     {
-      MedfiltNode *kernel; // Working filter memory
-      MedfiltNode *oldest; // Reference to the oldest value in the kernel
-      size_t length;       // Number of nodes
-    } MedfiltData;
+      const T *values;
+      int *positions;
+      int *nodes; // points to node 0
+      int size;   // of each heap
 
+      bool Less(int i, int j) const noexcept { return values[nodes[i]] < values[nodes[j]]; }
 
-    static void swap(MedfiltNode **a, MedfiltNode **b) noexcept
-    {
-      // Swap two node references in the sorted table.
-      MedfiltNode *temp = *a;
-      *a = *b;
-      *b = temp;
-
-      // Preserve index. Used to retrive the node position in the sorted table.
-      size_t index = (*a)->index;
-      (*a)->index = (*b)->index;
-      (*b)->index = index;
-    }
-
-    static void medfilt(MedfiltData *data, double input, double *median, double *min, double *max) noexcept
-    {
-      // New value replaces the oldest
-      MedfiltNode *n = data->kernel;
-      MedfiltNode *node = data->oldest;
-      node->value = input;
-      data->oldest = node->parent;
+      bool ExchangeIfLess(int i, int j) noexcept
+      {
+        if (!Less(i, j))
+          return false;
+        std::swap(nodes[i], nodes[j]);
+        positions[nodes[i]] = i;
+        positions[nodes[j]] = j;
+        return true;
+      }
 
-#define VAL(x) (n[x].sorted->value)
+      // i is a child of the node to sift down
+      void MinSiftDown(int i) noexcept
+      {
+        for (; i <= size; i *= 2)
+        {
+          if (i > 1 && i < size && Less(i + 1, i))
+            ++i;
+          if (!ExchangeIfLess(i, i / 2))
+            break;
+        }
+      }
 
-      // Sort the kernel
+      void MaxSiftDown(int i) noexcept
+      {
+        for (; i >= -size; i *= 2)
+        {
+          if (i < -1 && i > -size && Less(i, i - 1))
+            --i;
+          if (!ExchangeIfLess(i / 2, i))
+            break;
+        }
+      }
 
-      // Check neigbhour to the right
-      for (size_t i = node->index; i < data->length - 1 && VAL(i) > VAL(i + 1); i++)
+      // returns true if node i reached the median
+      bool MinSiftUp(int i) noexcept
       {
-        swap(&n[i].sorted, &n[i + 1].sorted);
+        while (i > 0 && ExchangeIfLess(i, i / 2))
+          i /= 2;
+        return i == 0;
       }
 
-      // Check neigbhour to the left
-      for (size_t i = node->index; i > 0 && VAL(i) < VAL(i - 1); i--)
+      bool MaxSiftUp(int i) noexcept
       {
-        swap(&n[i].sorted, &n[i - 1].sorted);
+        while (i < 0 && ExchangeIfLess(i / 2, i))
+          i /= 2;
+        return i == 0;
       }
 
-      // Get kernel information from sorted entries
-      *min = VAL(0);
-      *max = VAL(data->length - 1);
-      *median = VAL(data->length / 2);
+      /**
+       * @brief Restores the heaps after the value of window index k changed from old.
+       */
+      void Update(int k, T old) noexcept
+      {
+        const int p = positions[k];
+        const T value = values[k];
+        if (p > 0)
+        {
+          if (old < value)
+            MinSiftDown(2 * p);
+          else if (MinSiftUp(p))
+            MaxSiftDown(-1);
+        }
+        else if (p < 0)
+        {
+          if (value < old)
+            MaxSiftDown(2 * p);
+          else if (MaxSiftUp(p))
+            MinSiftDown(1);
+        }
+        else
+        {
+          MaxSiftDown(-1);
+          MinSiftDown(1);
+        }
+      }
+    };
+  };
 
-#undef VAL
+  template <class IteratorType>
+  void RunMedian::apply(IteratorType start,
+                        IteratorType end,
+                        unsigned int s,
+                        IteratorType baseline_start,
+                        Workspace<typename std::iterator_traits<IteratorType>::value_type> &workspace)
+  {
+    using T = typename std::iterator_traits<IteratorType>::value_type;
+    if (start == end)
+      return;
+
+    const int n = 2 * s + 1;
+    auto &values = workspace.m_Values;
+    auto &maxValues = workspace.m_MaxValues;
+    auto &maxTimes = workspace.m_MaxTimes;
+    values.assign(n, *start);
+    workspace.m_Positions.resize(n);
+    workspace.m_Nodes.resize(n);
+    maxValues.resize(n + 1);
+    maxTimes.resize(n + 1);
+
+    Heaps<T> heaps{values.data(), workspace.m_Positions.data(), workspace.m_Nodes.data() + s, int(s)};
+    // all values are equal: any assignment of window indices to nodes is a valid heap
+    for (int k = 0; k < n; ++k)
+    {
+      heaps.positions[k] = (k + 1) / 2 * (k % 2 ? -1 : 1);
+      heaps.nodes[heaps.positions[k]] = k;
     }
 
-    static void medfilt_init(MedfiltData *data, MedfiltNode *nodes, size_t length, double init) noexcept
-    {
-      data->kernel = nodes;
-      data->length = length;
+    // the leading copies of the first value are represented by the one at position -1
+    std::size_t maxFront = 0, maxCount = 1;
+    maxValues[0] = *start;
+    maxTimes[0] = -1;
 
-      // Linked list initialization
-      data->oldest = &data->kernel[length - 1];
-      for (size_t i = 0; i < length; i++)
+    int oldest = 0;
+    std::ptrdiff_t t = 0;
+    auto oit = baseline_start;
+    for (auto it = start; it != end; ++it, ++oit, ++t)
+    {
+      const T value = *it;
+      const T old = values[oldest];
+      values[oldest] = value;
+      heaps.Update(oldest, old);
+      if (++oldest == n)
+        oldest = 0;
+
+      while (maxCount && !(value < maxValues[(maxFront + maxCount - 1) % (n + 1)]))
+        --maxCount;
+      maxValues[(maxFront + maxCount) % (n + 1)] = value;
+      maxTimes[(maxFront + maxCount) % (n + 1)] = t;
+      ++maxCount;
+      while (maxTimes[maxFront] <= t - n)
       {
-        data->kernel[i].value = init;
-        data->kernel[i].parent = data->oldest;
-        data->kernel[i].index = i;
-        data->kernel[i].sorted = &data->kernel[i];
-
-        data->oldest = &data->kernel[i];
+        maxFront = (maxFront + 1) % (n + 1);
+        --maxCount;
       }
+
+      const T median = values[heaps.nodes[0]];
+      if (median < 0)
+        *oit = maxValues[maxFront];
+      else
+        *oit = median;
     }
-  };
-} // namespace m2
\ No newline at end of file
+  }
+} // namespace m2
@@ -16,10 +16,10 @@ See LICENSE.txt for details.
 #pragma once
 #include <M2aiaCoreExports.h>
 #include <algorithm>
-#include <deque>
 #include <functional>
 #include <mitkExceptionMacro.h>
 #include <numeric>
+#include <signal/m2Convolution.h>
 #include <signal/m2SignalCommon.h>
 #include <vector>
 #include <vnl/algo/vnl_matrix_inverse.h>
@@ -104,27 +104,9 @@ namespace m2
 
       if (extend)
       {
-        std::deque<T> yy(start, end);
-        // extend border conditions
-        for (int i = 0;;)
-        {
-          yy.push_front(*start);
-          yy.push_back(*(end - 1));
-          ++i;
-          if (i == hws)
-            break;
-        }
-
-        size_t j = 0;
-        auto it = yy.begin();
-        for (;;)
-        {
-          *(start + j) = std::inner_product(kernel_start, kernel_end, it, T(0));
-          ++j;
-          if (j == dataSize)
-            break;
-          ++it;
-        }
+        const std::vector<T> yy(start, end);
+        const Convolution<T> convolution(std::vector<T>(kernel_start, kernel_end));
+        convolution(yy.data(), &*start, dataSize);
       }
       else
       {
@@ -168,10 +150,14 @@ namespace m2
       int m_hws;
       std::vector<double> m_kernel;
       bool m_isKernelInitialized = false;
+      Convolution<ItValueType> m_convolution;
 
     public:
       void InitializeKernel()
       {
+        m_kernel.clear();
+        m_isKernelInitialized = false;
+        m_convolution = Convolution<ItValueType>();
         switch (m_strategy)
         {
           case m2::SmoothingType::SavitzkyGolay:
@@ -189,6 +175,7 @@ namespace m2
             std::transform(
               std::begin(m_kernel), std::end(m_kernel), std::begin(m_kernel), [sum](const auto &v) { return v / sum; });
             m_isKernelInitialized = true;
+            break;
           }
           case m2::SmoothingType::None:
             break;
@@ -200,13 +187,28 @@ namespace m2
         m_strategy = strategy;
         m_hws = hws;
         InitializeKernel();
+        if (m_isKernelInitialized)
+          m_convolution = Convolution<ItValueType>(m_kernel);
       }
 
-      
-      void operator()(typename std::vector<ItValueType>::iterator start, typename std::vector<ItValueType>::iterator end)
+      /**
+       * @brief The convolution kernel; empty if no smoothing is applied.
+       */
+      const std::vector<double> &GetKernel() const { return m_kernel; }
+
+      /**
+       * @brief Smooths [start, end) in place. The input is copied to a scratch buffer of the calling thread, which
+       * keeps its capacity across calls, so that concurrent calls of a shared functor do not allocate per spectrum.
+       */
+      void operator()(typename std::vector<ItValueType>::iterator start,
+                      typename std::vector<ItValueType>::iterator end) const
       {
-        if (m_isKernelInitialized)
-          m2::Signal::filter(start, end, std::begin(m_kernel), std::end(m_kernel), true);
+        if (m_isKernelInitialized && start != end)
+        {
+          thread_local std::vector<ItValueType> input;
+          input.assign(start, end);
+          m_convolution(input.data(), &*start, input.size());
+        }
       }
     };
 
@@ -0,0 +1,192 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <signal/m2Convolution.h>
+#include <signal/m2Morphology.h>
+#include <signal/m2RunningMedian.h>
+#include <signal/m2SignalCommon.h>
+#include <signal/m2Smoothing.h>
+#include <vector>
+
+namespace m2
+{
+  namespace Signal
+  {
+    /**
+     * @brief Normalization, smoothing, baseline correction and intensity transformation of a spectrum in one call.
+     *
+     * The result equals the sequence of SmoothingFunctor, BaselineFunctor and IntensityTransformationFunctor
+     * applied to the normalized intensities, but the steps share their passes over the data where possible and all
+     * scratch memory is taken from a Workspace. A workspace grows to the longest spectrum processed with it, so a
+     * thread that reuses its workspace does not allocate memory per spectrum.
+     *
+     * Initialize selects an instance of Process that is specialized for the combination of strategies, so no
+     * strategy is dispatched per spectrum or per value; the value type is specialized by T, like the Processor of
+     * ImzMLSpectrumImage.
+     *
+     * The pipeline is not modified by processing; one pipeline can be used by many threads, each with its own
+     * workspace.
+     */
+    template <class T>
+    class SpectrumProcessingPipeline
+    {
+    public:
+      struct Workspace
+      {
+        std::vector<T> smoothingInput; // normalized intensities
+        std::vector<T> baseline;       // estimated baseline
+        MorphologyWorkspace<T> morphology;
+        RunMedian::Workspace<T> median;
+      };
+
+      void Initialize(SmoothingType smoothingStrategy,
+                      unsigned int smoothingHalfWindowSize,
+                      BaselineCorrectionType baselineCorrectionStrategy,
+                      unsigned int baselineCorrectionHalfWindowSize,
+                      IntensityTransformationType intensityTransformationStrategy)
+      {
+        SmoothingFunctor<T> smoother;
+        smoother.Initialize(smoothingStrategy, smoothingHalfWindowSize);
+        // a kernel of size one is the identity
+        m_Smoothing = smoother.GetKernel().size() < 3 ? Convolution<T>() : Convolution<T>(smoother.GetKernel());
+        m_BaselineHalfWindowSize = baselineCorrectionHalfWindowSize;
+        m_Process = SelectProcess(!m_Smoothing.IsEmpty(), baselineCorrectionStrategy, intensityTransformationStrategy);
+      }
+
+      /**
+       * @brief Processes the intensities [first, last) in place. They are divided by norm first; norm is converted
+       * to T and the division is carried out in T.
+       */
+      void operator()(T *first, T *last, double norm, Workspace &workspace) const
+      {
+        if (first != last)
+          m_Process(*this, first, std::size_t(last - first), static_cast<T>(norm), workspace);
+      }
+
+      void operator()(T *first, T *last, Workspace &workspace) const { (*this)(first, last, 1.0, workspace); }
+
+    private:
+      using ProcessFunction = void (*)(const SpectrumProcessingPipeline &, T *, std::size_t, T, Workspace &);
+
+      template <IntensityTransformationType Transformation>
+      static T Transform(T v) noexcept
+      {
+        // the strategy is a constant; all but one case are discarded at compile time
+        switch (Transformation)
+        {
+          case m2::IntensityTransformationType::Log10:
+            return std::log10(v + 1);
+          case m2::IntensityTransformationType::Log2:
+            return std::log2(v + 1);
+          case m2::IntensityTransformationType::SquareRoot:
+            return std::sqrt(v);
+          case m2::IntensityTransformationType::None:
+          default:
+            return v;
+        }
+      }
+
+      template <bool Smoothing, BaselineCorrectionType Baseline, IntensityTransformationType Transformation>
+      static void Process(const SpectrumProcessingPipeline &self, T *y, std::size_t n, T norm, Workspace &workspace)
+      {
+        if (Smoothing)
+          self.NormalizeAndSmooth(y, n, norm, workspace);
+        else if (norm != 1)
+          std::transform(y, y + n, y, [norm](const T &v) { return v / norm; });
+
+        if (Baseline != m2::BaselineCorrectionType::None)
+        {
+          workspace.baseline.resize(n);
+          T *baseline = workspace.baseline.data();
+          if (Baseline == m2::BaselineCorrectionType::TopHat)
+            m2::Signal::Opening(y, y + n, self.m_BaselineHalfWindowSize, baseline, workspace.morphology);
+          else
+            m2::RunMedian::apply(y, y + n, self.m_BaselineHalfWindowSize, baseline, workspace.median);
+          for (std::size_t i = 0; i < n; ++i)
+            y[i] = Transform<Transformation>(std::max(T(0), y[i] - baseline[i]));
+        }
+        else if (Transformation != m2::IntensityTransformationType::None)
+        {
+          for (std::size_t i = 0; i < n; ++i)
+            y[i] = Transform<Transformation>(y[i]);
+        }
+      }
+
+      template <bool Smoothing, BaselineCorrectionType Baseline>
+      static ProcessFunction SelectProcess(IntensityTransformationType transformation)
+      {
+        switch (transformation)
+        {
+          case m2::IntensityTransformationType::Log10:
+            return &Process<Smoothing, Baseline, m2::IntensityTransformationType::Log10>;
+          case m2::IntensityTransformationType::Log2:
+            return &Process<Smoothing, Baseline, m2::IntensityTransformationType::Log2>;
+          case m2::IntensityTransformationType::SquareRoot:
+            return &Process<Smoothing, Baseline, m2::IntensityTransformationType::SquareRoot>;
+          case m2::IntensityTransformationType::None:
+          default:
+            return &Process<Smoothing, Baseline, m2::IntensityTransformationType::None>;
+        }
+      }
+
+      template <bool Smoothing>
+      static ProcessFunction SelectProcess(BaselineCorrectionType baseline, IntensityTransformationType transformation)
+      {
+        switch (baseline)
+        {
+          case m2::BaselineCorrectionType::TopHat:
+            return SelectProcess<Smoothing, m2::BaselineCorrectionType::TopHat>(transformation);
+          case m2::BaselineCorrectionType::Median:
+            return SelectProcess<Smoothing, m2::BaselineCorrectionType::Median>(transformation);
+          case m2::BaselineCorrectionType::None:
+          default:
+            return SelectProcess<Smoothing, m2::BaselineCorrectionType::None>(transformation);
+        }
+      }
+
+      static ProcessFunction SelectProcess(bool smoothing,
+                                           BaselineCorrectionType baseline,
+                                           IntensityTransformationType transformation)
+      {
+        return smoothing ? SelectProcess<true>(baseline, transformation)
+                         : SelectProcess<false>(baseline, transformation);
+      }
+
+      /**
+       * @brief The normalization is applied while the intensities are copied into the input buffer of the
+       * convolution, which writes back to y.
+       */
+      void NormalizeAndSmooth(T *y, std::size_t n, T norm, Workspace &workspace) const
+      {
+        auto &input = workspace.smoothingInput;
+        input.resize(n);
+        if (norm != 1)
+          std::transform(y, y + n, input.data(), [norm](const T &v) { return v / norm; });
+        else
+          std::copy(y, y + n, input.data());
+        m_Smoothing(input.data(), y, n);
+      }
+
+      Convolution<T> m_Smoothing;
+      unsigned int m_BaselineHalfWindowSize = 0;
+      ProcessFunction m_Process =
+        &Process<false, m2::BaselineCorrectionType::None, m2::IntensityTransformationType::None>;
+    };
+
+  } // namespace Signal
+} // namespace m2
@@ -37,7 +37,7 @@ namespace m2
       }
 
       void operator()(typename std::vector<ItValueType>::iterator start,
-                      typename std::vector<ItValueType>::iterator end)
+                      typename std::vector<ItValueType>::iterator end) const
       {
         switch (m_strategy)
         {
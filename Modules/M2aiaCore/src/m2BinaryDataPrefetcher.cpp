@@ -0,0 +1,185 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <m2BinaryDataPrefetcher.h>
+#include <mitkExceptionMacro.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifndef _WIN32
+  void AdviseWillNeed(int fd, const m2::SpectrumReadPlan::Block &block) noexcept
+  {
+#ifdef POSIX_FADV_WILLNEED
+    ::posix_fadvise(fd, static_cast<off_t>(block.offset), static_cast<off_t>(block.numberOfBytes), POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)block;
+#endif
+  }
+#endif
+} // namespace
+
+m2::BinaryDataPrefetcher::BinaryDataPrefetcher(const std::string &path,
+                                               const SpectrumReadPlan &plan,
+                                               std::uint64_t memoryLimit)
+  : m_Plan(plan), m_Path(path)
+{
+#ifdef _WIN32
+  m_Stream.open(path, std::ios::binary);
+  if (!m_Stream)
+    mitkThrow() << "Can not open file for reading: " << path;
+#else
+  m_FileDescriptor = ::open(path.c_str(), O_RDONLY);
+  if (m_FileDescriptor < 0)
+    mitkThrow() << "Can not open file for reading: " << path;
+#ifdef POSIX_FADV_SEQUENTIAL
+  ::posix_fadvise(m_FileDescriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+
+  const auto &blocks = plan.GetBlocks();
+  std::uint64_t largestBlock = 1;
+  for (const auto &block : blocks)
+    largestBlock = std::max(largestBlock, block.numberOfBytes);
+  const auto numberOfBuffers = std::min<std::uint64_t>(std::max<std::uint64_t>(2, memoryLimit / largestBlock),
+                                                       std::max<std::uint64_t>(1, blocks.size()));
+
+  m_Buffers.resize(numberOfBuffers);
+  for (std::size_t i = 0; i < m_Buffers.size(); ++i)
+    m_FreeBuffers.push_back(i);
+
+  m_Thread = std::thread(&BinaryDataPrefetcher::Run, this);
+}
+
+m2::BinaryDataPrefetcher::~BinaryDataPrefetcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Condition.notify_all();
+  m_Thread.join();
+#ifndef _WIN32
+  ::close(m_FileDescriptor);
+#endif
+}
+
+const char *m2::BinaryDataPrefetcher::Next()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  if (m_CurrentBuffer != NoBuffer)
+  {
+    m_FreeBuffers.push_back(m_CurrentBuffer);
+    m_CurrentBuffer = NoBuffer;
+    m_Condition.notify_all();
+  }
+
+  if (m_NumberOfConsumedBlocks == m_Plan.GetBlocks().size())
+    mitkThrow() << "All blocks of the read plan were consumed.";
+
+  m_Condition.wait(lock, [this] { return !m_ReadyBuffers.empty() || m_Failed; });
+  if (m_ReadyBuffers.empty())
+  {
+    const auto &block = m_Plan.GetBlocks()[m_NumberOfConsumedBlocks];
+    mitkThrow() << "Read of " << block.numberOfBytes << " bytes at offset " << block.offset << " failed: " << m_Path;
+  }
+
+  m_CurrentBuffer = m_ReadyBuffers.front();
+  m_ReadyBuffers.pop_front();
+  ++m_NumberOfConsumedBlocks;
+  return m_Buffers[m_CurrentBuffer].data();
+}
+
+void m2::BinaryDataPrefetcher::Run()
+{
+  const auto &blocks = m_Plan.GetBlocks();
+  for (std::size_t k = 0; k < blocks.size(); ++k)
+  {
+    std::size_t buffer;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Condition.wait(lock, [this] { return m_Stop || !m_FreeBuffers.empty(); });
+      if (m_Stop)
+        return;
+      buffer = m_FreeBuffers.front();
+      m_FreeBuffers.pop_front();
+    }
+
+#ifndef _WIN32
+    if (k + 1 < blocks.size())
+      AdviseWillNeed(m_FileDescriptor, blocks[k + 1]);
+#endif
+
+    // buffers are only resized by this thread; their capacity is kept for the following blocks
+    auto &data = m_Buffers[buffer];
+    data.resize(blocks[k].numberOfBytes);
+    const bool success = ReadBlock(blocks[k], data.data());
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (success)
+        m_ReadyBuffers.push_back(buffer);
+      else
+        m_Failed = true;
+    }
+    m_Condition.notify_all();
+    if (!success)
+      return;
+  }
+}
+
+bool m2::BinaryDataPrefetcher::ReadBlock(const SpectrumReadPlan::Block &block, char *dst)
+{
+#ifdef _WIN32
+  m_Stream.seekg(block.offset);
+  m_Stream.read(dst, block.numberOfBytes);
+  return static_cast<std::uint64_t>(m_Stream.gcount()) == block.numberOfBytes;
+#else
+  std::uint64_t n = 0;
+  while (n < block.numberOfBytes)
+  {
+    const auto r = ::pread(m_FileDescriptor, dst + n, block.numberOfBytes - n, static_cast<off_t>(block.offset + n));
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    n += static_cast<std::uint64_t>(r);
+  }
+  return true;
+#endif
+}
+
+void m2::BinaryDataPrefetcher::WillNeed(const std::string &path, const SpectrumReadPlan &plan) noexcept
+{
+#ifdef _WIN32
+  (void)path;
+  (void)plan;
+#else
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  for (const auto &block : plan.GetBlocks())
+    AdviseWillNeed(fd, block);
+  ::close(fd);
+#endif
+}
@@ -0,0 +1,52 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2FileStreamPool.h>
+#include <mitkExceptionMacro.h>
+
+m2::FileStreamPool::StreamPointer m2::FileStreamPool::Acquire()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!m_Streams.empty())
+    {
+      auto stream = std::move(m_Streams.back());
+      m_Streams.pop_back();
+      stream->clear(); // a failed read of a previous reader must not affect this one
+      return stream;
+    }
+  }
+
+  StreamPointer stream(new std::ifstream(m_Path, std::ios::binary));
+  if (!stream->is_open())
+    mitkThrow() << "Can not open " << m_Path;
+  return stream;
+}
+
+void m2::FileStreamPool::Release(StreamPointer stream) noexcept
+{
+  if (!stream)
+    return;
+  try
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Streams.push_back(std::move(stream));
+  }
+  catch (...)
+  {
+    // the stream is closed instead of being reused
+  }
+}
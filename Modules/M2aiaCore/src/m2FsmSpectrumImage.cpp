@@ -71,28 +71,28 @@ void m2::FsmSpectrumImage::FsmProcessor::GetImagePrivate(double cmInv,
   // map all spectra to several threads for processing
   const unsigned t = p->GetNumberOfThreads();
 
-  m2::Process::Map(n,
-                   t,
-                   [&](auto /*id*/, auto a, auto b)
-                   {
-                     auto &spectra = p->GetSpectra();
-                     for (unsigned int i = a; i < b; ++i)
-                     {
-                       auto &spectrum = spectra[i];
-                       auto &ys = spectrum.data;
-                       auto s = std::next(std::begin(ys), subRes.first);
-                       auto e = std::next(std::begin(ys), subRes.first + subRes.second);
-
-                       if (maskAccess && maskAccess->GetPixelByIndex(spectrum.index) == 0)
-                       {
-                         imageAccess.SetPixelByIndex(spectrum.index, 0);
-                         continue;
-                       }
-
-                       const auto val = Signal::RangePooling<float>(s, e, p->GetRangePoolingStrategy());
-                       imageAccess.SetPixelByIndex(spectrum.index, val);
-                     }
-                   });
+  m2::Process::ParallelFor(n,
+                           t,
+                           [&](auto /*id*/, auto a, auto b)
+                           {
+                             auto &spectra = p->GetSpectra();
+                             for (unsigned int i = a; i < b; ++i)
+                             {
+                               auto &spectrum = spectra[i];
+                               auto &ys = spectrum.data;
+                               auto s = std::next(std::begin(ys), subRes.first);
+                               auto e = std::next(std::begin(ys), subRes.first + subRes.second);
+
+                               if (subRes.second == 0 || (maskAccess && maskAccess->GetPixelByIndex(spectrum.index) == 0))
+                               {
+                                 imageAccess.SetPixelByIndex(spectrum.index, 0);
+                                 continue;
+                               }
+
+                               const auto val = Signal::RangePooling<float>(s, e, p->GetRangePoolingStrategy());
+                               imageAccess.SetPixelByIndex(spectrum.index, val);
+                             }
+                           });
 }
 
 void m2::FsmSpectrumImage::InitializeProcessor()
@@ -248,7 +248,7 @@ void m2::FsmSpectrumImage::FsmProcessor::InitializeImageAccess()
 
   // m2::Timer t("Initialize image");
 
-  m2::Process::Map(
+  m2::Process::ParallelFor(
     p->GetSpectra().size(),
     p->GetNumberOfThreads(),
     [&](unsigned int t, unsigned int a, unsigned int b)
@@ -303,19 +303,19 @@ void m2::FsmSpectrumImage::FsmProcessor::InitializeImageAccess()
     });
 
   const auto &spectra = p->GetSpectra();
-  m2::Process::Map(spectra.size(),
-                   p->GetNumberOfThreads(),
-                   [&](unsigned int /*t*/, unsigned int a, unsigned int b)
-                   {
-                     for (unsigned int i = a; i < b; i++)
-                     {
-                       const auto &spectrum = spectra[i];
-
-                       accIndex->SetPixelByIndex(spectrum.index, i);
-                       if (!p->GetUseExternalMask())
-                         accMask->SetPixelByIndex(spectrum.index, 1);
-                     }
-                   });
+  m2::Process::ParallelFor(spectra.size(),
+                           p->GetNumberOfThreads(),
+                           [&](unsigned int /*t*/, unsigned int a, unsigned int b)
+                           {
+                             for (unsigned int i = a; i < b; i++)
+                             {
+                               const auto &spectrum = spectra[i];
+
+                               accIndex->SetPixelByIndex(spectrum.index, i);
+                               if (!p->GetUseExternalMask())
+                                 accMask->SetPixelByIndex(spectrum.index, 1);
+                             }
+                           });
 
   auto &skyline = p->SkylineSpectrum();
   skyline.resize(xs.size(), 0);
@@ -0,0 +1,222 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <Poco/Process.h>
+#include <Poco/SHA1Engine.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <itksys/SystemTools.hxx>
+#include <m2ImzMLMetaDataCache.h>
+#include <mitkExceptionMacro.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+  constexpr char Magic[8] = {'M', '2', 'A', 'I', 'A', 'M', 'D', '\0'};
+  constexpr std::uint32_t Version = 3;
+
+  struct FileHeader
+  {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sciLs3DTagUsed;
+    // optional columns of m2::SpectrumMetaDataStore are only allocated if present
+    std::uint32_t hasWorld;
+    std::uint32_t hasInFileNormalizationFactors;
+    std::uint64_t numberOfSpectra;
+    std::uint64_t sourceFileSize;
+    std::int64_t sourceModificationTime;
+    unsigned char sourceSHA1[24]; // 20 bytes used
+  };
+
+  struct SpectrumRecord
+  {
+    std::uint64_t mzOffset;
+    std::uint64_t intOffset;
+    std::uint64_t mzLength;
+    std::uint64_t intLength;
+    std::int64_t index[3];
+    double world[3];
+    double inFileNormalizationFactor;
+  };
+} // namespace
+
+m2::ImzMLMetaDataCache::SHA1Type m2::ImzMLMetaDataCache::ComputeSHA1(const char *data, std::uint64_t numberOfBytes)
+{
+  constexpr std::uint64_t blockSize = 64ull << 20;
+  Poco::SHA1Engine engine;
+  for (std::uint64_t offset = 0; offset < numberOfBytes; offset += blockSize)
+    engine.update(data + offset, static_cast<std::size_t>(std::min(blockSize, numberOfBytes - offset)));
+
+  const auto &digest = engine.digest();
+  SHA1Type sha1 = {};
+  std::copy_n(std::begin(digest), std::min(digest.size(), sha1.size()), std::begin(sha1));
+  return sha1;
+}
+
+m2::ImzMLMetaDataCache::Key m2::ImzMLMetaDataCache::MakeKey(const MemoryMappedFile &imzMLFile)
+{
+  Key key;
+  key.SourceFileSize = imzMLFile.GetSize();
+  key.SourceModificationTime = itksys::SystemTools::ModifiedTime(imzMLFile.GetPath());
+  key.SourceSHA1 = ComputeSHA1(imzMLFile.GetData(), imzMLFile.GetSize());
+  return key;
+}
+
+bool m2::ImzMLMetaDataCache::Read(const std::string &path,
+                                  const std::string &imzMLDataPath,
+                                  ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                                  bool &sciLs3DTagUsed)
+{
+  if (!itksys::SystemTools::FileExists(path, true))
+    return false;
+
+  std::ifstream f(path, std::ios_base::binary);
+  FileHeader header;
+  if (!f.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    return false;
+
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version)
+    return false;
+
+  if (itksys::SystemTools::FileLength(path) != sizeof(FileHeader) + header.numberOfSpectra * sizeof(SpectrumRecord))
+    return false;
+
+  if (header.sourceFileSize != itksys::SystemTools::FileLength(imzMLDataPath))
+    return false;
+
+  const std::int64_t modificationTime = itksys::SystemTools::ModifiedTime(imzMLDataPath);
+  const bool modificationTimeChanged = header.sourceModificationTime != modificationTime;
+  if (modificationTimeChanged)
+  {
+    try
+    {
+      MemoryMappedFile imzMLFile(imzMLDataPath);
+      const auto sha1 = ComputeSHA1(imzMLFile.GetData(), imzMLFile.GetSize());
+      if (!std::equal(std::begin(sha1), std::end(sha1), header.sourceSHA1))
+        return false;
+    }
+    catch (mitk::Exception &)
+    {
+      return false;
+    }
+  }
+
+  std::vector<SpectrumRecord> records(header.numberOfSpectra);
+  if (!f.read(reinterpret_cast<char *>(records.data()), records.size() * sizeof(SpectrumRecord)))
+    return false;
+  f.close();
+
+  spectra.clear();
+  spectra.resize(records.size());
+  for (size_t i = 0; i < records.size(); ++i)
+  {
+    const auto &r = records[i];
+    const auto s = spectra[i];
+    s.SetMzOffset(r.mzOffset);
+    s.SetIntOffset(r.intOffset);
+    s.SetMzLength(r.mzLength);
+    s.SetIntLength(r.intLength);
+    for (unsigned int d = 0; d < 3; ++d)
+      s.SetIndex(d, r.index[d]);
+    if (header.hasWorld)
+      s.SetWorld({r.world[0], r.world[1], r.world[2]});
+    if (header.hasInFileNormalizationFactors)
+      s.SetInFileNormalizationFactor(r.inFileNormalizationFactor);
+  }
+
+  sciLs3DTagUsed = header.sciLs3DTagUsed != 0;
+
+  // the content is unchanged (e.g. the file was copied); store the new modification time, so that the SHA-1 is
+  // not computed again on the next read
+  if (modificationTimeChanged)
+  {
+    Key key;
+    key.SourceFileSize = header.sourceFileSize;
+    key.SourceModificationTime = modificationTime;
+    std::copy_n(header.sourceSHA1, key.SourceSHA1.size(), std::begin(key.SourceSHA1));
+    try
+    {
+      Write(path, key, spectra, sciLs3DTagUsed);
+    }
+    catch (mitk::Exception &)
+    {
+      // e.g. read-only directory: the sidecar stays valid, only the SHA-1 is compared again next time
+    }
+  }
+  return true;
+}
+
+void m2::ImzMLMetaDataCache::Write(const std::string &path,
+                                   const Key &key,
+                                   const ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                                   bool sciLs3DTagUsed)
+{
+  FileHeader header = {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.sciLs3DTagUsed = sciLs3DTagUsed ? 1 : 0;
+  header.numberOfSpectra = spectra.size();
+  header.sourceFileSize = key.SourceFileSize;
+  header.sourceModificationTime = key.SourceModificationTime;
+  std::copy(std::begin(key.SourceSHA1), std::end(key.SourceSHA1), header.sourceSHA1);
+
+  std::vector<SpectrumRecord> records(spectra.size());
+  for (size_t i = 0; i < spectra.size(); ++i)
+  {
+    const auto s = spectra[i];
+    const auto index = s.GetIndex();
+    const auto world = s.GetWorld();
+    auto &r = records[i];
+    r = {};
+    r.mzOffset = s.GetMzOffset();
+    r.intOffset = s.GetIntOffset();
+    r.mzLength = s.GetMzLength();
+    r.intLength = s.GetIntLength();
+    for (unsigned int d = 0; d < 3; ++d)
+      r.index[d] = index[d];
+    r.world[0] = world.x;
+    r.world[1] = world.y;
+    r.world[2] = world.z;
+    r.inFileNormalizationFactor = s.GetInFileNormalizationFactor();
+    header.hasWorld |= world.x != 0 || world.y != 0 || world.z != 0;
+    header.hasInFileNormalizationFactors |= r.inFileNormalizationFactor != 1.0;
+  }
+
+  // unique per process and call, so that concurrent writers of the same sidecar do not share a temporary file
+  static std::atomic<unsigned int> counter{0};
+  const auto temporaryPath = path + ".tmp." + std::to_string(Poco::Process::id()) + "." + std::to_string(counter++);
+  {
+    std::ofstream f(temporaryPath, std::ios_base::binary | std::ios_base::trunc);
+    f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    f.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SpectrumRecord));
+    if (!f)
+    {
+      f.close();
+      itksys::SystemTools::RemoveFile(temporaryPath);
+      mitkThrow() << "Can not write the imzML meta data cache " << temporaryPath;
+    }
+  }
+
+  if (!itksys::SystemTools::RenameFile(temporaryPath, path))
+  {
+    itksys::SystemTools::RemoveFile(temporaryPath);
+    mitkThrow() << "Can not rename " << temporaryPath << " to " << path;
+  }
+}
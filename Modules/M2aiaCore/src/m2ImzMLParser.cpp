@@ -13,12 +13,20 @@ A PARTICULAR PURPOSE.
 See LICENSE.txt for details.
 
 ===================================================================*/
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
 #include <future>
 #include <iterator>
+#include <m2ImzMLMetaDataCache.h>
 #include <m2ImzMLParser.h>
+#include <m2MemoryMappedFile.h>
+#include <m2Process.hpp>
 #include <m2Timer.h>
 #include <math.h>
 #include <numeric>
+#include <string_view>
 #include <unordered_map>
 
 auto m2::ImzMLParser::findLine(std::ifstream &f, std::string name, std::string start_tag, bool eol)
@@ -483,21 +491,289 @@ void m2::ImzMLParser::ReadImageMetaData(m2::ImzMLSpectrumImage::Pointer data)
   }
 }
 
-void m2::ImzMLParser::ReadImageSpectrumMetaData(m2::ImzMLSpectrumImage::Pointer data)
+namespace
 {
-  std::ifstream f;
-  std::vector<std::string> stack, context_stack;
-  std::string line, context, tag, name, value, accession;
-  tag.reserve(60);
-  name.reserve(60);
-  value.reserve(60);
-  context.reserve(60);
-  accession.reserve(60);
+  /**
+   * @brief Name of the element of the tag text (without '<' and '>').
+   */
+  std::string_view TagName(std::string_view tag)
+  {
+    const auto e = tag.find_first_of(" \t\r\n/");
+    return tag.substr(0, e);
+  }
 
-  std::unordered_map<std::string, std::function<void(const std::string &)>> accession_map;
-  std::unordered_map<std::string, std::function<void(const std::string &)>> context_map;
-  for (auto &source : data->GetImzMLSpectrumImageSourceList())
+  /**
+   * @brief Value of the attribute name within the tag text; empty if the attribute is not present.
+   */
+  std::string_view AttributeValue(std::string_view tag, std::string_view name)
+  {
+    for (auto p = tag.find(name); p != std::string_view::npos; p = tag.find(name, p + 1))
+    {
+      if (p == 0 || !std::isspace(static_cast<unsigned char>(tag[p - 1])))
+        continue;
+      auto q = p + name.size();
+      while (q < tag.size() && std::isspace(static_cast<unsigned char>(tag[q])))
+        ++q;
+      if (q >= tag.size() || tag[q] != '=')
+        continue;
+      ++q;
+      while (q < tag.size() && std::isspace(static_cast<unsigned char>(tag[q])))
+        ++q;
+      if (q >= tag.size() || (tag[q] != '"' && tag[q] != '\''))
+        continue;
+      const auto e = tag.find(tag[q], q + 1);
+      if (e == std::string_view::npos)
+        return {};
+      return tag.substr(q + 1, e - q - 1);
+    }
+    return {};
+  }
+
+  template <class T>
+  T ParseInteger(std::string_view value, std::string_view tag)
+  {
+    T result = 0;
+    const auto r = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (r.ec != std::errc())
+      mitkThrow() << "Invalid integer value in imzML tag <" << tag << ">";
+    return result;
+  }
+
+  double ParseDouble(std::string_view value, std::string_view tag)
+  {
+    double result = 0;
+#if defined(__cpp_lib_to_chars)
+    const auto r = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (r.ec != std::errc())
+      mitkThrow() << "Invalid floating point value in imzML tag <" << tag << ">";
+#else
+    // floating point from_chars is not available: strtod on a null-terminated copy
+    char buffer[64];
+    const auto n = std::min(value.size(), sizeof(buffer) - 1);
+    std::copy_n(value.data(), n, buffer);
+    buffer[n] = '\0';
+    char *end = nullptr;
+    result = std::strtod(buffer, &end);
+    if (end == buffer)
+      mitkThrow() << "Invalid floating point value in imzML tag <" << tag << ">";
+#endif
+    return result;
+  }
+
+  /**
+   * @brief Position of the first <spectrum> start tag at or behind pos; text.size() if there is none.
+   */
+  size_t FindSpectrumStart(std::string_view text, size_t pos)
+  {
+    constexpr std::string_view startTag = "<spectrum";
+    for (pos = text.find(startTag, pos); pos != std::string_view::npos; pos = text.find(startTag, pos + 1))
+    {
+      const auto next = pos + startTag.size();
+      if (next < text.size() && (std::isspace(static_cast<unsigned char>(text[next])) || text[next] == '>'))
+        return pos;
+    }
+    return text.size();
+  }
+
+  struct SpectrumListChunk
+  {
+    m2::ImzMLSpectrumImage::SpectrumVectorType spectra;
+    bool sciLs3DTagUsed = false;
+  };
+
+  /**
+   * @brief Parses the spectra of a part of the spectrumList. The text has to start at a <spectrum> tag.
+   */
+  void ParseSpectrumListChunk(std::string_view text,
+                              std::string_view mzArrayRefName,
+                              std::string_view intensityArrayRefName,
+                              SpectrumListChunk &chunk)
   {
+    std::string_view context;
+    auto &spectra = chunk.spectra;
+    bool inSpectrum = false;
+
+    for (auto pos = text.find('<'); pos != std::string_view::npos; pos = text.find('<', pos))
+    {
+      const auto end = text.find('>', pos);
+      if (end == std::string_view::npos)
+        break;
+      const auto tag = text.substr(pos + 1, end - pos - 1);
+      pos = end + 1;
+
+      if (tag.empty())
+        continue;
+
+      if (tag[0] == '/')
+      { // end-tag
+        if (TagName(tag.substr(1)) == "spectrum")
+          inSpectrum = false;
+        continue;
+      }
+
+      const auto name = TagName(tag);
+      if (name == "spectrum")
+      {
+        // TODO: Backtracability to spectrum in file may be lost.
+        //  Maybe we can add the id string to the BinarySpectrumMetaData definition.
+        spectra.AddSpectrum();
+        inSpectrum = true;
+        continue;
+      }
+
+      if (name == "referenceableParamGroupRef")
+      {
+        context = AttributeValue(tag, "ref");
+        continue;
+      }
+
+      if (!inSpectrum || (name != "cvParam" && name != "userParam"))
+        continue;
+
+      const auto spectrum = spectra[spectra.size() - 1];
+
+      const auto accession = AttributeValue(tag, "accession");
+      if (accession.empty())
+      {
+        // e.g. support old 3D imzML Data (SciLs specific tags)
+        if (AttributeValue(tag, "name") == "3DPositionZ")
+        {
+          auto world = spectrum.GetWorld();
+          world.z = ParseDouble(AttributeValue(tag, "value"), tag);
+          spectrum.SetWorld(world);
+          chunk.sciLs3DTagUsed = true;
+        }
+        continue;
+      }
+
+      const auto value = AttributeValue(tag, "value");
+      if (accession == "IMS:1000050")
+        spectrum.SetIndex(0, ParseInteger<unsigned long>(value, tag) - 1);
+      else if (accession == "IMS:1000051")
+        spectrum.SetIndex(1, ParseInteger<unsigned long>(value, tag) - 1);
+      else if (accession == "IMS:1000052")
+        spectrum.SetIndex(2, ParseInteger<unsigned long>(value, tag) - 1);
+      else if (accession == "MS:1000285")
+        spectrum.SetInFileNormalizationFactor(ParseDouble(value, tag));
+      else if (accession == "IMS:1000103" || accession == "IMS:1000102")
+      {
+        const bool isLength = accession == "IMS:1000103";
+        if (context == mzArrayRefName)
+        {
+          if (isLength)
+            spectrum.SetMzLength(ParseInteger<m2::ImzMLSpectrumImage::BinaryDataLengthType>(value, tag));
+          else
+            spectrum.SetMzOffset(ParseInteger<m2::ImzMLSpectrumImage::BinaryDataOffsetType>(value, tag));
+        }
+        else if (context == intensityArrayRefName)
+        {
+          if (isLength)
+            spectrum.SetIntLength(ParseInteger<m2::ImzMLSpectrumImage::BinaryDataLengthType>(value, tag));
+          else
+            spectrum.SetIntOffset(ParseInteger<m2::ImzMLSpectrumImage::BinaryDataOffsetType>(value, tag));
+        }
+      }
+      else if (accession == "3DPositionX" || accession == "3DPositionY" || accession == "3DPositionZ")
+      {
+        auto world = spectrum.GetWorld();
+        const double position = ParseDouble(value, tag);
+        if (accession.back() == 'X')
+          world.x = position;
+        else if (accession.back() == 'Y')
+          world.y = position;
+        else
+          world.z = position;
+        spectrum.SetWorld(world);
+      }
+    }
+  }
+
+  /**
+   * @brief Parses the spectrumList of the memory mapped imzML file. The list is split at <spectrum> tags into
+   * chunks that are parsed in parallel; the spectra of all chunks are concatenated in file order.
+   */
+  void ParseSpectrumList(const m2::ImzMLSpectrumImage *data,
+                         const m2::MemoryMappedFile &file,
+                         m2::ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                         bool &sciLs3DTagUsed)
+  {
+    const std::string_view xml(file.GetData(), file.GetSize());
+    const auto listStart = xml.find("<spectrumList");
+    if (listStart == std::string_view::npos)
+      mitkThrow() << "No spectrumList found in " << file.GetPath();
+    const auto listTagEnd = xml.find('>', listStart);
+    if (listTagEnd == std::string_view::npos)
+      mitkThrow() << "Incomplete spectrumList tag in " << file.GetPath();
+    const auto listTag = xml.substr(listStart + 1, listTagEnd - listStart - 1);
+    const auto count = ParseInteger<unsigned long long>(AttributeValue(listTag, "count"), listTag);
+
+    auto listEnd = xml.find("</spectrumList", listTagEnd);
+    if (listEnd == std::string_view::npos)
+      listEnd = xml.size();
+    const auto list = xml.substr(listTagEnd + 1, listEnd - listTagEnd - 1);
+
+    // chunks of at least 1 MB
+    const unsigned int threads = data->GetNumberOfThreads();
+    const auto numberOfChunks = std::max<size_t>(1, std::min<size_t>(list.size() >> 20, 16 * threads));
+    std::vector<size_t> chunkStarts(numberOfChunks + 1, list.size());
+    chunkStarts[0] = FindSpectrumStart(list, 0);
+    for (size_t c = 1; c < numberOfChunks; ++c)
+      chunkStarts[c] = FindSpectrumStart(list, std::max(chunkStarts[c - 1], c * (list.size() / numberOfChunks)));
+
+    const auto mzArrayRefName = data->GetPropertyValue<std::string>("m/z array");
+    const auto intensityArrayRefName = data->GetPropertyValue<std::string>("intensity array");
+
+    std::vector<SpectrumListChunk> chunks(numberOfChunks);
+    for (auto &chunk : chunks)
+      chunk.spectra.reserve(count / numberOfChunks + 1);
+
+    m2::Process::ParallelFor(
+      numberOfChunks,
+      threads,
+      [&](unsigned int, unsigned int a, unsigned int b)
+      {
+        for (unsigned int c = a; c < b; ++c)
+          ParseSpectrumListChunk(list.substr(chunkStarts[c], chunkStarts[c + 1] - chunkStarts[c]),
+                                 mzArrayRefName,
+                                 intensityArrayRefName,
+                                 chunks[c]);
+      },
+      1);
+
+    spectra.clear();
+    spectra.reserve(count);
+    sciLs3DTagUsed = false;
+    for (auto &chunk : chunks)
+    {
+      spectra.Append(std::move(chunk.spectra));
+      sciLs3DTagUsed |= chunk.sciLs3DTagUsed;
+    }
+
+    if (spectra.size() != count)
+      MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass())
+        << "The spectrumList of " << file.GetPath() << " declares " << count
+        << " spectra, but " << spectra.size() << " were found.";
+  }
+
+  /**
+   * @brief Line based parser of the spectrumList; used if the imzML file can not be memory mapped.
+   */
+  void ParseSpectrumListStream(m2::ImzMLSpectrumImage *data,
+                               m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+                               bool &sciLs3DTagUsed)
+  {
+    std::ifstream f;
+    std::vector<std::string> stack, context_stack;
+    std::string line, context, tag, name, value, accession;
+    tag.reserve(60);
+    name.reserve(60);
+    value.reserve(60);
+    context.reserve(60);
+    accession.reserve(60);
+
+    std::unordered_map<std::string, std::function<void(const std::string &)>> accession_map;
+    std::unordered_map<std::string, std::function<void(const std::string &)>> context_map;
+
     f.open((source.m_ImzMLDataPath), std::ios_base::binary);
 
     std::map<std::string, unsigned> precisionDict = {{"32-bit float", sizeof(float)},
@@ -572,45 +848,48 @@ void m2::ImzMLParser::ReadImageSpectrumMetaData(m2::ImzMLSpectrumImage::Pointer
       context_map["spectrum"] = [&](auto line)
       {
         attributValue(line, "index", value);
-        spectra[spectrumIndexReference].index.SetElement(2, 0);
+        spectra[spectrumIndexReference].SetIndex(2, 0);
         // TODO: Backtracability to spectrum in file may be lost.
         //  Maybe we can add the id string to the BinarySpectrumMetaData definition.
         //  e.g. spectrum.tag = attributValue(line, "id", value);
       };
 
       accession_map["IMS:1000050"] = [&](auto line)
-      { spectra[spectrumIndexReference].index.SetElement(0, std::stoul(attributValue(line, "value", value)) - 1); };
+      { spectra[spectrumIndexReference].SetIndex(0, std::stoul(attributValue(line, "value", value)) - 1); };
       accession_map["IMS:1000051"] = [&](auto line)
-      { spectra[spectrumIndexReference].index.SetElement(1, std::stoul(attributValue(line, "value", value)) - 1); };
+      { spectra[spectrumIndexReference].SetIndex(1, std::stoul(attributValue(line, "value", value)) - 1); };
       accession_map["IMS:1000052"] = [&](auto line)
-      { spectra[spectrumIndexReference].index.SetElement(2, std::stoul(attributValue(line, "value", value)) - 1); };
-      accession_map["3DPositionX"] = [&](auto line)
-      { spectra[spectrumIndexReference].world.x = std::stod(attributValue(line, "value", value)); };
-      accession_map["3DPositionY"] = [&](auto line)
-      { spectra[spectrumIndexReference].world.y = std::stod(attributValue(line, "value", value)); };
-      accession_map["3DPositionZ"] = [&](auto line)
-      { spectra[spectrumIndexReference].world.z = std::stod(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetIndex(2, std::stoul(attributValue(line, "value", value)) - 1); };
+      const auto setWorld = [&](auto line, double m2::SpectrumMetaDataStore::WorldCoordinates::*element)
+      {
+        const auto spectrum = spectra[spectrumIndexReference];
+        auto world = spectrum.GetWorld();
+        world.*element = std::stod(attributValue(line, "value", value));
+        spectrum.SetWorld(world);
+      };
+      accession_map["3DPositionX"] = [&](auto line) { setWorld(line, &m2::SpectrumMetaDataStore::WorldCoordinates::x); };
+      accession_map["3DPositionY"] = [&](auto line) { setWorld(line, &m2::SpectrumMetaDataStore::WorldCoordinates::y); };
+      accession_map["3DPositionZ"] = [&](auto line) { setWorld(line, &m2::SpectrumMetaDataStore::WorldCoordinates::z); };
 
       accession_map["MS:1000285"] = [&](auto line)
-      { spectra[spectrumIndexReference].inFileNormalizationFactor = std::stod(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetInFileNormalizationFactor(std::stod(attributValue(line, "value", value))); };
 
       context_map["referenceableParamGroupRef"] = [&](auto line) { attributValue(line, "ref", context); };
 
       auto mzArrayRefName = data->GetPropertyValue<std::string>("m/z array");
       accession_map["IMS:1000103[" + mzArrayRefName + "]"] = [&](auto line)
-      { spectra[spectrumIndexReference].mzLength = std::stoull(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetMzLength(std::stoull(attributValue(line, "value", value))); };
       accession_map["IMS:1000102[" + mzArrayRefName + "]"] = [&](auto line)
-      { spectra[spectrumIndexReference].mzOffset = std::stoull(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetMzOffset(std::stoull(attributValue(line, "value", value))); };
 
       auto intensityArrayRefName = data->GetPropertyValue<std::string>("intensity array");
       accession_map["IMS:1000103[" + intensityArrayRefName + "]"] = [&](auto line)
-      { spectra[spectrumIndexReference].intLength = std::stoull(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetIntLength(std::stoull(attributValue(line, "value", value))); };
       accession_map["IMS:1000102[" + intensityArrayRefName + "]"] = [&](auto line)
-      { spectra[spectrumIndexReference].intOffset = std::stoull(attributValue(line, "value", value)); };
+      { spectra[spectrumIndexReference].SetIntOffset(std::stoull(attributValue(line, "value", value))); };
 
       std::vector<char> buff;
       std::list<std::thread> threads;
-      bool _ScilsTag3DCoordinateUsed = false;
       {
         while (!f.eof())
         {
@@ -644,7 +923,7 @@ void m2::ImzMLParser::ReadImageSpectrumMetaData(m2::ImzMLSpectrumImage::Pointer
               if (name.compare("3DPositionZ") == 0)
               {
                 evaluateAccession(line, name, accession_map);
-                _ScilsTag3DCoordinateUsed = true;
+                sciLs3DTagUsed = true;
               }
             }
           }
@@ -653,74 +932,137 @@ void m2::ImzMLParser::ReadImageSpectrumMetaData(m2::ImzMLSpectrumImage::Pointer
           evaluateContext(line, tag, context_map, context);
         }
       }
+    }
+  }
 
-      std::set<unsigned int> uniques;
-      if (_ScilsTag3DCoordinateUsed)
-      { // check z world uniques
-        // MITK_INFO << "SciLs 3D tag found";
-        for (auto &s : spectra)
-          uniques.insert(s.world.z);
-
-        // MITK_INFO << "\t" << uniques.size() << " unique z positions found:";
-        // std::copy(std::begin(uniques), std::end(uniques), std::ostream_iterator<unsigned int>{std::cout, ", "});
-
-        std::map<unsigned, unsigned> worldToIndexMap;
-        unsigned i = 0;
-        for (const auto &u : uniques)
-          worldToIndexMap[u] = i++;
-
-        if (uniques.size() > 1)
+  /**
+   * @brief Derives the z index of the spectra from z world positions (SciLs) or the z indices.
+   */
+  void EvaluateZPositions(m2::ImzMLSpectrumImage *data,
+                          m2::ImzMLSpectrumImage::SpectrumVectorType &spectra,
+                          bool sciLs3DTagUsed)
+  {
+    std::set<unsigned int> uniques;
+    if (sciLs3DTagUsed)
+    { // check z world uniques
+      // MITK_INFO << "SciLs 3D tag found";
+      for (const auto s : spectra)
+        uniques.insert(s.GetWorld().z);
+
+      // MITK_INFO << "\t" << uniques.size() << " unique z positions found:";
+      // std::copy(std::begin(uniques), std::end(uniques), std::ostream_iterator<unsigned int>{std::cout, ", "});
+
+      std::map<unsigned, unsigned> worldToIndexMap;
+      unsigned i = 0;
+      for (const auto &u : uniques)
+        worldToIndexMap[u] = i++;
+
+      if (uniques.size() > 1)
+      {
+        unsigned zSpacing;
+        unsigned zCount;
+        std::list<unsigned> diffs, diffs_uniques;
+        std::adjacent_difference(std::begin(uniques), std::end(uniques), std::back_inserter(diffs));
+        diffs_uniques = diffs;
+        diffs_uniques.sort();
+        diffs_uniques.erase(std::unique(std::begin(diffs_uniques), std::end(diffs_uniques)), std::end(diffs_uniques));
+        // MITK_INFO << "\t" << diffs_uniques.size() << " unique z distances found:";
+        // std::copy(
+        //   std::begin(diffs_uniques), std::end(diffs_uniques), std::ostream_iterator<unsigned>{std::cout, ", "});
+        unsigned maxCount = 0;
+        for (auto &uDiff : diffs_uniques)
         {
-          unsigned zSpacing;
-          unsigned zCount;
-          std::list<unsigned> diffs, diffs_uniques;
-          std::adjacent_difference(std::begin(uniques), std::end(uniques), std::back_inserter(diffs));
-          diffs_uniques = diffs;
-          diffs_uniques.sort();
-          diffs_uniques.erase(std::unique(std::begin(diffs_uniques), std::end(diffs_uniques)), std::end(diffs_uniques));
-          // MITK_INFO << "\t" << diffs_uniques.size() << " unique z distances found:";
-          // std::copy(
-          //   std::begin(diffs_uniques), std::end(diffs_uniques), std::ostream_iterator<unsigned>{std::cout, ", "});
-          unsigned maxCount = 0;
-          for (auto &uDiff : diffs_uniques)
+          unsigned count = std::count(std::begin(diffs), std::end(diffs), uDiff);
+          // MITK_INFO << "Different values " << uDiff << " were found " << count << " times.";
+          if (maxCount < count)
           {
-            unsigned count = std::count(std::begin(diffs), std::end(diffs), uDiff);
-            // MITK_INFO << "Different values " << uDiff << " were found " << count << " times.";
-            if (maxCount < count)
-            {
-              maxCount = count;
-              zSpacing = uDiff;
-            }
+            maxCount = count;
+            zSpacing = uDiff;
           }
+        }
 
-          auto a = uniques.begin();
-          auto b = std::next(uniques.begin(), 1);
-          zSpacing = (*b) - (*a);
-          zCount = uniques.size();
-          //          bool startsByZero = uniques.find(0) != uniques.end();
+        auto a = uniques.begin();
+        auto b = std::next(uniques.begin(), 1);
+        zSpacing = (*b) - (*a);
+        zCount = uniques.size();
+        //          bool startsByZero = uniques.find(0) != uniques.end();
 
-          // Transform z physical coordinates to index coordinates
-          for (auto &s : spectra)
-            s.index.SetElement(2, worldToIndexMap[static_cast<unsigned>(s.world.z)]);
+        // Transform z physical coordinates to index coordinates
+        for (const auto s : spectra)
+          s.SetIndex(2, worldToIndexMap[static_cast<unsigned>(s.GetWorld().z)]);
 
-          data->SetPropertyValue<unsigned>("max count of pixel z", zCount);
-          data->SetPropertyValue<double>("pixel size z", m2::MicroMeterToMilliMeter(zSpacing));
-        }
+        data->SetPropertyValue<unsigned>("max count of pixel z", zCount);
+        data->SetPropertyValue<double>("pixel size z", m2::MicroMeterToMilliMeter(zSpacing));
       }
-      else
-      { // check index z uniques
-        uniques.clear();
-        for (auto &s : spectra)
-          uniques.insert(s.index[2]);
+    }
+    else
+    { // check index z uniques
+      uniques.clear();
+      for (const auto s : spectra)
+        uniques.insert(s.GetIndex()[2]);
 
-        if (uniques.size() > 1)
+      if (uniques.size() > 1)
+      {
+        data->SetPropertyValue<unsigned>("max count of pixel z", uniques.size());
+        // is set to 10 micrometers fix (can be changed in app)
+        data->SetPropertyValue<double>("pixel size z", m2::MicroMeterToMilliMeter(10));
+      }
+    }
+  }
+
+} // namespace
+
+void m2::ImzMLParser::ReadImageSpectrumMetaData(m2::ImzMLSpectrumImage::Pointer data)
+{
+  for (auto &source : data->GetImzMLSpectrumImageSourceList())
+  {
+    auto &spectra = source.m_Spectra;
+    bool sciLs3DTagUsed = false;
+
+    const auto cachePath = m2::ImzMLMetaDataCache::GetDefaultPath(source.m_ImzMLDataPath);
+    const bool useCache = data->GetUseSpectrumMetaDataCache();
+    if (!useCache || !m2::ImzMLMetaDataCache::Read(cachePath, source.m_ImzMLDataPath, spectra, sciLs3DTagUsed))
+    {
+      m2::MemoryMappedFile file;
+      try
+      {
+        file.Open(source.m_ImzMLDataPath);
+      }
+      catch (mitk::Exception &e)
+      {
+        MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass())
+          << e.GetDescription() << " The imzML file is parsed using file streams.";
+      }
+
+      if (file.IsOpen())
+      {
+        // the checksum for the cache is computed while the spectrumList is parsed
+        std::future<m2::ImzMLMetaDataCache::Key> key;
+        if (useCache)
+          key = std::async(std::launch::async, [&file] { return m2::ImzMLMetaDataCache::MakeKey(file); });
+
+        ParseSpectrumList(data, file, spectra, sciLs3DTagUsed);
+
+        if (useCache)
         {
-          data->SetPropertyValue<unsigned>("max count of pixel z", uniques.size());
-          // is set to 10 micrometers fix (can be changed in app)
-          data->SetPropertyValue<double>("pixel size z", m2::MicroMeterToMilliMeter(10));
+          try
+          {
+            m2::ImzMLMetaDataCache::Write(cachePath, key.get(), spectra, sciLs3DTagUsed);
+          }
+          catch (mitk::Exception &e)
+          {
+            MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass()) << e.GetDescription();
+          }
         }
       }
+      else
+      {
+        ParseSpectrumListStream(data, source, sciLs3DTagUsed);
+      }
     }
+
+    data->SetPropertyValue<unsigned>("number of measurements", spectra.size());
+    EvaluateZPositions(data, spectra, sciLs3DTagUsed);
   }
 }
 
@@ -15,8 +15,14 @@ See LICENSE.txt for details.
 ===================================================================*/
 
 #include <m2ImzMLSpectrumImage.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <m2BinaryDataPrefetcher.h>
 #include <m2Process.hpp>
 #include <m2SpectrumImageProcessor.h>
+#include <m2SpectrumReadPlan.h>
 #include <m2Timer.h>
 #include <mitkImageAccessByItk.h>
 #include <mitkImagePixelReadAccessor.h>
@@ -32,12 +38,479 @@ See LICENSE.txt for details.
 #include <signal/m2RunningMedian.h>
 #include <signal/m2Smoothing.h>
 #include <signal/m2Transformer.h>
+#include <utility>
+
+namespace
+{
+  /**
+   * @brief Scratch buffer of the calling thread. Its capacity is kept across calls; slots are independent buffers.
+   */
+  template <class DataType, unsigned int Slot = 0>
+  std::vector<DataType> &ThreadLocalBuffer(std::size_t size)
+  {
+    thread_local std::vector<DataType> buffer;
+    buffer.resize(size);
+    return buffer;
+  }
+
+  /**
+   * @brief Reads typed data from the binary data file of an image source.
+   * If the source is memory mapped, data is taken from the mapping. Otherwise a stream of the source is acquired
+   * on the first read and returned on destruction (see m2::FileStreamPool), so that consecutive reads of a reader
+   * reuse the open file.
+   */
+  class BinaryDataReader
+  {
+  public:
+    /**
+     * @brief If readAheadLimit (bytes) is not 0, reads of a plan read ahead (see m2::BinaryDataPrefetcher).
+     */
+    explicit BinaryDataReader(const m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+                              std::uint64_t readAheadLimit = 0)
+      : m_Source(source), m_Mapping(source.m_BinaryDataMapping.get()), m_ReadAheadLimit(readAheadLimit)
+    {
+    }
+
+    ~BinaryDataReader()
+    {
+      if (m_Streams)
+        m_Streams->Release(std::move(m_Stream));
+    }
+
+    BinaryDataReader(const BinaryDataReader &) = delete;
+    BinaryDataReader &operator=(const BinaryDataReader &) = delete;
+
+    template <class DataType>
+    void Read(unsigned long long offset, unsigned long long length, DataType *dst)
+    {
+      if (m_Mapping)
+      {
+        m_Mapping->Read(offset, length, dst);
+        return;
+      }
+      if (!m_Stream)
+      {
+        // sources without a stream pool (binary data not initialized yet) use a pool of this reader
+        m_Streams = m_Source.m_BinaryDataStreams;
+        if (!m_Streams)
+          m_Streams = std::make_shared<m2::FileStreamPool>(m_Source.m_BinaryDataPath);
+        m_Stream = m_Streams->Acquire();
+      }
+      m2::ImzMLSpectrumImage::binaryDataToVector(*m_Stream, offset, length, dst);
+    }
+
+    /**
+     * @brief Typed view into the mapped binary data. Empty if the source is not mapped or the data is misaligned.
+     */
+    template <class DataType>
+    m2::Span<const DataType> GetSpan(unsigned long long offset, unsigned long long length) const noexcept
+    {
+      if (m_Mapping)
+        return m_Mapping->GetSpan<DataType>(offset, length);
+      return {};
+    }
+
+    /**
+     * @brief Reads the blocks of a plan and calls visitor(request, data) for each request in file order.
+     * data points to the bytes of the request; it is taken from the mapping or from a block buffer and is valid
+     * during the call only.
+     */
+    template <class VisitorType>
+    void Read(const m2::SpectrumReadPlan &plan, VisitorType visitor)
+    {
+      const auto &requests = plan.GetRequests();
+      const auto &blocks = plan.GetBlocks();
+      std::unique_ptr<m2::BinaryDataPrefetcher> prefetcher;
+      if (!m_Mapping && m_ReadAheadLimit && blocks.size() > 1)
+        prefetcher.reset(new m2::BinaryDataPrefetcher(m_Source.m_BinaryDataPath, plan, m_ReadAheadLimit));
+
+      for (std::size_t k = 0; k < blocks.size(); ++k)
+      {
+        const auto &block = blocks[k];
+        const char *data;
+        if (m_Mapping)
+        {
+          if (!m_Mapping->Contains(block.offset, block.numberOfBytes))
+            mitkThrow() << "Read of " << block.numberOfBytes << " bytes at offset " << block.offset
+                        << " exceeds the binary data file " << m_Source.m_BinaryDataPath;
+          if (m_ReadAheadLimit && k + 1 < blocks.size())
+            m_Mapping->WillNeed(blocks[k + 1].offset, blocks[k + 1].numberOfBytes);
+          data = m_Mapping->GetData() + block.offset;
+        }
+        else if (prefetcher)
+        {
+          data = prefetcher->Next();
+        }
+        else
+        {
+          m_Buffer.resize(block.numberOfBytes);
+          Read(block.offset, block.numberOfBytes, m_Buffer.data());
+          data = m_Buffer.data();
+        }
+        for (auto r = block.firstRequest; r < block.lastRequest; ++r)
+          visitor(requests[r], data + (requests[r].offset - block.offset));
+      }
+    }
+
+  private:
+    const m2::ImzMLSpectrumImage::ImzMLImageSource &m_Source;
+    const m2::MemoryMappedFile *m_Mapping;
+    std::uint64_t m_ReadAheadLimit;
+    std::vector<char> m_Buffer;
+    std::shared_ptr<m2::FileStreamPool> m_Streams;
+    m2::FileStreamPool::StreamPointer m_Stream;
+  };
+
+  /**
+   * @brief Typed view of length elements at data (see BinaryDataReader::Read(plan, visitor)).
+   * Misaligned data is copied to buffer.
+   */
+  template <class DataType>
+  m2::Span<const DataType> AsSpan(const char *data, std::size_t length, std::vector<DataType> &buffer)
+  {
+    if (reinterpret_cast<std::uintptr_t>(data) % alignof(DataType) == 0)
+      return m2::Span<const DataType>(reinterpret_cast<const DataType *>(data), length);
+    buffer.resize(length);
+    std::memcpy(buffer.data(), data, length * sizeof(DataType));
+    return m2::Span<const DataType>(buffer.data(), length);
+  }
+
+  /**
+   * @brief Returns true if ion images of the given processing state can be pooled from the transposed cache.
+   * Raw values are used only if no signal processing is selected (rawIntensities); they are divided by the
+   * normalization image like spectra read from the binary data, which also holds external normalization factors.
+   * Processed values were divided by the normalization factors computed on initialization, so they are not used
+   * with external normalization.
+   */
+  bool IsTransposedCacheUsable(const m2::TransposedSpectrumCache *cache,
+                               std::uint64_t processingHash,
+                               bool rawIntensities,
+                               bool externalNormalization)
+  {
+    if (!cache || !cache->IsComplete())
+      return false;
+    if (cache->HoldsProcessedData())
+      return !externalNormalization && cache->GetKey().ProcessingHash == processingHash;
+    return rawIntensities;
+  }
+
+  /**
+   * @brief Pools the bins [first, first + length) of all pixels of a source from its transposed cache.
+   * Pixels are processed in tiles; values of a tile are gathered bin by bin from contiguous blocks.
+   */
+  template <class IntensityType, class ImageAccessorType, class NormAccessorType, class MaskAccessorType>
+  void PoolTransposedCache(const m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+                           unsigned int first,
+                           unsigned int length,
+                           m2::RangePoolingStrategyType poolingStrategy,
+                           bool useNormalization,
+                           unsigned int threads,
+                           ImageAccessorType &imageAccess,
+                           NormAccessorType &normAccess,
+                           const MaskAccessorType &maskAccess)
+  {
+    const auto &cache = *source.m_TransposedCache;
+    const auto block = cache.GetBins<IntensityType>(first, length);
+    const auto nPixels = cache.GetKey().NumberOfPixels;
+    const bool divideByNorm = useNormalization && !cache.HoldsProcessedData();
+    constexpr unsigned int TileSize = 256;
+
+    m2::Process::ParallelFor(source.m_Spectra.size(),
+                             threads,
+                             [&](auto /*id*/, auto a, auto b)
+                             {
+                               std::vector<IntensityType> values(TileSize * std::size_t(length));
+                               for (unsigned int tileStart = a; tileStart < b; tileStart += TileSize)
+                               {
+                                 const unsigned int tileSize = std::min(TileSize, b - tileStart);
+                                 for (unsigned int bin = 0; bin < length; ++bin)
+                                 {
+                                   const auto row = block.data() + bin * nPixels + tileStart;
+                                   for (unsigned int k = 0; k < tileSize; ++k)
+                                     values[k * length + bin] = row[k];
+                                 }
+
+                                 for (unsigned int k = 0; k < tileSize; ++k)
+                                 {
+                                   const auto spectrum = source.m_Spectra[tileStart + k];
+                                   const auto index = spectrum.GetIndex() + source.m_Offset;
+                                   if (maskAccess && maskAccess->GetPixelByIndex(index) == 0)
+                                   {
+                                     imageAccess.SetPixelByIndex(index, 0);
+                                     continue;
+                                   }
+                                   auto s = std::next(std::begin(values), k * length);
+                                   double val = m2::Signal::RangePooling<IntensityType>(s, s + length, poolingStrategy);
+                                   if (divideByNorm)
+                                     val /= normAccess.GetPixelByIndex(index);
+                                   imageAccess.SetPixelByIndex(index, val);
+                                 }
+                               }
+                             });
+  }
+
+  /**
+   * @brief Pools the data points within [lower, upper] of all spectra of a source using its inverted m/z index.
+   * Only the intensities of the matching data points are read, and the m/z values of the data points in the two
+   * boundary bins of the range (see m2::InvertedMzIndex::Candidates). Pixels without data points in the range are
+   * not modified.
+   */
+  template <class MassAxisType, class IntensityType, class ImageAccessorType, class MaskAccessorType>
+  void PoolInvertedMzIndex(const m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+                           double lower,
+                           double upper,
+                           m2::RangePoolingStrategyType poolingStrategy,
+                           bool useNormalization,
+                           unsigned int threads,
+                           ImageAccessorType &imageAccess,
+                           const MaskAccessorType &maskAccess)
+  {
+    using Entry = m2::InvertedMzIndex::Entry;
+    using Hit = std::pair<std::uint32_t, IntensityType>;
+    const auto candidates = source.m_InvertedMzIndex->GetCandidates(lower, upper);
+    const auto IsMasked = [&](const Entry &entry)
+    {
+      const auto index = source.m_Spectra[entry.spectrum].GetIndex() + source.m_Offset;
+      return maskAccess && maskAccess->GetPixelByIndex(index) == 0;
+    };
+
+    // the entries of a boundary bin within the range, in the order of the index; a request is tagged with the
+    // position of its entry in the bin
+    const auto SelectInRange = [&](m2::Span<const Entry> boundary)
+    {
+      std::vector<Entry> selected;
+      if (boundary.empty())
+        return selected;
+      std::vector<std::vector<std::uint32_t>> selectedT(threads);
+      m2::Process::ParallelFor(boundary.size(),
+                               threads,
+                               [&](unsigned int t, unsigned int a, unsigned int b)
+                               {
+                                 BinaryDataReader reader(source);
+                                 m2::SpectrumReadPlan plan;
+                                 for (unsigned int i = a; i < b; ++i)
+                                 {
+                                   const auto &entry = boundary[i];
+                                   if (IsMasked(entry))
+                                     continue;
+                                   const auto spectrum = source.m_Spectra[entry.spectrum];
+                                   const auto offset = spectrum.GetMzOffset() + entry.position * sizeof(MassAxisType);
+                                   plan.Add(i, offset, sizeof(MassAxisType));
+                                 }
+                                 plan.Build();
+                                 reader.Read(plan,
+                                             [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+                                             {
+                                               MassAxisType mz;
+                                               std::memcpy(&mz, data, sizeof(MassAxisType));
+                                               if (double(mz) >= lower && double(mz) <= upper)
+                                                 selectedT[t].push_back(request.spectrum);
+                                             });
+                               });
+      std::vector<std::uint32_t> positions;
+      for (const auto &selectedOfThread : selectedT)
+        positions.insert(std::end(positions), std::begin(selectedOfThread), std::end(selectedOfThread));
+      std::sort(std::begin(positions), std::end(positions));
+      for (auto i : positions)
+        selected.push_back(boundary[i]);
+      return selected;
+    };
+    const auto lowerBoundary = SelectInRange(candidates.lowerBoundary);
+    const auto upperBoundary = SelectInRange(candidates.upperBoundary);
+
+    // the data points in the range in ascending order of their bins, so the values of a spectrum are pooled in
+    // the order of their positions
+    const auto numberOfEntries = lowerBoundary.size() + candidates.inner.size() + upperBoundary.size();
+    if (numberOfEntries == 0)
+      return;
+    const auto EntryAt = [&](std::size_t i) -> const Entry &
+    {
+      if (i < lowerBoundary.size())
+        return lowerBoundary[i];
+      i -= lowerBoundary.size();
+      if (i < candidates.inner.size())
+        return candidates.inner[i];
+      return upperBoundary[i - candidates.inner.size()];
+    };
+
+    // collect the intensities of all matching data points; the single values are read through a plan, so that
+    // hits of neighbouring data points are read as one block
+    std::vector<std::vector<Hit>> hitsT(threads);
+    m2::Process::ParallelFor(numberOfEntries,
+                             threads,
+                             [&](unsigned int t, unsigned int a, unsigned int b)
+                             {
+                               BinaryDataReader reader(source);
+                               m2::SpectrumReadPlan plan;
+                               for (unsigned int i = a; i < b; ++i)
+                               {
+                                 const auto &entry = EntryAt(i);
+                                 if (IsMasked(entry))
+                                   continue;
+                                 const auto spectrum = source.m_Spectra[entry.spectrum];
+                                 const auto offset = spectrum.GetIntOffset() + entry.position * sizeof(IntensityType);
+                                 plan.Add(entry.spectrum, offset, sizeof(IntensityType));
+                               }
+                               plan.Build();
+
+                               hitsT[t].reserve(hitsT[t].size() + plan.GetRequests().size());
+                               reader.Read(plan,
+                                           [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+                                           {
+                                             IntensityType value;
+                                             std::memcpy(&value, data, sizeof(IntensityType));
+                                             hitsT[t].emplace_back(request.spectrum, value);
+                                           });
+                             });
+
+    std::vector<Hit> hits;
+    for (auto &h : hitsT)
+      hits.insert(std::end(hits), std::begin(h), std::end(h));
+    std::stable_sort(
+      std::begin(hits), std::end(hits), [](const Hit &a, const Hit &b) { return a.first < b.first; });
+
+    // pool the hits of each spectrum
+    std::vector<IntensityType> values;
+    for (auto s = std::begin(hits); s != std::end(hits);)
+    {
+      const auto id = s->first;
+      values.clear();
+      for (; s != std::end(hits) && s->first == id; ++s)
+        values.push_back(s->second);
+
+      const auto spectrum = source.m_Spectra[id];
+      double val = m2::Signal::RangePooling<IntensityType>(std::begin(values), std::end(values), poolingStrategy);
+      if (useNormalization)
+        val /= spectrum.GetNormalizationFactor();
+      imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, val);
+    }
+  }
+
+  /**
+   * @brief Calls block(id, ids, a, b) in parallel for blocks of the spectra of a source, where the spectra of a block
+   * are ids[a..b) or, if ids is nullptr, a..b. The id of the calling thread is in [0, threads) (see ParallelFor).
+   * With onRefinement and a large source, the spectra are processed in coarse-to-fine passes: every 4th pixel in x
+   * and y, every 2nd pixel, then the remaining ones. After each coarse pass the missing pixels repeat the value of
+   * the computed pixel at the top left of their cell (nearest neighbour upsampling) and onRefinement is called.
+   */
+  template <class BlockType, class ImageAccessorType, class MaskAccessorType>
+  void ProcessSpectraProgressively(const m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+                                   unsigned int threads,
+                                   BlockType block,
+                                   const m2::ImageRefinementCallback &onRefinement,
+                                   mitk::Image *image,
+                                   ImageAccessorType &imageAccess,
+                                   const MaskAccessorType &maskAccess)
+  {
+    const auto &spectra = source.m_Spectra;
+    constexpr unsigned int Strides[] = {4, 2, 1};
+    constexpr unsigned int NumberOfPasses = sizeof(Strides) / sizeof(Strides[0]);
+    // smaller sources are generated fast enough in a single pass
+    constexpr std::size_t MinimumNumberOfSpectra = 1 << 18;
+
+    if (!onRefinement || spectra.size() < MinimumNumberOfSpectra)
+    {
+      m2::Process::ParallelFor(spectra.size(), threads, [&](auto id, auto a, auto b) { block(id, nullptr, a, b); });
+      return;
+    }
+
+    // the pass of a spectrum is given by the coarsest stride that divides its x and y index
+    std::vector<unsigned int> passes[NumberOfPasses];
+    for (unsigned int i = 0; i < spectra.size(); ++i)
+    {
+      const auto index = spectra[i].GetIndex();
+      unsigned int k = 0;
+      while (index[0] % Strides[k] || index[1] % Strides[k])
+        ++k;
+      passes[k].push_back(i);
+    }
+
+    for (unsigned int k = 0; k < NumberOfPasses; ++k)
+    {
+      const auto *ids = &passes[k];
+      m2::Process::ParallelFor(passes[k].size(), threads, [&](auto id, auto a, auto b) { block(id, ids, a, b); });
+      if (k + 1 == NumberOfPasses)
+        break;
+
+      const auto stride = Strides[k];
+      for (unsigned int i = 0; i < spectra.size(); ++i)
+      {
+        const auto index = spectra[i].GetIndex();
+        if (index[0] % stride == 0 && index[1] % stride == 0)
+          continue;
+        if (maskAccess && maskAccess->GetPixelByIndex(index + source.m_Offset) == 0)
+          continue;
+        auto anchor = index;
+        anchor[0] -= index[0] % stride;
+        anchor[1] -= index[1] % stride;
+        imageAccess.SetPixelByIndex(index + source.m_Offset, imageAccess.GetPixelByIndex(anchor + source.m_Offset));
+      }
+      image->Modified();
+      onRefinement(k + 1, NumberOfPasses);
+    }
+  }
+
+  /**
+   * @brief Opens the transposed cache of a source or, if no valid cache exists, creates a new one.
+   * Returns nullptr if the cache file can not be created.
+   */
+  std::shared_ptr<m2::TransposedSpectrumCache> OpenOrCreateTransposedCache(
+    const m2::ImzMLSpectrumImage::ImzMLImageSource &source,
+    std::uint64_t numberOfBins,
+    std::uint64_t processingHash,
+    std::uint64_t valueSize)
+  {
+    const auto path = m2::TransposedSpectrumCache::GetDefaultPath(source.m_BinaryDataPath);
+    const auto key = m2::TransposedSpectrumCache::MakeKey(
+      source.m_BinaryDataPath, source.m_Spectra.size(), numberOfBins, processingHash, valueSize);
+
+    if (source.m_TransposedCache && source.m_TransposedCache->IsComplete() && source.m_TransposedCache->GetKey() == key)
+      return source.m_TransposedCache;
+
+    if (auto cache = m2::TransposedSpectrumCache::Open(path, key))
+      return cache;
+
+    try
+    {
+      MITK_INFO(m2::ImzMLSpectrumImage::GetStaticNameOfClass()) << "Create transposed spectrum cache " << path;
+      return m2::TransposedSpectrumCache::Create(path, key);
+    }
+    catch (mitk::Exception &e)
+    {
+      MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass())
+        << e.GetDescription() << " The transposed spectrum cache is not used.";
+      return nullptr;
+    }
+  }
+} // namespace
 
 void m2::ImzMLSpectrumImage::GetImage(double mz, double tol, const mitk::Image *mask, mitk::Image *img) const
 {
   m_Processor->GetImagePrivate(mz, tol, mask, img);
 }
 
+void m2::ImzMLSpectrumImage::GetImage(double mz,
+                                      double tol,
+                                      const mitk::Image *mask,
+                                      mitk::Image *img,
+                                      const CancellationToken &token,
+                                      const ImageRefinementCallback &onRefinement) const
+{
+  m_Processor->GetImagePrivate(mz, tol, mask, img, token, onRefinement);
+}
+
+void m2::ImzMLSpectrumImage::GetImages(const std::vector<IonImageRange> &ranges,
+                                       const mitk::Image *mask,
+                                       const std::vector<mitk::Image *> &images,
+                                       const CancellationToken &token) const
+{
+  if (ranges.size() != images.size())
+    mitkThrow() << "The number of ranges (" << ranges.size() << ") and output images (" << images.size()
+                << ") must be equal!";
+  if (!ranges.empty())
+    m_Processor->GetImagesPrivate(ranges, mask, images, token);
+}
+
 m2::ImzMLSpectrumImage::ImzMLImageSource &m2::ImzMLSpectrumImage::GetImzMLSpectrumImageSource(unsigned int i)
 {
   if (i >= m_SourcesList.size())
@@ -54,10 +527,58 @@ const m2::ImzMLSpectrumImage::ImzMLImageSource &m2::ImzMLSpectrumImage::GetImzML
 }
 
 template <class MassAxisType, class IntensityType>
-void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePrivate(double xRangeCenter,
-                                                                                     double xRangeTol,
-                                                                                     const mitk::Image *mask,
-                                                                                     mitk::Image *destImage)
+typename m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::ImageRequestConfiguration
+  m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImageRequestConfiguration() const
+{
+  ImageRequestConfiguration config;
+  config.spectrumType = p->GetSpectrumType();
+  config.numberOfThreads = p->GetNumberOfThreads();
+  config.useNormalization = p->GetNormalizationStrategy() != m2::NormalizationStrategyType::None;
+  config.externalNormalization = p->GetUseExternalNormalization();
+  config.poolingStrategy = p->GetRangePoolingStrategy();
+  const auto snapshot = GetProcessingSnapshot();
+  config.rawIntensities = snapshot->rawIntensities;
+  config.baselineCorrectionStrategy = snapshot->baselineCorrectionStrategy;
+  config.baselineCorrectionHalfWindowSize = snapshot->baselineCorrectionHalfWindowSize;
+  config.processingHash = snapshot->processingHash;
+  config.xAxis = p->GetXAxis();
+  config.pipeline = snapshot->pipeline;
+  return config;
+}
+
+template <class MassAxisType, class IntensityType>
+std::shared_ptr<const typename m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::ProcessingSnapshot>
+  m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetProcessingSnapshot() const
+{
+  const auto processingHash = p->GetProcessingHash();
+  std::lock_guard<std::mutex> lock(m_ProcessingSnapshotMutex);
+  if (m_ProcessingSnapshot && m_ProcessingSnapshot->processingHash == processingHash)
+    return m_ProcessingSnapshot;
+
+  auto snapshot = std::make_shared<ProcessingSnapshot>();
+  snapshot->processingHash = processingHash;
+  snapshot->rawIntensities = p->GetSmoothingStrategy() == m2::SmoothingType::None &&
+                             p->GetBaselineCorrectionStrategy() == m2::BaselineCorrectionType::None &&
+                             p->GetIntensityTransformationStrategy() == m2::IntensityTransformationType::None;
+  snapshot->baselineCorrectionStrategy = p->GetBaselineCorrectionStrategy();
+  snapshot->baselineCorrectionHalfWindowSize = p->GetBaseLineCorrectionHalfWindowSize();
+  snapshot->pipeline.Initialize(p->GetSmoothingStrategy(),
+                                p->GetSmoothingHalfWindowSize(),
+                                snapshot->baselineCorrectionStrategy,
+                                snapshot->baselineCorrectionHalfWindowSize,
+                                p->GetIntensityTransformationStrategy());
+  m_ProcessingSnapshot = snapshot;
+  return m_ProcessingSnapshot;
+}
+
+template <class MassAxisType, class IntensityType>
+void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePrivate(
+  double xRangeCenter,
+  double xRangeTol,
+  const mitk::Image *mask,
+  mitk::Image *destImage,
+  const CancellationToken &token,
+  const ImageRefinementCallback &onRefinement)
 {
   AccessByItk(destImage, [](auto itkImg) { itkImg->FillBuffer(0); });
   using namespace m2;
@@ -69,26 +590,24 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePri
   if (mask)
     maskAccess.reset(new mitk::ImagePixelReadAccessor<mitk::LabelSetImage::PixelType, 3>(mask));
 
-  p->SetProperty("x_range_center", mitk::DoubleProperty::New(xRangeCenter));
-  p->SetProperty("x_range_tol", mitk::DoubleProperty::New(xRangeTol));
-  auto mdMz = itk::MetaDataObject<double>::New();
-  mdMz->SetMetaDataObjectValue(xRangeCenter);
-  auto mdTol = itk::MetaDataObject<double>::New();
-  mdTol->SetMetaDataObjectValue(xRangeTol);
-  p->GetMetaDataDictionary()["x_range_center"] = mdMz;
-  p->GetMetaDataDictionary()["x_range_tol"] = mdTol;
+  // The properties of the image (x_range_center, x_range_tol) are set by the caller, see SetCurrentIonImageRange.
+  const auto config = GetImageRequestConfiguration();
+  const auto &spectrumType = config.spectrumType;
+  const unsigned t = config.numberOfThreads;
+  const bool useNormalization = config.useNormalization;
+  const auto poolingStrategy = config.poolingStrategy;
 
-  // Profile (continuous) spectrum
-  const auto spectrumType = p->GetSpectrumType();
-  const unsigned t = p->GetNumberOfThreads();
-  const bool useNormalization = p->GetNormalizationStrategy() != m2::NormalizationStrategyType::None;
+  // Without signal processing, pooling commutes with the normalization and mapped data can be pooled in place.
+  // Median pooling reorders its input and always works on a copy.
+  const bool poolInPlace = config.rawIntensities && poolingStrategy != m2::RangePoolingStrategyType::Median;
 
+  // Profile (continuous) spectrum
   if (spectrumType.Format == m2::SpectrumFormat::ContinuousProfile)
   {
     // xRangeCenter subrange
-    const auto mzs = p->GetXAxis();
-    const auto _BaselineCorrectionHWS = p->GetBaseLineCorrectionHalfWindowSize();
-    const auto _BaseLineCorrectionStrategy = p->GetBaselineCorrectionStrategy();
+    const auto &mzs = config.xAxis;
+    const auto _BaselineCorrectionHWS = config.baselineCorrectionHalfWindowSize;
+    const auto _BaseLineCorrectionStrategy = config.baselineCorrectionStrategy;
 
     // Image generateion is based on range operations on the full spectrum for each pixel.
     // Since we are not intrested in values outside of the range, read only values of interest
@@ -99,6 +618,11 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePri
     // 2) Subrange from '(' to ')' with center 'c', offset left '>' and offset right '<'
     // |>>>>>>>>>>>>>>>(********c********)<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<|
     auto subRes = m2::Signal::Subrange(mzs, xRangeCenter - xRangeTol, xRangeCenter + xRangeTol);
+
+    // the range does not overlap the spectral axis: the image remains zero
+    if (subRes.second == 0)
+      return;
+
     const unsigned int offset_right = (mzs.size() - (subRes.first + subRes.second));
     const unsigned int offset_left = subRes.first;
 
@@ -116,59 +640,418 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePri
     const auto newLength = subRes.second + padding_left + padding_right;
     const auto newOffsetModifier = (subRes.first - padding_left) * sizeof(IntensityType);
 
+    // scratch memory of the processing pipeline, one per thread of the request
+    std::vector<typename Signal::SpectrumProcessingPipeline<IntensityType>::Workspace> workspaces(t);
+    // the pooling strategy is selected once, not per pixel
+    const auto PoolRange = Signal::GetRangePoolingFunction<IntensityType, IntensityType *>(poolingStrategy);
+
     for (auto &source : p->GetImzMLSpectrumImageSourceList())
     {
-      m2::Process::Map(
-        source.m_Spectra.size(),
+      token.ThrowIfCancelled();
+
+      // Pool the range from one contiguous block of the transposed cache
+      if (subRes.second > 0 && IsTransposedCacheUsable(source.m_TransposedCache.get(),
+                                                       config.processingHash,
+                                                       config.rawIntensities,
+                                                       config.externalNormalization))
+      {
+        PoolTransposedCache<IntensityType>(source,
+                                           subRes.first,
+                                           subRes.second,
+                                           poolingStrategy,
+                                           useNormalization,
+                                           t,
+                                           imageAccess,
+                                           normAccess,
+                                           maskAccess);
+        continue;
+      }
+
+      ProcessSpectraProgressively(
+        source,
         t,
-        [&](auto /*id*/, auto a, auto b)
+        [&](unsigned int id, const std::vector<unsigned int> *ids, unsigned int a, unsigned int b)
         {
-          std::ifstream f(source.m_BinaryDataPath, std::iostream::binary);
+          // checked once per block of pixels
+          token.ThrowIfCancelled();
+          BinaryDataReader reader(source);
+          SpectrumReadPlan plan;
           std::vector<IntensityType> ints(newLength);
-          std::vector<IntensityType> baseline(newLength);
+          auto &workspace = workspaces[id];
           // 5) (For a specific thread), save the true range positions '(' and ')'
           // for pooling in the data vector. Continue at 6.
           // |>>>>>>>>>[^^^^^(********c********)^^^^^]<<<<<<<<<<<<<<<<<<<<<<<<<|
-          auto s = std::next(std::begin(ints), padding_left);
-          auto e = std::prev(std::end(ints), padding_right);
+          IntensityType *s = ints.data() + padding_left;
+          IntensityType *e = ints.data() + ints.size() - padding_right;
 
-          for (unsigned int i = a; i < b; ++i)
+          plan.Reserve(b - a);
+          for (unsigned int k = a; k < b; ++k)
           {
-            const auto &spectrum = source.m_Spectra[i];
+            const auto i = ids ? (*ids)[k] : k;
+            const auto spectrum = source.m_Spectra[i];
 
             // check if outside of mask
-            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.index + source.m_Offset) == 0)
+            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.GetIndex() + source.m_Offset) == 0)
             {
-              imageAccess.SetPixelByIndex(spectrum.index + source.m_Offset, 0);
+              imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, 0);
               continue;
             }
             // 6) (For a specific pixel) recalculate the new offset
             // |>>>>>>>>>[^^^^^(********c********)^^^^^]<<<<<<<<<<<<<<<<<<<<<<<<<|
-            const auto newOffset = source.m_Spectra[i].intOffset + newOffsetModifier; // new offset
-            binaryDataToVector(f, newOffset, newLength, ints.data());
-
-            // ----- Normalization
-            if (useNormalization)
-            { // check if it is not NormalizationStrategy::None.
-              IntensityType norm = normAccess.GetPixelByIndex(spectrum.index + source.m_Offset);
-              std::transform(std::begin(ints), std::end(ints), std::begin(ints), [&norm](auto &v) { return v / norm; });
+            const auto newOffset = spectrum.GetIntOffset() + newOffsetModifier; // new offset
+            plan.Add(i, newOffset, newLength * sizeof(IntensityType));
+          }
+
+          // 7) Read the ranges of all pixels of the thread in file order
+          plan.Build();
+          reader.Read(plan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto spectrum = source.m_Spectra[request.spectrum];
+                        const auto index = spectrum.GetIndex() + source.m_Offset;
+
+                        if (poolInPlace)
+                        {
+                          const auto view = AsSpan(data, newLength, ints);
+                          double val = Signal::RangePooling<IntensityType>(view.begin(), view.end(), poolingStrategy);
+                          if (useNormalization)
+                            val /= normAccess.GetPixelByIndex(index);
+                          imageAccess.SetPixelByIndex(index, val);
+                          return;
+                        }
+
+                        std::memcpy(ints.data(), data, request.numberOfBytes);
+
+                        // ----- Normalization, smoothing, baseline substraction and intensity transformation
+                        const IntensityType norm = useNormalization ? normAccess.GetPixelByIndex(index) : 1;
+                        config.pipeline(ints.data(), ints.data() + ints.size(), norm, workspace);
+
+                        // ----- Pool the range
+                        const auto val = PoolRange(s, e);
+
+                        // finally set the pixel value
+                        imageAccess.SetPixelByIndex(index, val);
+                      });
+        },
+        onRefinement,
+        destImage,
+        imageAccess,
+        maskAccess);
+    }
+  }
+  else if (any(spectrumType.Format & (m2::SpectrumFormat::ContinuousCentroid | m2::SpectrumFormat::ProcessedCentroid |
+                                      m2::SpectrumFormat::ProcessedProfile)))
+  {
+    // Continuous centroid spectra share the m/z axis, the subrange is the same for all spectra
+    const bool sharedMassAxis = spectrumType.Format == m2::SpectrumFormat::ContinuousCentroid;
+    std::pair<unsigned int, unsigned int> sharedSubRes;
+    if (sharedMassAxis)
+      sharedSubRes = m2::Signal::Subrange(config.xAxis, xRangeCenter - xRangeTol, xRangeCenter + xRangeTol);
+
+    for (auto &source : p->GetImzMLSpectrumImageSourceList())
+    {
+      token.ThrowIfCancelled();
+
+      // Processed data: only the data points inside the range are read
+      if (source.m_InvertedMzIndex)
+      {
+        PoolInvertedMzIndex<MassAxisType, IntensityType>(source,
+                                                         xRangeCenter - xRangeTol,
+                                                         xRangeCenter + xRangeTol,
+                                                         poolingStrategy,
+                                                         useNormalization,
+                                                         t,
+                                                         imageAccess,
+                                                         maskAccess);
+        continue;
+      }
+
+      ProcessSpectraProgressively(
+        source,
+        t,
+        [&](unsigned int /*id*/, const std::vector<unsigned int> *ids, unsigned int a, unsigned int b)
+        {
+          token.ThrowIfCancelled();
+          BinaryDataReader reader(source);
+          SpectrumReadPlan mzPlan, intPlan;
+          std::vector<IntensityType> ints;
+          std::vector<MassAxisType> mzs;
+
+          // the intensities within the range of a spectrum are requested in intPlan
+          const auto RequestRange = [&](unsigned int i, std::pair<unsigned int, unsigned int> subRes)
+          {
+            const auto spectrum = source.m_Spectra[i];
+            if (subRes.second == 0)
+              imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, 0);
+            else
+              intPlan.Add(i,
+                          spectrum.GetIntOffset() + subRes.first * sizeof(IntensityType),
+                          subRes.second * sizeof(IntensityType));
+          };
+
+          for (unsigned int k = a; k < b; ++k)
+          {
+            const auto i = ids ? (*ids)[k] : k;
+            const auto spectrum = source.m_Spectra[i];
+            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.GetIndex() + source.m_Offset) == 0)
+            {
+              imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, 0);
+              continue;
             }
 
-            // ----- Smoothing
-            m_Smoother.operator()(std::begin(ints), std::end(ints));
+            if (sharedMassAxis)
+              RequestRange(i, sharedSubRes);
+            else // !! mass axis of each spectrum is required
+              mzPlan.Add(i, spectrum.GetMzOffset(), spectrum.GetMzLength() * sizeof(MassAxisType));
+          }
+
+          mzPlan.Build();
+          reader.Read(mzPlan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto mzView = AsSpan(data, request.numberOfBytes / sizeof(MassAxisType), mzs);
+                        RequestRange(request.spectrum,
+                                     m2::Signal::Subrange(mzView, xRangeCenter - xRangeTol, xRangeCenter + xRangeTol));
+                      });
+
+          intPlan.Build();
+          reader.Read(intPlan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto spectrum = source.m_Spectra[request.spectrum];
+                        const auto length = request.numberOfBytes / sizeof(IntensityType);
+                        if (poolingStrategy != m2::RangePoolingStrategyType::Median)
+                        {
+                          const auto view = AsSpan(data, length, ints);
+                          double val = Signal::RangePooling<IntensityType>(view.begin(), view.end(), poolingStrategy);
+                          if (useNormalization)
+                            val /= spectrum.GetNormalizationFactor();
+                          imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, val);
+                          return;
+                        }
+
+                        ints.resize(length);
+                        std::memcpy(ints.data(), data, request.numberOfBytes);
+
+                        // TODO: Is it useful to normalize centroid data?
+                        if (useNormalization)
+                        {
+                          std::transform(std::begin(ints),
+                                         std::end(ints),
+                                         std::begin(ints),
+                                         [&](auto &v) { return v / spectrum.GetNormalizationFactor(); });
+                        }
+
+                        auto val =
+                          Signal::RangePooling<IntensityType>(std::begin(ints), std::end(ints), poolingStrategy);
+                        imageAccess.SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, val);
+                      });
+        },
+        onRefinement,
+        destImage,
+        imageAccess,
+        maskAccess);
+    }
+  }
+}
+
+template <class MassAxisType, class IntensityType>
+void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagesPrivate(
+  const std::vector<IonImageRange> &ranges,
+  const mitk::Image *mask,
+  const std::vector<mitk::Image *> &destImages,
+  const CancellationToken &token)
+{
+  using namespace m2;
+  using WriteAccessorType = mitk::ImagePixelWriteAccessor<DisplayImagePixelType, 3>;
 
-            // ----- Baseline Substraction
-            m_BaselineSubstractor(std::begin(ints), std::end(ints), std::begin(baseline));
+  // accessors
+  std::vector<std::unique_ptr<WriteAccessorType>> imageAccess;
+  for (auto *destImage : destImages)
+  {
+    AccessByItk(destImage, [](auto itkImg) { itkImg->FillBuffer(0); });
+    imageAccess.emplace_back(new WriteAccessorType(destImage));
+  }
+  mitk::ImagePixelReadAccessor<NormImagePixelType, 3> normAccess(p->GetNormalizationImage());
+  std::shared_ptr<mitk::ImagePixelReadAccessor<mitk::LabelSetImage::PixelType, 3>> maskAccess;
 
-            // ----- Intensity Transformation
-            m_Transformer(std::begin(ints), std::end(ints));
+  if (mask)
+    maskAccess.reset(new mitk::ImagePixelReadAccessor<mitk::LabelSetImage::PixelType, 3>(mask));
 
-            // ----- Pool the range
-            const auto val = Signal::RangePooling<IntensityType>(s, e, p->GetRangePoolingStrategy());
+  // see GetImagePrivate
+  const auto config = GetImageRequestConfiguration();
+  const auto &spectrumType = config.spectrumType;
+  const unsigned t = config.numberOfThreads;
+  const bool useNormalization = config.useNormalization;
+  const auto poolingStrategy = config.poolingStrategy;
+  // as in GetImagePrivate, so that both give the same values
+  const bool poolInPlace = config.rawIntensities && poolingStrategy != m2::RangePoolingStrategyType::Median;
+
+  // Ranges may overlap. Median pooling reorders its input, so it works on a per-range copy. The pooling strategy is
+  // selected once, not per pixel and range.
+  const bool poolCopy = poolingStrategy == m2::RangePoolingStrategyType::Median;
+  const auto PoolRange = Signal::GetRangePoolingFunction<IntensityType, const IntensityType *>(poolingStrategy);
+  const auto PoolScratch = Signal::GetRangePoolingFunction<IntensityType, IntensityType *>(poolingStrategy);
+  const auto Pool =
+    [poolCopy, PoolRange, PoolScratch](auto first, auto last, std::vector<IntensityType> &scratch) -> double
+  {
+    if (first == last)
+      return 0;
+    if (poolCopy)
+    {
+      scratch.assign(first, last);
+      return PoolScratch(scratch.data(), scratch.data() + scratch.size());
+    }
+    const IntensityType *data = &*first;
+    return PoolRange(data, data + std::distance(first, last));
+  };
 
-            // finally set the pixel value
-            imageAccess.SetPixelByIndex(spectrum.index + source.m_Offset, val);
+  if (spectrumType.Format == m2::SpectrumFormat::ContinuousProfile)
+  {
+    const auto &mzs = config.xAxis;
+    const auto _BaselineCorrectionHWS = config.baselineCorrectionHalfWindowSize;
+    const auto _BaseLineCorrectionStrategy = config.baselineCorrectionStrategy;
+
+    // Each range is padded as in GetImagePrivate and processed on its own, so kernel based operations see the same
+    // values as for a single ion image. The window '(' to ')' enclosing all padded ranges is read once per spectrum.
+    // |>>>>>>>>>>>>>>>([^^^c0^^^]--[^^c1^^]-------[^^^c2^^^])<<<<<<<<<<<<<|
+    struct PaddedRange
+    {
+      unsigned int first;   // first value of the range
+      unsigned int length;  // number of values of the range, 0 if it does not overlap the spectral axis
+      unsigned int start;   // first value of the padded range
+      unsigned int padding; // number of values in front of the range
+      unsigned int paddedLength;
+    };
+    std::vector<PaddedRange> paddedRanges;
+    std::pair<unsigned int, unsigned int> subRes = {0, 0};
+    unsigned int windowStart = mzs.size(), windowEnd = 0;
+    for (const auto &range : ranges)
+    {
+      // the previous result is used as hint, sorted ranges are resolved without a full binary search
+      subRes = m2::Signal::Subrange(mzs, range.mz - range.tol, range.mz + range.tol, subRes);
+      PaddedRange padded = {subRes.first, subRes.second, 0, 0, 0};
+      if (subRes.second > 0)
+      {
+        const unsigned int offset_right = mzs.size() - (subRes.first + subRes.second);
+        const unsigned int offset_left = subRes.first;
+        const unsigned int padding_left =
+          (offset_left / _BaselineCorrectionHWS >= 1 ? _BaselineCorrectionHWS : offset_left) *
+          (_BaseLineCorrectionStrategy != m2::BaselineCorrectionType::None);
+        const unsigned int padding_right =
+          (offset_right / _BaselineCorrectionHWS >= 1 ? _BaselineCorrectionHWS : offset_right) *
+          (_BaseLineCorrectionStrategy != m2::BaselineCorrectionType::None);
+        padded.start = subRes.first - padding_left;
+        padded.padding = padding_left;
+        padded.paddedLength = subRes.second + padding_left + padding_right;
+        windowStart = std::min(windowStart, padded.start);
+        windowEnd = std::max(windowEnd, padded.start + padded.paddedLength);
+      }
+      paddedRanges.push_back(padded);
+    }
+
+    // no range overlaps the spectral axis: all images remain zero
+    if (windowStart >= windowEnd)
+      return;
+
+    const auto newLength = windowEnd - windowStart;
+    const auto newOffsetModifier = windowStart * sizeof(IntensityType);
+
+    // scratch memory of the processing pipeline, one per thread of the request
+    std::vector<typename Signal::SpectrumProcessingPipeline<IntensityType>::Workspace> workspaces(t);
+    const auto PoolProcessed = Signal::GetRangePoolingFunction<IntensityType, IntensityType *>(poolingStrategy);
+
+    for (auto &source : p->GetImzMLSpectrumImageSourceList())
+    {
+      token.ThrowIfCancelled();
+
+      // Each range is one contiguous block of the transposed cache
+      if (IsTransposedCacheUsable(source.m_TransposedCache.get(),
+                                  config.processingHash,
+                                  config.rawIntensities,
+                                  config.externalNormalization))
+      {
+        for (unsigned int k = 0; k < paddedRanges.size(); ++k)
+        {
+          token.ThrowIfCancelled();
+          if (paddedRanges[k].length > 0)
+            PoolTransposedCache<IntensityType>(source,
+                                               paddedRanges[k].first,
+                                               paddedRanges[k].length,
+                                               poolingStrategy,
+                                               useNormalization,
+                                               t,
+                                               *imageAccess[k],
+                                               normAccess,
+                                               maskAccess);
+        }
+        continue;
+      }
+
+      m2::Process::ParallelFor(
+        source.m_Spectra.size(),
+        t,
+        [&](auto id, auto a, auto b)
+        {
+          // checked once per block of pixels
+          token.ThrowIfCancelled();
+          BinaryDataReader reader(source);
+          SpectrumReadPlan plan;
+          std::vector<IntensityType> window(newLength);
+          std::vector<IntensityType> ints;
+          std::vector<IntensityType> scratch;
+          auto &workspace = workspaces[id];
+
+          plan.Reserve(b - a);
+          for (unsigned int i = a; i < b; ++i)
+          {
+            const auto spectrum = source.m_Spectra[i];
+            // outside of mask: images were already set to zero
+            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.GetIndex() + source.m_Offset) == 0)
+              continue;
+            plan.Add(i, spectrum.GetIntOffset() + newOffsetModifier, newLength * sizeof(IntensityType));
           }
+
+          plan.Build();
+          reader.Read(plan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto spectrum = source.m_Spectra[request.spectrum];
+                        const auto index = spectrum.GetIndex() + source.m_Offset;
+                        const auto view = AsSpan(data, newLength, window);
+
+                        if (poolInPlace)
+                        {
+                          const double norm = useNormalization ? normAccess.GetPixelByIndex(index) : 1.0;
+                          for (size_t k = 0; k < paddedRanges.size(); ++k)
+                          {
+                            const auto &range = paddedRanges[k];
+                            if (range.length == 0)
+                              continue;
+                            const auto s = std::next(std::begin(view), range.first - windowStart);
+                            const auto val = Pool(s, std::next(s, range.length), scratch) / norm;
+                            imageAccess[k]->SetPixelByIndex(index, val);
+                          }
+                          return;
+                        }
+
+                        const IntensityType norm = useNormalization ? normAccess.GetPixelByIndex(index) : 1;
+                        for (size_t k = 0; k < paddedRanges.size(); ++k)
+                        {
+                          const auto &range = paddedRanges[k];
+                          if (range.length == 0)
+                            continue;
+
+                          // ----- Normalization, smoothing, baseline substraction and intensity transformation
+                          const auto s = std::next(std::begin(view), range.start - windowStart);
+                          ints.assign(s, std::next(s, range.paddedLength));
+                          config.pipeline(ints.data(), ints.data() + ints.size(), norm, workspace);
+
+                          // ----- Pool the range
+                          const auto first = ints.data() + range.padding;
+                          imageAccess[k]->SetPixelByIndex(index, PoolProcessed(first, first + range.length));
+                        }
+                      });
         });
     }
   }
@@ -177,51 +1060,114 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePri
   {
     for (auto &source : p->GetImzMLSpectrumImageSourceList())
     {
-      m2::Process::Map(
+      token.ThrowIfCancelled();
+
+      // Processed data: only the data points inside the ranges are read
+      if (source.m_InvertedMzIndex)
+      {
+        for (size_t k = 0; k < ranges.size(); ++k)
+        {
+          token.ThrowIfCancelled();
+          PoolInvertedMzIndex<MassAxisType, IntensityType>(source,
+                                                           ranges[k].mz - ranges[k].tol,
+                                                           ranges[k].mz + ranges[k].tol,
+                                                           poolingStrategy,
+                                                           useNormalization,
+                                                           t,
+                                                           *imageAccess[k],
+                                                           maskAccess);
+        }
+        continue;
+      }
+
+      m2::Process::ParallelFor(
         source.m_Spectra.size(),
         t,
         [&](auto /*id*/, auto a, auto b)
         {
-          std::ifstream f(source.m_BinaryDataPath, std::iostream::binary);
+          // checked once per block of pixels
+          token.ThrowIfCancelled();
+          BinaryDataReader reader(source);
+          SpectrumReadPlan mzPlan, intPlan;
           std::vector<IntensityType> ints;
+          std::vector<IntensityType> scratch;
           std::vector<MassAxisType> mzs;
+          std::vector<std::pair<unsigned int, unsigned int>> subRanges(ranges.size());
+          // subranges of all ranges per spectrum, relative to the window of intensities that is read
+          std::vector<std::pair<unsigned int, unsigned int>> windowSubRanges((b - a) * ranges.size());
+
+          mzPlan.Reserve(b - a);
           for (unsigned int i = a; i < b; ++i)
           {
-            auto &spectrum = source.m_Spectra[i];
-            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.index + source.m_Offset) == 0)
-            {
-              imageAccess.SetPixelByIndex(spectrum.index + source.m_Offset, 0);
+            const auto spectrum = source.m_Spectra[i];
+            if (maskAccess && maskAccess->GetPixelByIndex(spectrum.GetIndex() + source.m_Offset) == 0)
               continue;
-            }
-
-            mzs.resize(spectrum.mzLength);
-            binaryDataToVector(
-              f, spectrum.mzOffset, spectrum.mzLength, mzs.data()); // !! read mass axis for each spectrum
-
-            auto subRes = m2::Signal::Subrange(mzs, xRangeCenter - xRangeTol, xRangeCenter + xRangeTol);
-            if (subRes.second == 0)
-            {
-              imageAccess.SetPixelByIndex(spectrum.index + source.m_Offset, 0);
-              continue;
-            }
-
-            ints.resize(subRes.second);
-            binaryDataToVector(
-              f, spectrum.intOffset + subRes.first * sizeof(IntensityType), subRes.second, ints.data());
-
-            // TODO: Is it useful to normalize centroid data?
-            if (p->GetNormalizationStrategy() != m2::NormalizationStrategyType::None)
-            {
-              std::transform(std::begin(ints),
-                             std::end(ints),
-                             std::begin(ints),
-                             [&](auto &v) { return v / spectrum.normalizationFactor; });
-            }
-
-            auto val =
-              Signal::RangePooling<IntensityType>(std::begin(ints), std::end(ints), p->GetRangePoolingStrategy());
-            imageAccess.SetPixelByIndex(spectrum.index + source.m_Offset, val);
+            mzPlan.Add(i, spectrum.GetMzOffset(), spectrum.GetMzLength() * sizeof(MassAxisType));
           }
+
+          mzPlan.Build();
+          reader.Read(mzPlan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto mzView = AsSpan(data, request.numberOfBytes / sizeof(MassAxisType), mzs);
+
+                        // the intensities of all ranges are read at once
+                        unsigned int windowFirst = mzView.size(), windowLast = 0;
+                        for (size_t k = 0; k < ranges.size(); ++k)
+                        {
+                          const auto hint = k ? subRanges[k - 1] : std::make_pair(0u, 0u);
+                          subRanges[k] = m2::Signal::Subrange(
+                            mzView, ranges[k].mz - ranges[k].tol, ranges[k].mz + ranges[k].tol, hint);
+                          if (subRanges[k].second == 0)
+                            continue;
+                          windowFirst = std::min(windowFirst, subRanges[k].first);
+                          windowLast = std::max(windowLast, subRanges[k].first + subRanges[k].second);
+                        }
+                        if (windowFirst >= windowLast)
+                          return;
+
+                        auto window = std::next(std::begin(windowSubRanges), (request.spectrum - a) * ranges.size());
+                        for (const auto &subRes : subRanges)
+                          *window++ = {subRes.second ? subRes.first - windowFirst : 0, subRes.second};
+
+                        const auto spectrum = source.m_Spectra[request.spectrum];
+                        intPlan.Add(request.spectrum,
+                                    spectrum.GetIntOffset() + windowFirst * sizeof(IntensityType),
+                                    (windowLast - windowFirst) * sizeof(IntensityType));
+                      });
+
+          intPlan.Build();
+          reader.Read(intPlan,
+                      [&](const SpectrumReadPlan::Request &request, const char *data)
+                      {
+                        const auto spectrum = source.m_Spectra[request.spectrum];
+                        const auto index = spectrum.GetIndex() + source.m_Offset;
+                        const auto intView = AsSpan(data, request.numberOfBytes / sizeof(IntensityType), ints);
+                        const auto window =
+                          std::next(std::begin(windowSubRanges), (request.spectrum - a) * ranges.size());
+
+                        const double norm = useNormalization ? spectrum.GetNormalizationFactor() : 1.0;
+                        for (size_t k = 0; k < ranges.size(); ++k)
+                        {
+                          if (window[k].second == 0)
+                            continue;
+                          const auto s = std::next(std::begin(intView), window[k].first);
+                          if (!poolCopy || !useNormalization)
+                          {
+                            const auto val = Pool(s, std::next(s, window[k].second), scratch) / norm;
+                            imageAccess[k]->SetPixelByIndex(index, val);
+                            continue;
+                          }
+                          // the median of the normalized values, as in GetImagePrivate
+                          scratch.assign(s, std::next(s, window[k].second));
+                          std::transform(std::begin(scratch),
+                                         std::end(scratch),
+                                         std::begin(scratch),
+                                         [&](auto &v) { return v / spectrum.GetNormalizationFactor(); });
+                          const auto val = PoolScratch(scratch.data(), scratch.data() + scratch.size());
+                          imageAccess[k]->SetPixelByIndex(index, val);
+                        }
+                      });
         });
     }
   }
@@ -229,6 +1175,8 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetImagePri
 
 void m2::ImzMLSpectrumImage::InitializeProcessor()
 {
+  this->StopSpectrumPrefetch();
+  this->m_SpectrumCache.Clear();
   auto intensitiesDataTypeString = GetPropertyValue<std::string>("intensity array value type");
   auto mzValueTypeString = GetPropertyValue<std::string>("m/z array value type");
   if (mzValueTypeString.compare("32-bit float") == 0)
@@ -293,8 +1241,42 @@ void m2::ImzMLSpectrumImage::InitializeGeometry()
   this->SetImageGeometryInitialized(true);
 }
 
+void m2::ImzMLSpectrumImage::InitializeBinaryDataMapping()
+{
+  for (auto &source : m_SourcesList)
+  {
+    if (!m_UseMemoryMappedBinaryData)
+    {
+      source.m_BinaryDataMapping.reset();
+    }
+    else if (!source.m_BinaryDataMapping || source.m_BinaryDataMapping->GetPath() != source.m_BinaryDataPath)
+    {
+      try
+      {
+        source.m_BinaryDataMapping = std::make_shared<m2::MemoryMappedFile>(source.m_BinaryDataPath);
+      }
+      catch (mitk::Exception &e)
+      {
+        MITK_WARN(GetStaticNameOfClass()) << e.GetDescription() << " Binary data is read using file streams.";
+        source.m_BinaryDataMapping.reset();
+      }
+    }
+
+    // streams of a previous file are closed
+    if (source.m_BinaryDataMapping)
+      source.m_BinaryDataStreams.reset();
+    else if (!source.m_BinaryDataStreams || source.m_BinaryDataStreams->GetPath() != source.m_BinaryDataPath)
+      source.m_BinaryDataStreams = std::make_shared<m2::FileStreamPool>(source.m_BinaryDataPath);
+  }
+}
+
 void m2::ImzMLSpectrumImage::InitializeImageAccess()
 {
+  // cached spectra and ion images were processed with the previous state
+  this->StopSpectrumPrefetch();
+  this->m_SpectrumCache.Clear();
+  this->m_IonImageCache.Clear();
+  this->InitializeBinaryDataMapping();
   this->m_Processor->InitializeImageAccess();
   this->SetImageAccessInitialized(true);
 
@@ -421,8 +1403,9 @@ m2::ImzMLSpectrumImage::Pointer m2::ImzMLSpectrumImage::Combine(const m2::ImzMLS
   std::transform(std::begin(B_sources),
                  std::end(B_sources),
                  std::back_inserter(C_sources),
-                 [&](ImzMLImageSource s)
+                 [&](const ImzMLImageSource &b)
                  {
+                   auto s = b;
                    if (stackAxis == 'x')
                      s.m_Offset[0] += A_x; // shift along x-axis
                    if (stackAxis == 'y')
@@ -545,10 +1528,6 @@ template <class MassAxisType, class IntensityType>
 void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeImageAccess()
 {
   //////////---------------------------
-  m_Smoother.Initialize(p->GetSmoothingStrategy(), p->GetSmoothingHalfWindowSize());
-  m_BaselineSubstractor.Initialize(p->GetBaselineCorrectionStrategy(), p->GetBaseLineCorrectionHalfWindowSize());
-  m_Transformer.Initialize(p->GetIntensityTransformationStrategy());
-
   const auto spectrumType = p->GetSpectrumType();
 
   // MITK_INFO(m2::ImzMLSpectrumImage::GetStaticNameOfClass()) << m2::to_string(spectrumType);
@@ -577,26 +1556,26 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
   for (const auto &source : p->GetImzMLSpectrumImageSourceList())
   {
     const auto &spectra = source.m_Spectra;
-    m2::Process::Map(spectra.size(),
-                     p->GetNumberOfThreads(),
-                     [&](unsigned int /*t*/, unsigned int a, unsigned int b)
-                     {
-                       for (unsigned int i = a; i < b; i++)
-                       {
-                         const auto &spectrum = spectra[i];
-
-                         accIndex->SetPixelByIndex(spectrum.index + source.m_Offset, i);
-
-                         // If mask content is generated elsewhere
-                         if (!p->GetUseExternalMask())
-                           accMask->SetPixelByIndex(spectrum.index + source.m_Offset, 1);
-
-                         // If it is a processed file, normalization maps are set to 1 - assuming that spectra were
-                         // already processed if (any(importMode & (m2::SpectrumFormatType::ProcessedCentroid |
-                         // m2::SpectrumFormatType::ProcessedProfile)))
-                         //   accNorm->SetPixelByIndex(spectrum.index + source.m_Offset, 1);
-                       }
-                     });
+    m2::Process::ParallelFor(spectra.size(),
+                             p->GetNumberOfThreads(),
+                             [&](unsigned int /*t*/, unsigned int a, unsigned int b)
+                             {
+                               for (unsigned int i = a; i < b; i++)
+                               {
+                                 const auto spectrum = spectra[i];
+
+                                 accIndex->SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, i);
+
+                                 // If mask content is generated elsewhere
+                                 if (!p->GetUseExternalMask())
+                                   accMask->SetPixelByIndex(spectrum.GetIndex() + source.m_Offset, 1);
+
+                                 // If it is a processed file, normalization maps are set to 1 - assuming that spectra were
+                                 // already processed if (any(importMode & (m2::SpectrumFormatType::ProcessedCentroid |
+                                 // m2::SpectrumFormatType::ProcessedProfile)))
+                                 //   accNorm->SetPixelByIndex(spectrum.index + source.m_Offset, 1);
+                               }
+                             });
   }
 
   // reset prevention flags
@@ -621,13 +1600,15 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
   std::vector<std::vector<double>> sumT;
   std::vector<MassAxisType> mzs;
   const auto normalizationStrategy = p->GetNormalizationStrategy();
+  // memory for reading ahead is shared by all threads
+  const auto readAheadLimit = p->GetReadAheadMemoryLimit() / p->GetNumberOfThreads();
 
   // load m/z axis
   {
     const auto &spectra = source.m_Spectra;
-    std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
-    mzs.resize(spectra[0].mzLength);
-    binaryDataToVector(f, spectra[0].mzOffset, spectra[0].mzLength, mzs.data());
+    BinaryDataReader reader(source);
+    mzs.resize(spectra[0].GetMzLength());
+    reader.Read(spectra[0].GetMzOffset(), spectra[0].GetMzLength(), mzs.data());
     auto &massAxis = p->GetXAxis();
     massAxis.clear();
     std::copy(std::begin(mzs), std::end(mzs), std::back_inserter(massAxis));
@@ -642,68 +1623,133 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
   const auto Maximum = [](const auto &a, const auto &b) { return a > b ? a : b; };
   const auto plus = std::plus<>();
 
+  // Processed values can only be cached if the normalization factors are computed here
+  const bool cacheProcessedData = p->GetTransposedCacheHoldsProcessedData() && !p->GetUseExternalNormalization();
+  const auto snapshot = GetProcessingSnapshot();
+  const std::uint64_t processingHash = cacheProcessedData ? snapshot->processingHash : 0;
+
   // m2::Timer t("Initialize image");
   for (auto &source : p->GetImzMLSpectrumImageSourceList())
   {
     auto &spectra = source.m_Spectra;
 
+    source.m_TransposedCache.reset();
+    if (p->GetUseTransposedCache())
+      source.m_TransposedCache = OpenOrCreateTransposedCache(source, mzs.size(), processingHash, sizeof(IntensityType));
+
+    // an existing cache is used as is, a new one is filled with the spectra read below
+    const auto cache = source.m_TransposedCache && !source.m_TransposedCache->IsComplete()
+                         ? source.m_TransposedCache.get()
+                         : nullptr;
+    // spectra are passed to the cache in tiles of ~32 MB
+    const unsigned int cacheTileSize =
+      std::max<std::size_t>(1, std::min<std::size_t>(256, (std::size_t(32) << 20) / (mzs.size() * sizeof(IntensityType))));
+
     m2::Process::Map(
       source.m_Spectra.size(),
       p->GetNumberOfThreads(),
       [&](unsigned int t, unsigned int a, unsigned int b)
       {
         std::vector<IntensityType> ints(mzs.size(), 0);
-        std::vector<IntensityType> baseline(mzs.size(), 0);
-        std::ifstream f(source.m_BinaryDataPath, std::ifstream::binary);
-
-        for (unsigned long int i = a; i < b; i++)
-        {
-          auto &spectrum = spectra[i];
-
-          // Read data from file ------------
-          binaryDataToVector(f, spectrum.intOffset, spectrum.intLength, ints.data());
-
-          // std::transform(std::begin(ints),std::end(ints),std::begin(ints),[](auto & a){return std::log(a);});
-
-          if (ints.front() == 0)
-            ints[0] = ints[1];
-          if (ints.back() == 0)
-            ints.back() = *(ints.rbegin() + 1);
+        std::vector<IntensityType> normScratch;
+        typename m2::Signal::SpectrumProcessingPipeline<IntensityType>::Workspace workspace;
+        BinaryDataReader reader(source, readAheadLimit);
+        m2::SpectrumReadPlan plan;
 
-          // --------------------------------
+        // Spectra are read tile by tile in file order. A tile holds the spectra passed to the cache at once.
+        const unsigned int tileSize = cache ? cacheTileSize : b - a;
+        std::vector<IntensityType> cacheTile(cache ? std::size_t(cacheTileSize) * mzs.size() : 0);
 
-          if (!p->GetUseExternalNormalization())
+        for (unsigned int tileStart = a; tileStart < b; tileStart += tileSize)
+        {
+          const unsigned int tileEnd = std::min(b, tileStart + tileSize);
+          plan.Clear();
+          plan.Reserve(tileEnd - tileStart);
+          for (unsigned int i = tileStart; i < tileEnd; ++i)
+            plan.Add(i, spectra[i].GetIntOffset(), spectra[i].GetIntLength() * sizeof(IntensityType));
+          plan.Build();
+
+          const auto AddToCacheTile = [&](unsigned int i)
           {
-            // if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
-            //   spectrum.normalize = spectrum.normalize;
-            spectrum.normalizationFactor = GetNormalizationFactor(
-              normalizationStrategy, &mzs.front(), &mzs.back() + 1, &ints.front(), &ints.back() + 1);
-
-            if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
-              spectrum.normalizationFactor = spectrum.inFileNormalizationFactor;
+            std::copy(
+              std::begin(ints), std::end(ints), std::next(std::begin(cacheTile), (i - tileStart) * mzs.size()));
+          };
 
-            accNorm->SetPixelByIndex(spectrum.index + source.m_Offset,
-                                     spectrum.normalizationFactor); // Set normalization image pixel value
-          }
-          else
-          {
-            // Normalization-image content was set elsewhere
-            spectrum.normalizationFactor = accNorm->GetPixelByIndex(spectrum.index + source.m_Offset);
-          }
-          std::transform(std::begin(ints),
-                         std::end(ints),
-                         std::begin(ints),
-                         [&spectrum](const auto &a) { return a / spectrum.normalizationFactor; });
-
-          m_Smoother(std::begin(ints), std::end(ints));
-          m_BaselineSubstractor(std::begin(ints), std::end(ints), std::begin(baseline));
-          m_Transformer(std::begin(ints), std::end(ints));
-
-
-          std::transform(std::begin(ints), std::end(ints), sumT.at(t).begin(), sumT.at(t).begin(), plus);
-          std::transform(std::begin(ints), std::end(ints), skylineT.at(t).begin(), skylineT.at(t).begin(), Maximum);
+          reader.Read(
+            plan,
+            [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+            {
+              auto spectrum = spectra[request.spectrum];
+
+              // Read data from file ------------
+              std::memcpy(ints.data(), data, request.numberOfBytes);
+
+              if (cache && !cacheProcessedData)
+                AddToCacheTile(request.spectrum);
+
+              // std::transform(std::begin(ints),std::end(ints),std::begin(ints),[](auto & a){return std::log(a);});
+
+              if (ints.front() == 0)
+                ints[0] = ints[1];
+              if (ints.back() == 0)
+                ints.back() = *(ints.rbegin() + 1);
+
+              // --------------------------------
+
+              if (!p->GetUseExternalNormalization())
+              {
+                // if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
+                //   spectrum.normalize = spectrum.normalize;
+                // the median is computed in place and reorders its input
+                auto normInts = &ints;
+                if (normalizationStrategy == m2::NormalizationStrategyType::Median)
+                {
+                  normScratch.assign(std::begin(ints), std::end(ints));
+                  normInts = &normScratch;
+                }
+                const auto factor = GetNormalizationFactor(
+                  normalizationStrategy, &mzs.front(), &mzs.back() + 1, &normInts->front(), &normInts->back() + 1);
+                spectrum.SetNormalizationFactor(factor);
+
+                if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
+                  spectrum.SetNormalizationFactor(spectrum.GetInFileNormalizationFactor());
+
+                accNorm->SetPixelByIndex(spectrum.GetIndex() + source.m_Offset,
+                                         spectrum.GetNormalizationFactor()); // Set normalization image pixel value
+              }
+              else
+              {
+                // Normalization-image content was set elsewhere
+                spectrum.SetNormalizationFactor(accNorm->GetPixelByIndex(spectrum.GetIndex() + source.m_Offset));
+              }
+              snapshot->pipeline(ints.data(), ints.data() + ints.size(), spectrum.GetNormalizationFactor(), workspace);
+
+              if (cache && cacheProcessedData)
+                AddToCacheTile(request.spectrum);
+
+              std::transform(std::begin(ints), std::end(ints), sumT.at(t).begin(), sumT.at(t).begin(), plus);
+              std::transform(
+                std::begin(ints), std::end(ints), skylineT.at(t).begin(), skylineT.at(t).begin(), Maximum);
+            });
+
+          if (cache)
+            cache->Write(tileStart, tileEnd - tileStart, cacheTile.data());
         }
       });
+
+    if (cache)
+    {
+      try
+      {
+        cache->Finalize();
+      }
+      catch (mitk::Exception &e)
+      {
+        MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass())
+          << e.GetDescription() << " The transposed spectrum cache is not used.";
+        source.m_TransposedCache.reset();
+      }
+    }
   }
 
   auto &skyline = p->SkylineSpectrum();
@@ -735,6 +1781,8 @@ template <class MassAxisType, class IntensityType>
 void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeImageAccessContinuousCentroid()
 {
   const auto normalizationStrategy = p->GetNormalizationStrategy();
+  // memory for reading ahead is shared by all threads
+  const auto readAheadLimit = p->GetReadAheadMemoryLimit() / p->GetNumberOfThreads();
   auto accNorm = std::make_shared<mitk::ImagePixelWriteAccessor<m2::NormImagePixelType, 3>>(p->GetNormalizationImage());
 
   const auto &source = p->GetImzMLSpectrumImageSourceList().front();
@@ -742,10 +1790,10 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
 
   { // load continuous x axis
     const auto &spectra = source.m_Spectra;
-    mzs.resize(spectra[0].mzLength);
+    mzs.resize(spectra[0].GetMzLength());
 
-    std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
-    binaryDataToVector(f, spectra[0].mzOffset, spectra[0].mzLength, mzs.data());
+    BinaryDataReader reader(source);
+    reader.Read(spectra[0].GetMzOffset(), spectra[0].GetMzLength(), mzs.data());
 
     auto &massAxis = p->GetXAxis();
     massAxis.clear();
@@ -764,47 +1812,52 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
   {
     auto &spectra = source.m_Spectra;
 
-    m2::Process::Map(spectra.size(),
-                     p->GetNumberOfThreads(),
-                     [&](unsigned int t, unsigned int a, unsigned int b)
-                     {
-                       std::ifstream f;
-                       f.open(source.m_BinaryDataPath, std::ios::binary);
-
-                       std::vector<IntensityType> ints;
-                       auto iO = spectra[0].intOffset;
-                       auto iL = spectra[0].intLength;
-                       ints.resize(iL);
-
-                       for (unsigned i = a; i < b; i++)
-                       {
-                         auto &spectrum = spectra[i];
-                         iO = spectrum.intOffset;
-                         binaryDataToVector(f, iO, iL, ints.data());
-
-                         // Normalization
-                         if (!p->GetUseExternalNormalization())
-                         {
-                           spectrum.normalizationFactor = GetNormalizationFactor(
-                             normalizationStrategy, &mzs.front(), &mzs.back() + 1, &ints.front(), &ints.back() + 1);
-
-                           if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
-                             spectrum.normalizationFactor = spectrum.inFileNormalizationFactor;
-
-                           accNorm->SetPixelByIndex(spectrum.index, spectrum.normalizationFactor);
-
-                           std::transform(std::begin(ints),
-                                          std::end(ints),
-                                          std::begin(ints),
-                                          [&spectrum](auto &v) { return v / spectrum.normalizationFactor; });
-                         }
-
-                         for (size_t i = 0; i < mzs.size(); ++i)
-                           peaksT[t][i].Insert(i, mzs[i], ints[i]);
-                       }
-
-                       f.close();
-                     });
+    m2::Process::ParallelFor(spectra.size(),
+                             p->GetNumberOfThreads(),
+                             [&](unsigned int t, unsigned int a, unsigned int b)
+                             {
+                               BinaryDataReader reader(source, readAheadLimit);
+                               m2::SpectrumReadPlan plan;
+
+                               std::vector<IntensityType> ints;
+                               const auto iL = spectra[0].GetIntLength();
+                               ints.resize(iL);
+
+                               plan.Reserve(b - a);
+                               for (unsigned i = a; i < b; i++)
+                                 plan.Add(i, spectra[i].GetIntOffset(), iL * sizeof(IntensityType));
+                               plan.Build();
+
+                               const auto ProcessSpectrum =
+                                 [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+                               {
+                                 auto spectrum = spectra[request.spectrum];
+                                 std::memcpy(ints.data(), data, request.numberOfBytes);
+
+                                 // Normalization
+                                 if (!p->GetUseExternalNormalization())
+                                 {
+                                   const auto factor = GetNormalizationFactor(
+                                     normalizationStrategy, &mzs.front(), &mzs.back() + 1, &ints.front(), &ints.back() + 1);
+                                   spectrum.SetNormalizationFactor(factor);
+
+                                   if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
+                                     spectrum.SetNormalizationFactor(spectrum.GetInFileNormalizationFactor());
+
+                                   accNorm->SetPixelByIndex(spectrum.GetIndex(), spectrum.GetNormalizationFactor());
+
+                                   std::transform(std::begin(ints),
+                                                  std::end(ints),
+                                                  std::begin(ints),
+                                                  [&spectrum](auto &v)
+                                                  { return v / spectrum.GetNormalizationFactor(); });
+                                 }
+
+                                 for (size_t i = 0; i < mzs.size(); ++i)
+                                   peaksT[t][i].Insert(i, mzs[i], ints[i]);
+                               };
+                               reader.Read(plan, ProcessSpectrum);
+                             });
 
     auto &skyline = p->SkylineSpectrum();
     auto &sum = p->SumSpectrum();
@@ -853,30 +1906,33 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
     std::vector<std::vector<double>> xT(T, std::vector<double>(binsN, 0));
 
     const auto normalizationStrategy = p->GetNormalizationStrategy();
+    // memory for reading ahead is shared by all threads
+    const auto readAheadLimit = p->GetReadAheadMemoryLimit() / p->GetNumberOfThreads();
     auto accNorm =
       std::make_shared<mitk::ImagePixelWriteAccessor<m2::NormImagePixelType, 3>>(p->GetNormalizationImage());
 
     // MITK_INFO << spectra.size();
     // MAP
-    m2::Process::Map(spectra.size(),
-                     T,
-                     [&](unsigned int t, unsigned int a, unsigned int b)
-                     {
-                      std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
-                       std::vector<MassAxisType> mzs;
-                       std::list<m2::Peak> peaks, tempList;
-                       // find x min/max
-                       for (unsigned i = a; i < b; i++)
-                       {
-                         const auto &mzO = spectra[i].mzOffset;
-                         const auto &mzL = spectra[i].mzLength;
-                         mzs.resize(mzL);
-                         binaryDataToVector(f, mzO, mzL, mzs.data());
-                         xMin[t] = std::min(xMin[t], (double)mzs.front());
-                         xMax[t] = std::max(xMax[t], (double)mzs.back());
-                       }
-
-                     });
+    m2::Process::ParallelFor(spectra.size(),
+                             T,
+                             [&](unsigned int t, unsigned int a, unsigned int b)
+                             {
+                               BinaryDataReader reader(source);
+                               MassAxisType front, back;
+                               // find x min/max; the m/z axis is sorted, so only the first and last values are read
+                               for (unsigned i = a; i < b; i++)
+                               {
+                                 const auto mzO = spectra[i].GetMzOffset();
+                                 const auto mzL = spectra[i].GetMzLength();
+                                 if (mzL == 0)
+                                   continue;
+                                 reader.Read(mzO, 1, &front);
+                                 reader.Read(mzO + (mzL - 1) * sizeof(MassAxisType), 1, &back);
+                                 xMin[t] = std::min(xMin[t], (double)front);
+                                 xMax[t] = std::max(xMax[t], (double)back);
+                               }
+
+                             });
 
                        
     // find overall min/max
@@ -888,65 +1944,188 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::InitializeI
     min = *std::min_element(std::begin(xMin), std::end(xMin));
     binSize = (max - min) / double(binsN);
 
-  
-    m2::Process::Map(spectra.size(),
-                     T,
-                     [&](unsigned int t, unsigned int a, unsigned int b)
-                     {
-                       std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
-                       std::vector<MassAxisType> mzs;
-                       std::vector<IntensityType> ints;
-
-                       for (unsigned i = a; i < b; i++)
-                       {
-                         auto &spectrum = spectra[i];
-                         const auto &mzO = spectrum.mzOffset;
-                         const auto &mzL = spectrum.mzLength;
-                         mzs.resize(mzL);
-                         binaryDataToVector(f, mzO, mzL, mzs.data());
-
-                         const auto &intO = spectrum.intOffset;
-                         const auto &intL = spectrum.intLength;
-                         ints.resize(intL);
-                         binaryDataToVector(f, intO, intL, ints.data());
-
-                         // Normalization
-                         if (!p->GetUseExternalNormalization())
-                         {
-                           spectrum.normalizationFactor = GetNormalizationFactor(
-                             normalizationStrategy, &mzs.front(), &mzs.back() + 1, &ints.front(), &ints.back() + 1);
-
-                           if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
-                             spectrum.normalizationFactor = spectrum.inFileNormalizationFactor;
-
-                           accNorm->SetPixelByIndex(spectrum.index, spectrum.normalizationFactor);
-
-                           std::transform(std::begin(ints),
-                                          std::end(ints),
-                                          std::begin(ints),
-                                          [&spectrum](auto &v) { return v / spectrum.normalizationFactor; });
-                         }
-
-
-                         for (unsigned int k = 0; k < mzs.size(); ++k)
-                         {
-                           // find index of the bin for the k'th m/z value of the pixel
-                           auto j = (long)((mzs[k] - min) / binSize);
-
-                           if (j >= binsN)
-                             j = binsN - 1;
-                           else if (j < 0)
-                             j = 0;
-
-                           xT[t][j] += mzs[k];                                   // mass sum
-                           yT[t][j] += ints[k] < 10e-256 ? 0 : ints[k];              // intensitiy sum
-                           yMaxT[t][j] = std::max(yMaxT[t][j], double(ints[k])); // intensitiy max
-                           hT[t][j]++;                                           // hits
-                         }
-                       }
-
-                       f.close();
-                     });
+    // Inverted m/z index: entries per bin are counted for each chunk of spectra while reading the spectra and
+    // written to their slots in a second pass over the same chunks. The chunk counts are turned into the first
+    // slot of each chunk within each bin, so chunks write to disjoint slots and the entry order is deterministic.
+    source.m_InvertedMzIndex.reset();
+    const auto numberOfEntries = std::accumulate(std::begin(spectra),
+                                                 std::end(spectra),
+                                                 std::uint64_t(0),
+                                                 [](auto n, const auto &spectrum)
+                                                 { return n + spectrum.GetMzLength(); });
+    std::shared_ptr<m2::InvertedMzIndex> mzIndex;
+    std::vector<std::vector<std::uint64_t>> indexCounts;
+    unsigned int grainSize = 0; // default chunks without index
+    if (p->GetUseInvertedMzIndex())
+    {
+      if (m2::InvertedMzIndex::GetMemorySize(numberOfEntries) <= p->GetInvertedMzIndexMemoryLimit())
+      {
+        // ~64 entries per bin
+        const auto indexBinsN =
+          std::uint32_t(std::max<std::uint64_t>(1, std::min<std::uint64_t>(numberOfEntries / 64, 1 << 18)));
+        mzIndex = std::make_shared<m2::InvertedMzIndex>(min, max, indexBinsN);
+        // ~4 chunks per thread; one count per bin and chunk
+        const auto numberOfChunks = std::max<std::size_t>(1, std::min<std::size_t>(spectra.size(), 4 * T));
+        grainSize =
+          static_cast<unsigned int>(std::max<std::size_t>(1, (spectra.size() + numberOfChunks - 1) / numberOfChunks));
+        indexCounts.resize((spectra.size() + grainSize - 1) / grainSize, std::vector<std::uint64_t>(indexBinsN, 0));
+      }
+      else
+      {
+        MITK_WARN(m2::ImzMLSpectrumImage::GetStaticNameOfClass())
+          << "The inverted m/z index of " << source.m_BinaryDataPath << " would require "
+          << m2::InvertedMzIndex::GetMemorySize(numberOfEntries) << " bytes (limit "
+          << p->GetInvertedMzIndexMemoryLimit() << "); ion images are generated without index.";
+      }
+    }
+
+    m2::Process::ParallelFor(spectra.size(),
+                             T,
+                             [&](unsigned int t, unsigned int a, unsigned int b)
+                             {
+                               BinaryDataReader reader(source, readAheadLimit);
+                               m2::SpectrumReadPlan plan;
+                               std::vector<MassAxisType> mzs;
+                               std::vector<IntensityType> ints;
+                               std::vector<unsigned int> unplanned;
+
+                               // ints holds the intensities of spectrum i
+                               const auto ProcessSpectrum = [&](unsigned int i, m2::Span<const MassAxisType> mzView)
+                               {
+                                 auto spectrum = spectra[i];
+                                 if (mzIndex)
+                                   for (const auto &mz : mzView)
+                                     ++indexCounts[a / grainSize][mzIndex->GetBin(mz)];
+
+                                 // Normalization
+                                 if (!p->GetUseExternalNormalization())
+                                 {
+                                   const auto factor = GetNormalizationFactor(normalizationStrategy,
+                                                                              mzView.begin(),
+                                                                              mzView.end(),
+                                                                              &ints.front(),
+                                                                              &ints.back() + 1);
+                                   spectrum.SetNormalizationFactor(factor);
+
+                                   if (normalizationStrategy == m2::NormalizationStrategyType::InFile)
+                                     spectrum.SetNormalizationFactor(spectrum.GetInFileNormalizationFactor());
+
+                                   accNorm->SetPixelByIndex(spectrum.GetIndex(), spectrum.GetNormalizationFactor());
+
+                                   std::transform(std::begin(ints),
+                                                  std::end(ints),
+                                                  std::begin(ints),
+                                                  [&spectrum](auto &v)
+                                                  { return v / spectrum.GetNormalizationFactor(); });
+                                 }
+
+                                 for (unsigned int k = 0; k < mzView.size(); ++k)
+                                 {
+                                   // find index of the bin for the k'th m/z value of the pixel
+                                   auto j = (long)((mzView[k] - min) / binSize);
+
+                                   if (j >= binsN)
+                                     j = binsN - 1;
+                                   else if (j < 0)
+                                     j = 0;
+
+                                   xT[t][j] += mzView[k];                                // mass sum
+                                   yT[t][j] += ints[k] < 10e-256 ? 0 : ints[k];              // intensitiy sum
+                                   yMaxT[t][j] = std::max(yMaxT[t][j], double(ints[k])); // intensitiy max
+                                   hT[t][j]++;                                           // hits
+                                 }
+                               };
+
+                               // The m/z and intensity arrays of a spectrum are commonly stored back to back and
+                               // are read as one record. Spectra with distant arrays are read separately.
+                               plan.Reserve(b - a);
+                               for (unsigned i = a; i < b; i++)
+                               {
+                                 const auto spectrum = spectra[i];
+                                 const auto mzO = spectrum.GetMzOffset();
+                                 const auto intO = spectrum.GetIntOffset();
+                                 const auto mzBytes = spectrum.GetMzLength() * sizeof(MassAxisType);
+                                 const auto intBytes = spectrum.GetIntLength() * sizeof(IntensityType);
+                                 const auto first = std::min(mzO, intO);
+                                 const auto last = std::max(mzO + mzBytes, intO + intBytes);
+                                 if (last - first <= mzBytes + intBytes + m2::SpectrumReadPlan::DefaultMaxGap)
+                                   plan.Add(i, first, last - first);
+                                 else
+                                   unplanned.push_back(i);
+                               }
+
+                               const auto ProcessRecord =
+                                 [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+                               {
+                                 const auto spectrum = spectra[request.spectrum];
+                                 const auto mzData = data + (spectrum.GetMzOffset() - request.offset);
+                                 const auto intData = data + (spectrum.GetIntOffset() - request.offset);
+                                 ints.resize(spectrum.GetIntLength());
+                                 std::memcpy(ints.data(), intData, ints.size() * sizeof(IntensityType));
+                                 ProcessSpectrum(request.spectrum, AsSpan(mzData, spectrum.GetMzLength(), mzs));
+                               };
+                               plan.Build();
+                               reader.Read(plan, ProcessRecord);
+
+                               for (const auto i : unplanned)
+                               {
+                                 const auto spectrum = spectra[i];
+                                 mzs.resize(spectrum.GetMzLength());
+                                 reader.Read(spectrum.GetMzOffset(), spectrum.GetMzLength(), mzs.data());
+                                 ints.resize(spectrum.GetIntLength());
+                                 reader.Read(spectrum.GetIntOffset(), spectrum.GetIntLength(), ints.data());
+                                 ProcessSpectrum(i, m2::Span<const MassAxisType>(mzs.data(), mzs.size()));
+                               }
+                             },
+                             grainSize);
+
+    if (mzIndex)
+    {
+      std::vector<std::uint64_t> entriesPerBin(mzIndex->GetNumberOfBins(), 0);
+      for (const auto &counts : indexCounts)
+        std::transform(
+          std::begin(counts), std::end(counts), std::begin(entriesPerBin), std::begin(entriesPerBin), std::plus<>());
+
+      // counts of each chunk become the first slot of the chunk within each bin
+      const auto &binOffsets = mzIndex->Allocate(entriesPerBin);
+      for (std::uint32_t bin = 0; bin < mzIndex->GetNumberOfBins(); ++bin)
+      {
+        auto slot = binOffsets[bin];
+        for (auto &counts : indexCounts)
+          slot += std::exchange(counts[bin], slot);
+      }
+      auto &positions = indexCounts;
+
+      auto entries = mzIndex->GetWritableEntries();
+      m2::Process::ParallelFor(spectra.size(),
+                               T,
+                               [&](unsigned int /*t*/, unsigned int a, unsigned int b)
+                               {
+                                 BinaryDataReader reader(source, readAheadLimit);
+                                 m2::SpectrumReadPlan plan;
+                                 std::vector<MassAxisType> mzs;
+                                 auto &position = positions[a / grainSize];
+                                 plan.Reserve(b - a);
+                                 for (unsigned i = a; i < b; i++)
+                                 {
+                                   const auto spectrum = spectra[i];
+                                   plan.Add(i, spectrum.GetMzOffset(), spectrum.GetMzLength() * sizeof(MassAxisType));
+                                 }
+                                 plan.Build();
+
+                                 const auto AddEntries =
+                                   [&](const m2::SpectrumReadPlan::Request &request, const char *data)
+                                 {
+                                   const auto mzView =
+                                     AsSpan(data, request.numberOfBytes / sizeof(MassAxisType), mzs);
+                                   for (std::uint32_t k = 0; k < mzView.size(); ++k)
+                                     entries[position[mzIndex->GetBin(mzView[k])]++] = {request.spectrum, k};
+                                 };
+                                 reader.Read(plan, AddEntries);
+                               },
+                               grainSize);
+      source.m_InvertedMzIndex = mzIndex;
+    }
 
     // REDUCE
     for (unsigned int i = 1; i < T; ++i)
@@ -1014,32 +2193,112 @@ void m2::ImzMLSpectrumImage::GetIntensities(unsigned int id,
   m_Processor->GetYValues(id, ys, source);
 }
 
+void m2::ImzMLSpectrumImage::GetSpectrum(unsigned int id,
+                                         m2::Span<float> xs,
+                                         m2::Span<float> ys,
+                                         unsigned int source) const
+{
+  m_Processor->GetXValues(id, xs, source);
+  m_Processor->GetYValues(id, ys, source);
+}
+
+void m2::ImzMLSpectrumImage::GetIntensities(unsigned int id, m2::Span<float> ys, unsigned int source) const
+{
+  m_Processor->GetYValues(id, ys, source);
+}
+
+void m2::ImzMLSpectrumImage::PrefetchSpectra(unsigned int first, unsigned int count, unsigned int sourceId) const
+{
+  const auto &source = GetImzMLSpectrumImageSource(sourceId);
+  const auto last = std::min<std::size_t>(source.m_Spectra.size(), std::size_t(first) + count);
+  const auto mzBytes = m2::to_bytes(GetSpectrumType().XAxisType);
+  const auto intBytes = m2::to_bytes(GetSpectrumType().YAxisType);
+
+  m2::SpectrumReadPlan plan;
+  for (auto i = first; i < last; ++i)
+  {
+    const auto spectrum = source.m_Spectra[i];
+    plan.Add(i, spectrum.GetMzOffset(), spectrum.GetMzLength() * mzBytes);
+    plan.Add(i, spectrum.GetIntOffset(), spectrum.GetIntLength() * intBytes);
+  }
+  plan.Build();
+
+  if (source.m_BinaryDataMapping)
+    for (const auto &block : plan.GetBlocks())
+      source.m_BinaryDataMapping->WillNeed(block.offset, block.numberOfBytes);
+  else
+    m2::BinaryDataPrefetcher::WillNeed(source.m_BinaryDataPath, plan);
+}
+
+std::vector<unsigned int> m2::ImzMLSpectrumImage::GetNeighbourSpectra(unsigned int id, unsigned int sourceId)
+{
+  std::vector<unsigned int> neighbours;
+  auto indexImage = GetIndexImage();
+  if (!indexImage || sourceId >= m_SourcesList.size() || id >= m_SourcesList[sourceId].m_Spectra.size())
+    return neighbours;
+
+  const auto &source = m_SourcesList[sourceId];
+  const auto dims = indexImage->GetDimensions();
+  const auto center = source.m_Spectra[id].GetIndex() + source.m_Offset;
+  mitk::ImagePixelReadAccessor<m2::IndexImagePixelType, 3> acc(indexImage);
+  for (int dy = -1; dy <= 1; ++dy)
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+      auto index = center;
+      index[0] += dx;
+      index[1] += dy;
+      if ((dx == 0 && dy == 0) || index[0] < 0 || index[1] < 0 || index[0] >= itk::IndexValueType(dims[0]) ||
+          index[1] >= itk::IndexValueType(dims[1]))
+        continue;
+      // pixels without spectrum and pixels of other sources are not part of the neighbourhood
+      const auto n = acc.GetPixelByIndex(index);
+      if (n < source.m_Spectra.size() && source.m_Spectra[n].GetIndex() + source.m_Offset == index)
+        neighbours.push_back(n);
+    }
+  return neighbours;
+}
+
 template <class MassAxisType, class IntensityType>
 template <class OutputType>
 void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetXValues(unsigned int id,
                                                                                 std::vector<OutputType> &xd,
                                                                                 unsigned int sourceId)
+{
+  xd.resize(p->m_SourcesList[sourceId].m_Spectra[id].GetMzLength());
+  GetXValues<OutputType>(id, m2::Span<OutputType>(xd.data(), xd.size()), sourceId);
+}
+
+template <class MassAxisType, class IntensityType>
+template <class OutputType>
+void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetXValues(unsigned int id,
+                                                                                m2::Span<OutputType> xd,
+                                                                                unsigned int sourceId)
 {
   const auto &source = p->m_SourcesList[sourceId];
-  std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
+  BinaryDataReader reader(source);
 
-  const auto &spectrum = source.m_Spectra[id];
-  const auto &length = spectrum.mzLength;
-  const auto &offset = spectrum.mzOffset;
+  const auto spectrum = source.m_Spectra[id];
+  const auto length = spectrum.GetMzLength();
+  const auto offset = spectrum.GetMzOffset();
+  if (xd.size() < length)
+    mitkThrow() << "Output of size " << xd.size() << " can not hold the " << length << " x values of spectrum " << id;
 
   if (std::is_same<MassAxisType, OutputType>::value)
   {
-    xd.resize(length);
-    binaryDataToVector(f, offset, length, xd.data());
+    reader.Read(offset, length, xd.data());
   }
   else
   {
-    std::vector<MassAxisType> xs;
-    xs.resize(length);
-    binaryDataToVector(f, offset, length, xs.data());
+    // convert directly from the mapped file if possible
+    auto view = reader.GetSpan<MassAxisType>(offset, length);
+    if (view.empty())
+    {
+      auto &xs = ThreadLocalBuffer<MassAxisType>(length);
+      reader.Read(offset, length, xs.data());
+      view = m2::Span<const MassAxisType>(xs.data(), xs.size());
+    }
     // copy and convert
-    xd.resize(length);
-    std::copy(std::begin(xs), std::end(xs), std::begin(xd));
+    std::copy(std::begin(view), std::end(view), std::begin(xd));
   }
 }
 
@@ -1049,40 +2308,41 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetYValues(
                                                                                 std::vector<OutputType> &yd,
                                                                                 unsigned int sourceId)
 {
-  const auto &source = p->m_SourcesList[sourceId];
-  std::ifstream f(source.m_BinaryDataPath, std::ios::binary);
-
-  const auto &spectrum = source.m_Spectra[id];
-  const auto &length = spectrum.intLength;
-  const auto &offset = spectrum.intOffset;
-
-  mitk::ImagePixelReadAccessor<m2::NormImagePixelType, 3> normAccess(p->GetNormalizationImage());
+  yd.resize(p->m_SourcesList[sourceId].m_Spectra[id].GetIntLength());
+  GetYValues<OutputType>(id, m2::Span<OutputType>(yd.data(), yd.size()), sourceId);
+}
 
+template <class MassAxisType, class IntensityType>
+template <class OutputType>
+void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetYValues(unsigned int id,
+                                                                                m2::Span<OutputType> yd,
+                                                                                unsigned int sourceId)
+{
+  const auto &source = p->m_SourcesList[sourceId];
+  BinaryDataReader reader(source);
+
+  const auto spectrum = source.m_Spectra[id];
+  const auto length = spectrum.GetIntLength();
+  const auto offset = spectrum.GetIntOffset();
+  if (yd.size() < length)
+    mitkThrow() << "Output of size " << yd.size() << " can not hold the " << length << " y values of spectrum " << id;
+
+  // scratch buffers of this thread are reused
+  auto &ys = ThreadLocalBuffer<IntensityType, 0>(length);
+  reader.Read(offset, length, ys.data());
+  IntensityType norm = 1;
+  if (p->GetNormalizationStrategy() != m2::NormalizationStrategyType::None)
   {
-    std::vector<IntensityType> ys;
-    ys.resize(length);
-    binaryDataToVector(f, offset, length, ys.data());
-    if (p->GetNormalizationStrategy() != m2::NormalizationStrategyType::None)
-    { // check if it is not NormalizationStrategy::None.
-      IntensityType norm = normAccess.GetPixelByIndex(spectrum.index + source.m_Offset);
-      std::transform(std::begin(ys), std::end(ys), std::begin(ys), [&norm](auto &v) { return v / norm; });
-    }
-
-    // ----- Smoothing
-    m_Smoother(std::begin(ys), std::end(ys));
-
-    // ----- Baseline Substraction
-    std::vector<IntensityType> baseline(length);
-    m_BaselineSubstractor(std::begin(ys), std::end(ys), std::begin(baseline));
-
-    // ----- Intensity Transformation
-    m_Transformer(std::begin(ys), std::end(ys));
+    mitk::ImagePixelReadAccessor<m2::NormImagePixelType, 3> normAccess(p->GetNormalizationImage());
+    norm = normAccess.GetPixelByIndex(spectrum.GetIndex() + source.m_Offset);
+  }
 
-    // copy and convert
-    yd.resize(length);
-    std::copy(std::begin(ys), std::end(ys), std::begin(yd));
+  // ----- Normalization, smoothing, baseline substraction and intensity transformation
+  static thread_local typename m2::Signal::SpectrumProcessingPipeline<IntensityType>::Workspace workspace;
+  GetProcessingSnapshot()->pipeline(ys.data(), ys.data() + ys.size(), norm, workspace);
 
-  }
+  // copy and convert
+  std::copy(std::begin(ys), std::end(ys), std::begin(yd));
 }
 
 // template <class MassAxisType, class IntensityType>
@@ -1159,6 +2419,7 @@ void m2::ImzMLSpectrumImage::Processor<MassAxisType, IntensityType>::GetYValues(
 
 m2::ImzMLSpectrumImage::~ImzMLSpectrumImage()
 {
+  this->StopSpectrumPrefetch();
   // MITK_INFO(m2::ImzMLSpectrumImage::GetStaticNameOfClass()) << " destroyed!";
 }
 
@@ -0,0 +1,62 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2InvertedMzIndex.h>
+#include <mitkExceptionMacro.h>
+
+m2::InvertedMzIndex::InvertedMzIndex(double min, double max, std::uint32_t numberOfBins)
+  : m_Min(min), m_NumberOfBins(numberOfBins)
+{
+  if (numberOfBins == 0)
+    mitkThrow() << "The inverted m/z index requires at least one bin.";
+  if (!(max > min))
+    max = min + 1;
+  m_BinSize = (max - min) / numberOfBins;
+}
+
+const std::vector<std::uint64_t> &m2::InvertedMzIndex::Allocate(const std::vector<std::uint64_t> &entriesPerBin)
+{
+  if (entriesPerBin.size() != m_NumberOfBins)
+    mitkThrow() << "Expected entry counts for " << m_NumberOfBins << " bins, got " << entriesPerBin.size() << ".";
+
+  m_BinOffsets.assign(m_NumberOfBins + 1, 0);
+  for (std::uint32_t bin = 0; bin < m_NumberOfBins; ++bin)
+    m_BinOffsets[bin + 1] = m_BinOffsets[bin] + entriesPerBin[bin];
+
+  m_Entries.clear();
+  m_Entries.shrink_to_fit();
+  m_Entries.resize(m_BinOffsets.back());
+  return m_BinOffsets;
+}
+
+m2::InvertedMzIndex::Candidates m2::InvertedMzIndex::GetCandidates(double lower, double upper) const noexcept
+{
+  if (m_BinOffsets.empty() || upper < lower)
+    return {};
+  const auto Entries = [this](std::uint64_t first, std::uint64_t last)
+  { return Span<const Entry>(m_Entries.data() + first, last - first); };
+
+  const auto firstBin = GetBin(lower);
+  const auto lastBin = GetBin(upper);
+  Candidates candidates;
+  candidates.lowerBoundary = Entries(m_BinOffsets[firstBin], m_BinOffsets[firstBin + 1]);
+  if (lastBin > firstBin)
+  {
+    candidates.inner = Entries(m_BinOffsets[firstBin + 1], m_BinOffsets[lastBin]);
+    candidates.upperBoundary = Entries(m_BinOffsets[lastBin], m_BinOffsets[lastBin + 1]);
+  }
+  return candidates;
+}
@@ -0,0 +1,218 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <Poco/DeflatingStream.h>
+#include <Poco/InflatingStream.h>
+#include <algorithm>
+#include <m2IonImageCache.h>
+#include <mitkExceptionMacro.h>
+#include <sstream>
+
+bool m2::IonImageCache::Get(const Key &key, Span<double> image)
+{
+  std::shared_ptr<const std::string> data;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Invalidate(key.ProcessingHash);
+    auto it = m_Images.index.find(key);
+    if (it != m_Images.index.end())
+    {
+      const auto &values = it->second->values;
+      if (values.size() != image.size())
+        return false;
+      std::copy(values.begin(), values.end(), image.begin());
+      m_Images.entries.splice(m_Images.entries.begin(), m_Images.entries, it->second);
+      return true;
+    }
+
+    auto ct = m_CompressedImages.index.find(key);
+    if (ct == m_CompressedImages.index.end() || ct->second->numberOfValues != image.size())
+      return false;
+    data = ct->second->data;
+  }
+
+  // decompressed without holding the mutex and moved back to the uncompressed images
+  Decompress(*data, image);
+  Insert(key, Span<const double>(image.data(), image.size()));
+  return true;
+}
+
+bool m2::IonImageCache::Contains(const Key &key) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Images.index.count(key) || m_CompressedImages.index.count(key);
+}
+
+void m2::IonImageCache::Insert(const Key &key, Span<const double> image)
+{
+  std::vector<Entry> evicted;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Invalidate(key.ProcessingHash);
+    m_Images.Remove(key);
+    m_CompressedImages.Remove(key);
+
+    Entry entry{key, std::vector<double>(image.begin(), image.end())};
+    if (GetNumberOfBytes(entry) > m_MemoryLimit)
+      evicted.push_back(std::move(entry));
+    else
+    {
+      m_Images.PushFront(std::move(entry));
+      evicted = EvictUncompressed();
+    }
+  }
+  Retain(std::move(evicted));
+}
+
+void m2::IonImageCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Images.Clear();
+  m_CompressedImages.Clear();
+}
+
+void m2::IonImageCache::SetMemoryLimit(std::uint64_t bytes)
+{
+  std::vector<Entry> evicted;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MemoryLimit = bytes;
+    evicted = EvictUncompressed();
+  }
+  Retain(std::move(evicted));
+}
+
+std::uint64_t m2::IonImageCache::GetMemoryLimit() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_MemoryLimit;
+}
+
+void m2::IonImageCache::SetCompressedMemoryLimit(std::uint64_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_CompressedMemoryLimit = bytes;
+  while (m_CompressedImages.numberOfBytes > m_CompressedMemoryLimit)
+    m_CompressedImages.PopBack();
+}
+
+std::uint64_t m2::IonImageCache::GetCompressedMemoryLimit() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_CompressedMemoryLimit;
+}
+
+std::uint64_t m2::IonImageCache::GetNumberOfBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Images.numberOfBytes;
+}
+
+std::uint64_t m2::IonImageCache::GetNumberOfCompressedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_CompressedImages.numberOfBytes;
+}
+
+std::size_t m2::IonImageCache::GetNumberOfImages() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Images.entries.size();
+}
+
+std::size_t m2::IonImageCache::GetNumberOfCompressedImages() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_CompressedImages.entries.size();
+}
+
+void m2::IonImageCache::Invalidate(std::uint64_t processingHash)
+{
+  if (processingHash == m_ProcessingHash)
+    return;
+  m_Images.Clear();
+  m_CompressedImages.Clear();
+  m_ProcessingHash = processingHash;
+}
+
+std::vector<m2::IonImageCache::Entry> m2::IonImageCache::EvictUncompressed()
+{
+  std::vector<Entry> evicted;
+  while (m_Images.numberOfBytes > m_MemoryLimit)
+    evicted.push_back(m_Images.PopBack());
+  return evicted;
+}
+
+void m2::IonImageCache::Retain(std::vector<Entry> evicted)
+{
+  for (auto &entry : evicted)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      if (m_CompressedMemoryLimit == 0)
+        return;
+    }
+
+    CompressedEntry compressed{
+      entry.key, entry.values.size(), std::make_shared<const std::string>(Compress(entry.values))};
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    // skip images that were invalidated or added again in the meantime
+    if (entry.key.ProcessingHash != m_ProcessingHash || m_Images.index.count(entry.key) ||
+        m_CompressedImages.index.count(entry.key) || GetNumberOfBytes(compressed) > m_CompressedMemoryLimit)
+      continue;
+    m_CompressedImages.PushFront(std::move(compressed));
+    while (m_CompressedImages.numberOfBytes > m_CompressedMemoryLimit)
+      m_CompressedImages.PopBack();
+  }
+}
+
+std::string m2::IonImageCache::Compress(const std::vector<double> &values)
+{
+  // Byte planes are stored one after another: ion images are smooth and often zero outside of the tissue, so
+  // the high-order bytes of neighbouring pixels are similar and compress well.
+  const auto n = values.size();
+  const auto bytes = reinterpret_cast<const unsigned char *>(values.data());
+  std::string shuffled(n * sizeof(double), '\0');
+  for (std::size_t b = 0; b < sizeof(double); ++b)
+    for (std::size_t i = 0; i < n; ++i)
+      shuffled[b * n + i] = static_cast<char>(bytes[i * sizeof(double) + b]);
+
+  std::ostringstream ostr;
+  {
+    // level 1: compression runs on the interactive path
+    Poco::DeflatingOutputStream deflater(ostr, Poco::DeflatingStreamBuf::STREAM_ZLIB, 1);
+    deflater.write(shuffled.data(), shuffled.size());
+    deflater.close();
+  }
+  return ostr.str();
+}
+
+void m2::IonImageCache::Decompress(const std::string &data, Span<double> values)
+{
+  const auto n = values.size();
+  std::string shuffled(n * sizeof(double), '\0');
+  std::istringstream istr(data);
+  Poco::InflatingInputStream inflater(istr, Poco::InflatingStreamBuf::STREAM_ZLIB);
+  inflater.read(&shuffled[0], shuffled.size());
+  if (static_cast<std::size_t>(inflater.gcount()) != shuffled.size())
+    mitkThrow() << "Decompression of a cached ion image failed.";
+
+  auto bytes = reinterpret_cast<unsigned char *>(values.data());
+  for (std::size_t b = 0; b < sizeof(double); ++b)
+    for (std::size_t i = 0; i < n; ++i)
+      bytes[i * sizeof(double) + b] = static_cast<unsigned char>(shuffled[b * n + i]);
+}
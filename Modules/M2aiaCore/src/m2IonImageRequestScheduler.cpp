@@ -0,0 +1,175 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2IonImageRequestScheduler.h>
+#include <mbilog.h>
+#include <vector>
+
+m2::IonImageRequestScheduler::~IonImageRequestScheduler()
+{
+  // the threads are taken out of the slots under the lock; Submit and Remove move them as well
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto &kv : m_Slots)
+    {
+      kv.second.pending = nullptr;
+      kv.second.token.Cancel();
+      threads.push_back(std::move(kv.second.thread));
+    }
+  }
+  for (auto &thread : threads)
+    if (thread.joinable())
+      thread.join();
+}
+
+void m2::IonImageRequestScheduler::Submit(const void *key, Request request)
+{
+  std::thread finished;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto &slot = m_Slots[key];
+    slot.pending = std::move(request);
+    slot.token.Cancel();
+    if (!slot.running)
+    {
+      // the thread of the previous requests left its loop and only needs to be joined
+      finished = std::move(slot.thread);
+      slot.running = true;
+      slot.thread = std::thread(&IonImageRequestScheduler::Run, this, key);
+    }
+  }
+  if (finished.joinable())
+    finished.join();
+}
+
+void m2::IonImageRequestScheduler::Cancel(const void *key)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto it = m_Slots.find(key);
+  if (it == m_Slots.end())
+    return;
+  it->second.pending = nullptr;
+  it->second.token.Cancel();
+}
+
+void m2::IonImageRequestScheduler::CancelAll()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  for (auto &kv : m_Slots)
+  {
+    kv.second.pending = nullptr;
+    kv.second.token.Cancel();
+  }
+}
+
+void m2::IonImageRequestScheduler::Remove(const void *key)
+{
+  std::thread thread;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Slots.find(key);
+    if (it == m_Slots.end())
+      return;
+    it->second.pending = nullptr;
+    it->second.token.Cancel();
+    thread = std::move(it->second.thread);
+  }
+  if (thread.joinable())
+    thread.join();
+
+  {
+    // a request submitted meanwhile keeps the slot; its thread is joined if it returned already
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_Slots.find(key);
+    if (it == m_Slots.end() || it->second.running)
+      return;
+    thread = std::move(it->second.thread);
+    m_Slots.erase(it);
+  }
+  if (thread.joinable())
+    thread.join();
+}
+
+std::size_t m2::IonImageRequestScheduler::GetNumberOfKeys() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Slots.size();
+}
+
+void m2::IonImageRequestScheduler::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_Condition.wait(lock, [this] { return IsIdleLocked(); });
+}
+
+bool m2::IonImageRequestScheduler::IsIdle() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return IsIdleLocked();
+}
+
+bool m2::IonImageRequestScheduler::IsIdleLocked() const
+{
+  for (const auto &kv : m_Slots)
+    if (kv.second.running)
+      return false;
+  return true;
+}
+
+void m2::IonImageRequestScheduler::SetIdleCallback(std::function<void()> callback)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_IdleCallback = std::move(callback);
+}
+
+void m2::IonImageRequestScheduler::Run(const void *key)
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  auto &slot = m_Slots.at(key);
+  while (slot.pending)
+  {
+    auto request = std::move(slot.pending);
+    slot.pending = nullptr;
+    const auto token = slot.token = CancellationToken::Create();
+    lock.unlock();
+
+    try
+    {
+      request(token);
+    }
+    catch (m2::OperationCanceledException &)
+    {
+      // superseded by a later request
+    }
+    catch (std::exception &e)
+    {
+      MITK_ERROR("m2::IonImageRequestScheduler") << e.what();
+    }
+
+    request = nullptr; // release captured data before locking
+    lock.lock();
+  }
+  slot.running = false;
+  m_Condition.notify_all();
+
+  if (!m_IdleCallback || !IsIdleLocked())
+    return;
+  // the destructor and Remove join this thread, so the scheduler outlives the callback
+  const auto callback = m_IdleCallback;
+  lock.unlock();
+  callback();
+}
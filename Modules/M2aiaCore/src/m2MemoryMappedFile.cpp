@@ -0,0 +1,229 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cstring>
+#include <m2MemoryMappedFile.h>
+#include <mitkExceptionMacro.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+m2::MemoryMappedFile::MemoryMappedFile(const std::string &path)
+{
+  Open(path);
+}
+
+m2::MemoryMappedFile::~MemoryMappedFile()
+{
+  Close();
+}
+
+void m2::MemoryMappedFile::Open(const std::string &path)
+{
+  Close();
+  m_Path = path;
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    mitkThrow() << "Can not open file for memory mapping: " << path;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    mitkThrow() << "Can not determine the size of file: " << path;
+  }
+  m_FileHandle = file;
+  m_Size = static_cast<std::uint64_t>(size.QuadPart);
+  if (m_Size == 0)
+    return;
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping)
+  {
+    Close();
+    mitkThrow() << "Can not create file mapping: " << path;
+  }
+  m_MappingHandle = mapping;
+
+  auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data)
+  {
+    Close();
+    mitkThrow() << "Can not map view of file: " << path;
+  }
+  m_Data = static_cast<const char *>(data);
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    mitkThrow() << "Can not open file for memory mapping: " << path;
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0)
+  {
+    ::close(fd);
+    mitkThrow() << "Can not determine the size of file: " << path;
+  }
+  m_FileDescriptor = fd;
+  m_Size = static_cast<std::uint64_t>(info.st_size);
+  if (m_Size == 0)
+    return;
+
+  void *data = ::mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+  {
+    Close();
+    mitkThrow() << "Can not memory map file: " << path;
+  }
+  m_Data = static_cast<const char *>(data);
+#endif
+}
+
+void m2::MemoryMappedFile::Create(const std::string &path, std::uint64_t size)
+{
+  Close();
+  m_Path = path;
+  if (size == 0)
+    mitkThrow() << "Can not create an empty memory mapped file: " << path;
+
+#ifdef _WIN32
+  HANDLE file =
+    CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    mitkThrow() << "Can not create file for memory mapping: " << path;
+  m_FileHandle = file;
+
+  LARGE_INTEGER fileSize;
+  fileSize.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+  {
+    Close();
+    mitkThrow() << "Can not resize file to " << size << " bytes: " << path;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+  if (!mapping)
+  {
+    Close();
+    mitkThrow() << "Can not create file mapping: " << path;
+  }
+  m_MappingHandle = mapping;
+
+  auto data = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+  if (!data)
+  {
+    Close();
+    mitkThrow() << "Can not map view of file: " << path;
+  }
+#else
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    mitkThrow() << "Can not create file for memory mapping: " << path;
+  m_FileDescriptor = fd;
+
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    Close();
+    mitkThrow() << "Can not resize file to " << size << " bytes: " << path;
+  }
+
+  void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+  {
+    Close();
+    mitkThrow() << "Can not memory map file: " << path;
+  }
+#endif
+  m_Data = static_cast<const char *>(data);
+  m_Size = size;
+  m_Writable = true;
+}
+
+void m2::MemoryMappedFile::Flush()
+{
+  if (!m_Data || !m_Writable)
+    return;
+#ifdef _WIN32
+  if (!FlushViewOfFile(m_Data, 0) || !FlushFileBuffers(m_FileHandle))
+    mitkThrow() << "Can not flush memory mapped file: " << m_Path;
+#else
+  if (::msync(const_cast<char *>(m_Data), m_Size, MS_SYNC) != 0)
+    mitkThrow() << "Can not flush memory mapped file: " << m_Path;
+#endif
+}
+
+void m2::MemoryMappedFile::Close() noexcept
+{
+#ifdef _WIN32
+  if (m_Data)
+    UnmapViewOfFile(m_Data);
+  if (m_MappingHandle)
+    CloseHandle(m_MappingHandle);
+  if (m_FileHandle)
+    CloseHandle(m_FileHandle);
+  m_MappingHandle = nullptr;
+  m_FileHandle = nullptr;
+#else
+  if (m_Data)
+    ::munmap(const_cast<char *>(m_Data), m_Size);
+  if (m_FileDescriptor >= 0)
+    ::close(m_FileDescriptor);
+  m_FileDescriptor = -1;
+#endif
+  m_Data = nullptr;
+  m_Size = 0;
+  m_Writable = false;
+}
+
+void m2::MemoryMappedFile::WillNeed(std::uint64_t offset, std::uint64_t numberOfBytes) const noexcept
+{
+  if (!m_Data || !Contains(offset, numberOfBytes) || numberOfBytes == 0)
+    return;
+#ifdef _WIN32
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = const_cast<char *>(m_Data + offset);
+  range.NumberOfBytes = static_cast<SIZE_T>(numberOfBytes);
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+  // the advised range has to start at a page boundary
+  static const auto pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+  const auto first = offset - offset % pageSize;
+  ::posix_madvise(const_cast<char *>(m_Data + first), numberOfBytes + (offset - first), POSIX_MADV_WILLNEED);
+#endif
+}
+
+void m2::MemoryMappedFile::ReadBytes(std::uint64_t offset, std::uint64_t numberOfBytes, char *dst) const
+{
+  if (!Contains(offset, numberOfBytes) || (numberOfBytes && !m_Data))
+    mitkThrow() << "Read of " << numberOfBytes << " bytes at offset " << offset << " exceeds the mapped file "
+                << m_Path << " (" << m_Size << " bytes)";
+  std::memcpy(dst, m_Data + offset, numberOfBytes);
+}
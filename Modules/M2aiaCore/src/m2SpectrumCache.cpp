@@ -0,0 +1,114 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <m2SpectrumCache.h>
+
+m2::SpectrumCache::SpectrumPointer m2::SpectrumCache::Get(const Key &key)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Invalidate(key.ProcessingHash);
+  auto it = m_Index.find(key);
+  if (it == m_Index.end())
+    return nullptr;
+  m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+  return it->second->second;
+}
+
+bool m2::SpectrumCache::Contains(const Key &key) const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Index.find(key) != m_Index.end();
+}
+
+m2::SpectrumCache::SpectrumPointer m2::SpectrumCache::Insert(const Key &key, Spectrum spectrum)
+{
+  auto entry = std::make_shared<const Spectrum>(std::move(spectrum));
+  const auto numberOfBytes = GetNumberOfBytes(*entry);
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  Invalidate(key.ProcessingHash);
+  if (numberOfBytes > m_MemoryLimit)
+    return entry;
+
+  auto it = m_Index.find(key);
+  if (it != m_Index.end())
+  {
+    // replace a spectrum added concurrently
+    m_NumberOfBytes -= GetNumberOfBytes(*it->second->second);
+    m_Entries.erase(it->second);
+    m_Index.erase(it);
+  }
+
+  m_Entries.emplace_front(key, entry);
+  m_Index.emplace(key, m_Entries.begin());
+  m_NumberOfBytes += numberOfBytes;
+  Evict();
+  return entry;
+}
+
+void m2::SpectrumCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Entries.clear();
+  m_Index.clear();
+  m_NumberOfBytes = 0;
+}
+
+void m2::SpectrumCache::SetMemoryLimit(std::uint64_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_MemoryLimit = bytes;
+  Evict();
+}
+
+std::uint64_t m2::SpectrumCache::GetMemoryLimit() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_MemoryLimit;
+}
+
+std::uint64_t m2::SpectrumCache::GetNumberOfBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_NumberOfBytes;
+}
+
+std::size_t m2::SpectrumCache::GetNumberOfSpectra() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Entries.size();
+}
+
+void m2::SpectrumCache::Invalidate(std::uint64_t processingHash)
+{
+  if (processingHash == m_ProcessingHash)
+    return;
+  m_Entries.clear();
+  m_Index.clear();
+  m_NumberOfBytes = 0;
+  m_ProcessingHash = processingHash;
+}
+
+void m2::SpectrumCache::Evict()
+{
+  while (m_NumberOfBytes > m_MemoryLimit)
+  {
+    const auto &last = m_Entries.back();
+    m_NumberOfBytes -= GetNumberOfBytes(*last.second);
+    m_Index.erase(last.first);
+    m_Entries.pop_back();
+  }
+}
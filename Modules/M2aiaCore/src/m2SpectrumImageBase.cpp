@@ -16,9 +16,12 @@ See LICENSE.txt for details.
 #include <signal/m2PeakDetection.h>
 #include <m2SpectrumImageBase.h>
 #include <mitkDataNode.h>
+#include <mitkImagePixelReadAccessor.h>
+#include <mitkImagePixelWriteAccessor.h>
 #include <mitkLevelWindowProperty.h>
 #include <mitkLookupTableProperty.h>
 #include <mitkOperation.h>
+#include <mitkProperties.h>
 
 
 namespace m2{
@@ -151,5 +154,200 @@ void m2::SpectrumImageBase::GetImage(double, double, const mitk::Image *, mitk::
   MITK_WARN("SpectrumImageBase") << "Get image is not implemented in derived class!";
 }
 
-m2::SpectrumImageBase::~SpectrumImageBase() {}
+void m2::SpectrumImageBase::GetImage(double mz,
+                                     double tol,
+                                     const mitk::Image *mask,
+                                     mitk::Image *img,
+                                     const CancellationToken &,
+                                     const ImageRefinementCallback &) const
+{
+  GetImage(mz, tol, mask, img);
+}
+
+void m2::SpectrumImageBase::GetImages(const std::vector<IonImageRange> &ranges,
+                                      const mitk::Image *mask,
+                                      const std::vector<mitk::Image *> &images,
+                                      const CancellationToken &token) const
+{
+  if (ranges.size() != images.size())
+    mitkThrow() << "The number of ranges (" << ranges.size() << ") and output images (" << images.size()
+                << ") must be equal!";
+
+  for (size_t i = 0; i < ranges.size(); ++i)
+    GetImage(ranges[i].mz, ranges[i].tol, mask, images[i], token);
+}
+
+std::uint64_t m2::SpectrumImageBase::GetProcessingHash() const
+{
+  const std::uint64_t values[] = {static_cast<std::uint64_t>(GetNormalizationStrategy()),
+                                  static_cast<std::uint64_t>(GetSmoothingStrategy()),
+                                  GetSmoothingHalfWindowSize(),
+                                  static_cast<std::uint64_t>(GetBaselineCorrectionStrategy()),
+                                  GetBaseLineCorrectionHalfWindowSize(),
+                                  static_cast<std::uint64_t>(GetIntensityTransformationStrategy())};
+  // FNV-1a
+  std::uint64_t hash = 14695981039346656037ull;
+  for (auto v : values)
+  {
+    hash ^= v;
+    hash *= 1099511628211ull;
+  }
+  return hash ? hash : 1;
+}
+
+void m2::SpectrumImageBase::SetCurrentIonImageRange(double mz, double tol)
+{
+  SetProperty("x_range_center", mitk::DoubleProperty::New(mz));
+  SetProperty("x_range_tol", mitk::DoubleProperty::New(tol));
+  auto mdMz = itk::MetaDataObject<double>::New();
+  mdMz->SetMetaDataObjectValue(mz);
+  auto mdTol = itk::MetaDataObject<double>::New();
+  mdTol->SetMetaDataObjectValue(tol);
+  GetMetaDataDictionary()["x_range_center"] = mdMz;
+  GetMetaDataDictionary()["x_range_tol"] = mdTol;
+}
+
+m2::IonImageCache::Key m2::SpectrumImageBase::GetIonImageCacheKey(double mz,
+                                                                  double tol,
+                                                                  const mitk::Image *mask) const
+{
+  // a mask is identified by its address and modification time
+  std::uint64_t maskId = 0;
+  if (mask)
+    maskId = ((reinterpret_cast<std::uintptr_t>(mask) * 1099511628211ull) ^ mask->GetMTime()) | 1;
+  // the pooling strategy affects ion images only
+  auto processingHash = GetProcessingHash() ^ static_cast<std::uint64_t>(GetRangePoolingStrategy());
+  processingHash *= 1099511628211ull;
+  return {mz, tol, maskId, processingHash ? processingHash : 1};
+}
+
+void m2::SpectrumImageBase::GetCachedImage(double mz,
+                                           double tol,
+                                           const mitk::Image *mask,
+                                           mitk::Image *img,
+                                           const CancellationToken &token,
+                                           const ImageRefinementCallback &onRefinement)
+{
+  const auto key = GetIonImageCacheKey(mz, tol, mask);
+
+  const auto dims = img->GetDimensions();
+  const std::size_t numberOfPixels = std::size_t(dims[0]) * dims[1] * dims[2];
+  bool cached;
+  {
+    mitk::ImagePixelWriteAccessor<m2::DisplayImagePixelType, 3> acc(img);
+    cached = m_IonImageCache.Get(key, Span<double>(acc.GetData(), numberOfPixels));
+  }
+
+  if (cached)
+  {
+    img->Modified();
+    return;
+  }
+
+  GetImage(mz, tol, mask, img, token, onRefinement);
+  mitk::ImagePixelReadAccessor<m2::DisplayImagePixelType, 3> acc(img);
+  m_IonImageCache.Insert(key, Span<const double>(acc.GetData(), numberOfPixels));
+}
+
+void m2::SpectrumImageBase::PrefetchImages(const std::vector<IonImageRange> &ranges,
+                                           const mitk::Image *mask,
+                                           const CancellationToken &token)
+{
+  const auto dims = GetDimensions();
+  const std::size_t numberOfPixels = std::size_t(dims[0]) * dims[1] * dims[2];
+  const auto imageBytes = std::max<std::uint64_t>(numberOfPixels * sizeof(double), 1);
+  // the currently displayed image has to stay in the cache
+  const auto capacity = m_IonImageCache.GetMemoryLimit() / imageBytes;
+
+  std::vector<IonImageRange> missing;
+  std::vector<IonImageCache::Key> keys;
+  for (const auto &range : ranges)
+  {
+    if (missing.size() + 1 >= capacity)
+      break;
+    const auto key = GetIonImageCacheKey(range.mz, range.tol, mask);
+    if (m_IonImageCache.Contains(key))
+      continue;
+    missing.push_back(range);
+    keys.push_back(key);
+  }
+  if (missing.empty())
+    return;
+
+  std::vector<mitk::Image::Pointer> images;
+  std::vector<mitk::Image *> outputs;
+  for (size_t i = 0; i < missing.size(); ++i)
+  {
+    images.push_back(mitk::Image::New());
+    images.back()->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *GetGeometry()->Clone());
+    outputs.push_back(images.back());
+  }
+
+  // a single pass for all ranges (see GetImages)
+  GetImages(missing, mask, outputs, token);
+  for (size_t i = 0; i < images.size(); ++i)
+  {
+    mitk::ImagePixelReadAccessor<m2::DisplayImagePixelType, 3> acc(images[i]);
+    m_IonImageCache.Insert(keys[i], Span<const double>(acc.GetData(), numberOfPixels));
+  }
+}
+
+m2::SpectrumCache::SpectrumPointer m2::SpectrumImageBase::GetCachedSpectrum(unsigned int id, unsigned int source)
+{
+  const auto processingHash = GetProcessingHash();
+  auto Load = [this](const SpectrumCache::Key &key)
+  {
+    SpectrumCache::Spectrum spectrum;
+    GetXValues(key.Spectrum, spectrum.xs, key.Source);
+    GetYValues(key.Spectrum, spectrum.ys, key.Source);
+    // the strategies changed while loading, so the values may not belong to key
+    if (GetProcessingHash() != key.ProcessingHash)
+      return std::make_shared<const SpectrumCache::Spectrum>(std::move(spectrum));
+    return m_SpectrumCache.Insert(key, std::move(spectrum));
+  };
+
+  auto spectrum = m_SpectrumCache.Get({source, id, processingHash});
+  if (!spectrum)
+    spectrum = Load({source, id, processingHash});
+
+  // replaces the loading of the previous neighbourhood, which is cancelled but not waited for
+  const auto neighbours = GetNeighbourSpectra(id, source);
+  if (neighbours.empty())
+    m_SpectrumPrefetchScheduler.Cancel(this);
+  else
+    m_SpectrumPrefetchScheduler.Submit(this,
+                                       [this, Load, neighbours, source, processingHash](const CancellationToken &token)
+                                       {
+                                         for (auto n : neighbours)
+                                         {
+                                           token.ThrowIfCancelled();
+                                           const SpectrumCache::Key key{source, n, processingHash};
+                                           if (m_SpectrumCache.Contains(key))
+                                             continue;
+                                           try
+                                           {
+                                             Load(key);
+                                           }
+                                           catch (std::exception &e)
+                                           {
+                                             // prefetching is optional; the spectrum is loaded again on access
+                                             MITK_WARN(GetStaticNameOfClass()) << e.what();
+                                             return;
+                                           }
+                                         }
+                                       });
+  return spectrum;
+}
+
+void m2::SpectrumImageBase::StopSpectrumPrefetch()
+{
+  m_SpectrumPrefetchScheduler.Cancel(this);
+  m_SpectrumPrefetchScheduler.Wait();
+}
+
+m2::SpectrumImageBase::~SpectrumImageBase()
+{
+  StopSpectrumPrefetch();
+}
+
 m2::SpectrumImageBase::SpectrumImageBase() : mitk::Image() {}
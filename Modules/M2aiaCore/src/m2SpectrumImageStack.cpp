@@ -244,6 +244,7 @@ namespace m2
         auto imageTemp = mitk::Image::New();
         imageTemp->Initialize(spectrumImage);
         spectrumImage->GetImage(center, tol, spectrumImage->GetMaskImage(), imageTemp);
+        spectrumImage->SetCurrentIonImageRange(center, tol);
         if (!transformer->GetTransformation().empty())
         {
           imageTemp = transformer->WarpImage(imageTemp);
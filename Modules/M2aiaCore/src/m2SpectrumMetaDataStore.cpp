@@ -0,0 +1,178 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <limits>
+#include <m2SpectrumMetaDataStore.h>
+#include <mitkExceptionMacro.h>
+
+namespace
+{
+  /**
+   * @brief Converts an index value to the type of its column. Throws mitk::Exception if it is out of range.
+   */
+  template <class T>
+  T ToIndexColumnValue(unsigned int dim, m2::SpectrumMetaDataStore::IndexType::IndexValueType value)
+  {
+    if (value < 0 || static_cast<std::uint64_t>(value) > std::numeric_limits<T>::max())
+      mitkThrow() << "Index " << value << " of dimension " << dim << " is out of range [0, "
+                  << std::numeric_limits<T>::max() << "].";
+    return static_cast<T>(value);
+  }
+
+  template <class T>
+  void AppendColumn(std::vector<T> &dst, std::vector<T> &&src)
+  {
+    if (dst.empty())
+      dst = std::move(src);
+    else
+      std::move(std::begin(src), std::end(src), std::back_inserter(dst));
+  }
+
+  /**
+   * @brief Appends an optional column. If only one of both columns is allocated, the other part is filled with value.
+   */
+  template <class T>
+  void AppendOptionalColumn(std::vector<T> &dst, std::size_t dstSize, std::vector<T> &&src, std::size_t srcSize, T value)
+  {
+    if (dst.empty() && src.empty())
+      return;
+    dst.resize(dstSize, value);
+    if (src.empty())
+      dst.resize(dstSize + srcSize, value);
+    else
+      AppendColumn(dst, std::move(src));
+  }
+} // namespace
+
+m2::PeakMatrix::Row m2::SpectrumMetaDataStore::ConstView::GetPeaks() const noexcept
+{
+  return m_Store->HasPeaks() ? m_Store->m_Peaks[m_Id] : PeakMatrix::Row();
+}
+
+void m2::SpectrumMetaDataStore::View::SetIndex(unsigned int dim, IndexType::IndexValueType value) const
+{
+  switch (dim)
+  {
+    case 0:
+      m_WritableStore->m_IndexX[m_Id] = ToIndexColumnValue<std::uint32_t>(dim, value);
+      break;
+    case 1:
+      m_WritableStore->m_IndexY[m_Id] = ToIndexColumnValue<std::uint32_t>(dim, value);
+      break;
+    case 2:
+      m_WritableStore->m_IndexZ[m_Id] = ToIndexColumnValue<std::uint16_t>(dim, value);
+      break;
+    default:
+      mitkThrow() << "Invalid index dimension " << dim << ".";
+  }
+}
+
+void m2::SpectrumMetaDataStore::View::SetWorld(const WorldCoordinates &world) const
+{
+  auto &column = m_WritableStore->m_World;
+  if (column.empty())
+    column.resize(m_WritableStore->size(), WorldCoordinates{0, 0, 0});
+  column[m_Id] = world;
+}
+
+void m2::SpectrumMetaDataStore::View::SetInFileNormalizationFactor(NormImagePixelType factor) const
+{
+  auto &column = m_WritableStore->m_InFileNormalizationFactors;
+  if (column.empty())
+    column.resize(m_WritableStore->size(), 1.0);
+  column[m_Id] = factor;
+}
+
+void m2::SpectrumMetaDataStore::resize(std::size_t numberOfSpectra)
+{
+  m_MzOffsets.resize(numberOfSpectra, 0);
+  m_IntOffsets.resize(numberOfSpectra, 0);
+  m_MzLengths.resize(numberOfSpectra, 0);
+  m_IntLengths.resize(numberOfSpectra, 0);
+  m_IndexX.resize(numberOfSpectra, 0);
+  m_IndexY.resize(numberOfSpectra, 0);
+  m_IndexZ.resize(numberOfSpectra, 0);
+  m_NormalizationFactors.resize(numberOfSpectra, 1.0);
+  if (!m_World.empty())
+    m_World.resize(numberOfSpectra, WorldCoordinates{0, 0, 0});
+  if (!m_InFileNormalizationFactors.empty())
+    m_InFileNormalizationFactors.resize(numberOfSpectra, 1.0);
+  if (HasPeaks())
+    m_Peaks.Resize(numberOfSpectra);
+}
+
+void m2::SpectrumMetaDataStore::reserve(std::size_t numberOfSpectra)
+{
+  m_MzOffsets.reserve(numberOfSpectra);
+  m_IntOffsets.reserve(numberOfSpectra);
+  m_MzLengths.reserve(numberOfSpectra);
+  m_IntLengths.reserve(numberOfSpectra);
+  m_IndexX.reserve(numberOfSpectra);
+  m_IndexY.reserve(numberOfSpectra);
+  m_IndexZ.reserve(numberOfSpectra);
+  m_NormalizationFactors.reserve(numberOfSpectra);
+}
+
+void m2::SpectrumMetaDataStore::clear() noexcept
+{
+  *this = SpectrumMetaDataStore();
+}
+
+m2::SpectrumMetaDataStore::View m2::SpectrumMetaDataStore::AddSpectrum()
+{
+  resize(size() + 1);
+  return View(this, size() - 1);
+}
+
+void m2::SpectrumMetaDataStore::Append(SpectrumMetaDataStore &&other)
+{
+  const auto n = size();
+  const auto m = other.size();
+  AppendOptionalColumn(m_World, n, std::move(other.m_World), m, WorldCoordinates{0, 0, 0});
+  AppendOptionalColumn(m_InFileNormalizationFactors, n, std::move(other.m_InFileNormalizationFactors), m, 1.0);
+  if (HasPeaks() || other.HasPeaks())
+  {
+    m_Peaks.Resize(n);
+    other.m_Peaks.Resize(m);
+    m_Peaks.Append(std::move(other.m_Peaks));
+  }
+  AppendColumn(m_MzOffsets, std::move(other.m_MzOffsets));
+  AppendColumn(m_IntOffsets, std::move(other.m_IntOffsets));
+  AppendColumn(m_MzLengths, std::move(other.m_MzLengths));
+  AppendColumn(m_IntLengths, std::move(other.m_IntLengths));
+  AppendColumn(m_IndexX, std::move(other.m_IndexX));
+  AppendColumn(m_IndexY, std::move(other.m_IndexY));
+  AppendColumn(m_IndexZ, std::move(other.m_IndexZ));
+  AppendColumn(m_NormalizationFactors, std::move(other.m_NormalizationFactors));
+  other.clear();
+}
+
+void m2::SpectrumMetaDataStore::SetPeaks(PeakMatrix peaks)
+{
+  if (peaks.GetNumberOfRows() != size())
+    mitkThrow() << "The peak matrix has " << peaks.GetNumberOfRows() << " rows, but the store holds " << size()
+                << " spectra.";
+  m_Peaks = std::move(peaks);
+}
+
+std::size_t m2::SpectrumMetaDataStore::GetMemorySize() const noexcept
+{
+  return size() * (2 * sizeof(OffsetType) + 2 * sizeof(LengthType) + 2 * sizeof(std::uint32_t) +
+                   sizeof(std::uint16_t) + sizeof(NormImagePixelType)) +
+         m_World.size() * sizeof(WorldCoordinates) + m_InFileNormalizationFactors.size() * sizeof(NormImagePixelType) +
+         m_Peaks.GetMemorySize();
+}
@@ -0,0 +1,62 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <m2SpectrumReadPlan.h>
+
+void m2::SpectrumReadPlan::Clear() noexcept
+{
+  m_Requests.clear();
+  m_Blocks.clear();
+}
+
+void m2::SpectrumReadPlan::Reserve(std::size_t numberOfRequests)
+{
+  m_Requests.reserve(numberOfRequests);
+}
+
+void m2::SpectrumReadPlan::Add(std::uint32_t spectrum, std::uint64_t offset, std::uint64_t numberOfBytes)
+{
+  m_Requests.push_back({spectrum, offset, numberOfBytes});
+}
+
+void m2::SpectrumReadPlan::Build(std::uint64_t maxGap, std::uint64_t maxBlockSize)
+{
+  m_Blocks.clear();
+  // stable: requests of equal offsets keep the order in which they were added
+  std::stable_sort(std::begin(m_Requests),
+                   std::end(m_Requests),
+                   [](const Request &a, const Request &b) { return a.offset < b.offset; });
+
+  for (std::size_t i = 0; i < m_Requests.size(); ++i)
+  {
+    const auto &request = m_Requests[i];
+    const auto end = request.offset + request.numberOfBytes;
+    if (!m_Blocks.empty())
+    {
+      auto &block = m_Blocks.back();
+      const auto blockEnd = block.offset + block.numberOfBytes;
+      const auto mergedEnd = std::max(blockEnd, end);
+      if (request.offset <= blockEnd + maxGap && mergedEnd - block.offset <= maxBlockSize)
+      {
+        block.numberOfBytes = mergedEnd - block.offset;
+        block.lastRequest = i + 1;
+        continue;
+      }
+    }
+    m_Blocks.push_back({request.offset, request.numberOfBytes, i, i + 1});
+  }
+}
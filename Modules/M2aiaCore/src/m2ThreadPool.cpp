@@ -0,0 +1,145 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <m2ThreadPool.h>
+
+struct m2::ThreadPool::Job
+{
+  const std::function<void(unsigned int)> *task;
+  unsigned int numberOfLanes;
+  std::atomic<unsigned int> nextLane{0};
+  std::atomic<unsigned int> pendingLanes;
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::exception_ptr exception;
+};
+
+m2::ThreadPool &m2::ThreadPool::GetInstance()
+{
+  // The caller takes part in every job, so one worker less than available cores is started.
+  // The pool is never destroyed: joining threads during static destruction (e.g. on module unload) may dead-lock.
+  static auto *instance = new ThreadPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return *instance;
+}
+
+m2::ThreadPool::ThreadPool(unsigned int numberOfWorkers)
+{
+  for (unsigned int i = 0; i < numberOfWorkers; ++i)
+    m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+m2::ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_Condition.notify_all();
+  for (auto &worker : m_Workers)
+    worker.join();
+}
+
+void m2::ThreadPool::Run(unsigned int numberOfLanes, const std::function<void(unsigned int lane)> &task)
+{
+  if (numberOfLanes == 0)
+    return;
+
+  auto job = std::make_shared<Job>();
+  job->task = &task;
+  job->numberOfLanes = numberOfLanes;
+  job->pendingLanes = numberOfLanes;
+
+  if (numberOfLanes > 1 && !m_Workers.empty())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Jobs.push_back(job);
+    }
+    if (numberOfLanes - 1 < m_Workers.size())
+      for (unsigned int i = 1; i < numberOfLanes; ++i)
+        m_Condition.notify_one();
+    else
+      m_Condition.notify_all();
+  }
+
+  Execute(*job);
+
+  {
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job] { return job->pendingLanes == 0; });
+  }
+
+  // remove the job if no worker did so far
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = std::find(std::begin(m_Jobs), std::end(m_Jobs), job);
+    if (it != std::end(m_Jobs))
+      m_Jobs.erase(it);
+  }
+
+  if (job->exception)
+    std::rethrow_exception(job->exception);
+}
+
+void m2::ThreadPool::Execute(Job &job)
+{
+  for (unsigned int lane = job.nextLane++; lane < job.numberOfLanes; lane = job.nextLane++)
+  {
+    try
+    {
+      (*job.task)(lane);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      if (!job.exception)
+        job.exception = std::current_exception();
+    }
+
+    if (--job.pendingLanes == 0)
+    {
+      std::lock_guard<std::mutex> lock(job.mutex);
+      job.finished.notify_all();
+    }
+  }
+}
+
+void m2::ThreadPool::WorkerLoop()
+{
+  while (true)
+  {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Condition.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+      if (m_Stop)
+        return;
+
+      // jobs without unclaimed lanes are dropped from the queue
+      job = m_Jobs.front();
+      if (job->nextLane >= job->numberOfLanes)
+      {
+        m_Jobs.pop_front();
+        continue;
+      }
+    }
+    Execute(*job);
+  }
+}
@@ -0,0 +1,165 @@
+/*===================================================================
+
+MSI applications for interactive analysis in MITK (M2aia)
+
+Copyright (c) Jonas Cordes
+
+All rights reserved.
+
+This software is distributed WITHOUT ANY WARRANTY; without
+even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE.
+
+See LICENSE.txt for details.
+
+===================================================================*/
+
+#include <cstddef>
+#include <cstring>
+#include <itksys/SystemTools.hxx>
+#include <m2TransposedSpectrumCache.h>
+#include <mitkExceptionMacro.h>
+
+namespace
+{
+  constexpr char Magic[8] = {'M', '2', 'A', 'I', 'A', 'T', 'C', '\0'};
+  constexpr std::uint32_t Version = 2;
+
+  // values start page aligned behind the header
+  constexpr std::uint64_t DataOffset = 4096;
+
+  struct FileHeader
+  {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t complete;
+    std::uint64_t numberOfPixels;
+    std::uint64_t numberOfBins;
+    std::uint64_t sourceFileSize;
+    std::int64_t sourceModificationTime;
+    std::uint64_t processingHash;
+    std::uint64_t valueSize;
+  };
+
+  std::uint64_t FileSize(const m2::TransposedSpectrumCache::Key &key)
+  {
+    return DataOffset + key.NumberOfPixels * key.NumberOfBins * key.ValueSize;
+  }
+} // namespace
+
+bool m2::TransposedSpectrumCache::Key::operator==(const Key &other) const noexcept
+{
+  return NumberOfPixels == other.NumberOfPixels && NumberOfBins == other.NumberOfBins &&
+         SourceFileSize == other.SourceFileSize && SourceModificationTime == other.SourceModificationTime &&
+         ProcessingHash == other.ProcessingHash && ValueSize == other.ValueSize;
+}
+
+m2::TransposedSpectrumCache::Key m2::TransposedSpectrumCache::MakeKey(const std::string &binaryDataPath,
+                                                                      std::uint64_t numberOfPixels,
+                                                                      std::uint64_t numberOfBins,
+                                                                      std::uint64_t processingHash,
+                                                                      std::uint64_t valueSize)
+{
+  Key key;
+  key.NumberOfPixels = numberOfPixels;
+  key.NumberOfBins = numberOfBins;
+  key.SourceFileSize = itksys::SystemTools::FileLength(binaryDataPath);
+  key.SourceModificationTime = itksys::SystemTools::ModifiedTime(binaryDataPath);
+  key.ProcessingHash = processingHash;
+  key.ValueSize = valueSize;
+  return key;
+}
+
+std::shared_ptr<m2::TransposedSpectrumCache> m2::TransposedSpectrumCache::Open(const std::string &path,
+                                                                                const Key &key)
+{
+  if (!itksys::SystemTools::FileExists(path, true))
+    return nullptr;
+
+  std::shared_ptr<TransposedSpectrumCache> cache(new TransposedSpectrumCache());
+  try
+  {
+    cache->m_File.Open(path);
+  }
+  catch (mitk::Exception &)
+  {
+    return nullptr;
+  }
+
+  FileHeader header;
+  if (cache->m_File.GetSize() != FileSize(key))
+    return nullptr;
+  cache->m_File.Read(0, 1, &header);
+
+  Key fileKey;
+  fileKey.NumberOfPixels = header.numberOfPixels;
+  fileKey.NumberOfBins = header.numberOfBins;
+  fileKey.SourceFileSize = header.sourceFileSize;
+  fileKey.SourceModificationTime = header.sourceModificationTime;
+  fileKey.ProcessingHash = header.processingHash;
+  fileKey.ValueSize = header.valueSize;
+
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.complete != 1 ||
+      fileKey != key)
+    return nullptr;
+
+  cache->m_Key = key;
+  cache->m_Values = cache->m_File.GetData() + DataOffset;
+  cache->m_Complete = true;
+  return cache;
+}
+
+std::shared_ptr<m2::TransposedSpectrumCache> m2::TransposedSpectrumCache::Create(const std::string &path,
+                                                                                  const Key &key)
+{
+  std::shared_ptr<TransposedSpectrumCache> cache(new TransposedSpectrumCache());
+  cache->m_File.Create(path, FileSize(key));
+  cache->m_Key = key;
+
+  FileHeader header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = Version;
+  header.complete = 0;
+  header.numberOfPixels = key.NumberOfPixels;
+  header.numberOfBins = key.NumberOfBins;
+  header.sourceFileSize = key.SourceFileSize;
+  header.sourceModificationTime = key.SourceModificationTime;
+  header.processingHash = key.ProcessingHash;
+  header.valueSize = key.ValueSize;
+  std::memcpy(cache->m_File.GetWritableData(), &header, sizeof(header));
+
+  cache->m_Values = cache->m_File.GetData() + DataOffset;
+  return cache;
+}
+
+char *m2::TransposedSpectrumCache::GetWritableValues(std::uint64_t firstPixel,
+                                                     std::uint64_t numberOfPixels,
+                                                     std::uint64_t valueSize)
+{
+  if (m_Complete)
+    mitkThrow() << "The transposed spectrum cache " << m_File.GetPath() << " is read-only.";
+  if (valueSize != m_Key.ValueSize)
+    mitkThrow() << "Values of " << valueSize << " bytes can not be written to the transposed spectrum cache "
+                << m_File.GetPath() << " holding values of " << m_Key.ValueSize << " bytes.";
+  if (firstPixel + numberOfPixels > m_Key.NumberOfPixels)
+    mitkThrow() << "Pixel range [" << firstPixel << ", " << firstPixel + numberOfPixels
+                << ") exceeds the transposed spectrum cache with " << m_Key.NumberOfPixels << " pixels.";
+  return m_File.GetWritableData() + DataOffset;
+}
+
+void m2::TransposedSpectrumCache::Finalize()
+{
+  if (m_Complete)
+    return;
+
+  m_File.Flush();
+  const std::uint32_t complete = 1;
+  std::memcpy(m_File.GetWritableData() + offsetof(FileHeader, complete), &complete, sizeof(complete));
+  m_File.Flush();
+
+  // reopen read-only
+  const auto path = m_File.GetPath();
+  m_File.Open(path);
+  m_Values = m_File.GetData() + DataOffset;
+  m_Complete = true;
+}
@@ -134,20 +134,11 @@ void BiomarkerRoc::DoRocAnalysisWithThresholds()
   m_Image->Initialize(originalImage);
   mitk::ImageReadAccessor readAccessorMask(mask);
   m_MaskData = static_cast<const mitk::Label::PixelType *>(readAccessorMask.GetData());
-  auto peaks = originalImage->GetPeaks();
 
   //m_timer.storage = 0;
-  for (auto& peak : peaks)
+  ForEachPeakIonImage(originalImage, mask, [&](double mz)
   {
     //m_timer.start();
-    //prepare state for PrepareTumorVectors
-    double mz = peak.GetX();
-    originalImage->GetImage(mz, m_Tolerance, mask, m_Image);
-    mitk::ImageReadAccessor imagereader(m_Image);
-    auto dims = m_Image->GetDimensions();
-    m_ImageDataSize = dims[0] * dims[1] * dims[2];
-    m_ImageData = static_cast<const double*>(imagereader.GetData());
-
     auto [A, B, P, N] = PrepareTumorVectors();
     
     std::array<double, m_numThresholds> thresholds;
@@ -187,11 +178,46 @@ void BiomarkerRoc::DoRocAnalysisWithThresholds()
     double auc = m2::BiomarkerIdentificationAlgorithms::AucTrapezoid(TPR.begin(), TPR.end(), FPR.begin());
     AddToTable(mz, auc);
     //m_timer.storage += m_timer.getDuration();
-  }
+  });
   //MITK_INFO << ROC_SIG << "Dauer: " << m_timer.storage << " µs (" << m_timer.storage / 1000.0 << ") ms. " << m_timer.num_measurements << " Messungen durchgeführt.";
   m_Controls.tableWidget->setVisible(true);
 }
 
+void BiomarkerRoc::ForEachPeakIonImage(m2::ImzMLSpectrumImage *image,
+                                       mitk::Image *mask,
+                                       const std::function<void(double)> &fn)
+{
+  // Ion images are generated batch-wise, each batch in a single pass over the spectra.
+  constexpr size_t batchSize = 64;
+  const auto peaks = image->GetPeaks();
+  for (size_t batchStart = 0; batchStart < peaks.size(); batchStart += batchSize)
+  {
+    const auto batchEnd = std::min(peaks.size(), batchStart + batchSize);
+    std::vector<mitk::Image::Pointer> ionImages;
+    std::vector<mitk::Image *> outputs;
+    std::vector<m2::IonImageRange> ranges;
+    for (size_t i = batchStart; i < batchEnd; ++i)
+    {
+      ionImages.push_back(mitk::Image::New());
+      ionImages.back()->Initialize(image);
+      outputs.push_back(ionImages.back());
+      ranges.push_back({peaks[i].GetX(), m_Tolerance});
+    }
+    image->GetImages(ranges, mask, outputs);
+
+    for (size_t i = batchStart; i < batchEnd; ++i)
+    {
+      //prepare state for PrepareTumorVectors/GetLabeledMz
+      m_Image = ionImages[i - batchStart];
+      mitk::ImageReadAccessor imagereader(m_Image);
+      auto dims = m_Image->GetDimensions();
+      m_ImageDataSize = dims[0] * dims[1] * dims[2];
+      m_ImageData = static_cast<const double*>(imagereader.GetData());
+      fn(peaks[i].GetX());
+    }
+  }
+}
+
 void BiomarkerRoc::DoRocAnalysisMannWhitneyU()
 {
   // initialize
@@ -205,25 +231,16 @@ void BiomarkerRoc::DoRocAnalysisMannWhitneyU()
   m_Image->Initialize(originalImage);
   mitk::ImageReadAccessor readAccessorMask(mask);
   m_MaskData = static_cast<const mitk::Label::PixelType *>(readAccessorMask.GetData());
-  auto peaks = originalImage->GetPeaks();
-  for (auto& peak : peaks)
+  ForEachPeakIonImage(originalImage, mask, [&](double mz)
   {
     //m_timer.start();
-    //prepare state for GetLabeledMz
-    double mz = peak.GetX();
-    originalImage->GetImage(mz, m_Tolerance, mask, m_Image);
-    mitk::ImageReadAccessor imagereader(m_Image);
-    auto dims = m_Image->GetDimensions();
-    m_ImageDataSize = dims[0] * dims[1] * dims[2];
-    m_ImageData = static_cast<const double*>(imagereader.GetData());
-
     auto [D, P, N] = GetLabeledMz();
     
     //ROC has finished already here, this is merely calculating the AUC
     double auc = m2::BiomarkerIdentificationAlgorithms::MannWhitneyU(D.begin(), D.end(), P, N);
     AddToTable(mz, auc);
     //m_timer.storage += m_timer.getDuration();
-  }
+  });
   m_Controls.tableWidget->setVisible(true);
   //MITK_INFO << ROC_SIG << "Dauer: " << m_timer.storage << " µs (" << m_timer.storage / 1000.0 << ") ms. " << m_timer.num_measurements << " Messungen durchgeführt.";
 }
@@ -24,6 +24,7 @@ See LICENSE.txt for details.
 #include <mitkLabelSetImage.h>
 
 #include <chrono>
+#include <functional>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -57,6 +58,11 @@ private:
 };
 */
 
+namespace m2
+{
+  class ImzMLSpectrumImage;
+}
+
 QT_CHARTS_USE_NAMESPACE
 /**
   \brief BiomarkerRoc
@@ -83,6 +89,8 @@ protected:
 private:
   void DoRocAnalysisMannWhitneyU();
   void DoRocAnalysisWithThresholds();
+  /// \brief Generates the ion images of all peaks batch-wise and calls fn(mz) with m_Image and m_ImageData set
+  void ForEachPeakIonImage(m2::ImzMLSpectrumImage *image, mitk::Image *mask, const std::function<void(double)> &fn);
   std::tuple<std::vector<double>, std::vector<double>, size_t, size_t> PrepareTumorVectors();
   std::tuple<std::vector<std::tuple<double, bool>>, size_t, size_t> GetLabeledMz();
   void AddToTable(double, double);
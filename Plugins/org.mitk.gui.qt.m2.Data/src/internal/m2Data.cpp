@@ -57,6 +57,10 @@ void m2Data::CreateQtPartControl(QWidget *parent)
   auto serviceRef = m2::UIUtils::Instance();
   connect(serviceRef, SIGNAL(UpdateImage(qreal, qreal)), this, SLOT(OnGenerateImageData(qreal, qreal)));
 
+  // the prefetches paused by ion image requests continue once the last request returned
+  m_IonImageRequestScheduler.SetIdleCallback(
+    [this]() { QMetaObject::invokeMethod(this, [this]() { this->StartPrefetches(); }, Qt::QueuedConnection); });
+
   connect(m_Controls.btnCreateImage,
           &QAbstractButton::clicked,
           this,
@@ -269,23 +273,85 @@ void m2Data::OnIncreaseTolerance()
 void m2Data::OnCreateNextImage()
 {
   auto center = m_Controls.spnBxMz->value();
-  auto offset = m_Controls.spnBxTol->value();
-  if (m_Controls.rbtnTolPPM->isChecked())
-  {
-    offset = m2::PartPerMillionToFactor(offset) * center;
-  }
-  this->OnGenerateImageData(center + offset, FROM_GUI);
+  this->OnGenerateImageData(center + GuiToTolerance(center), FROM_GUI);
 }
 
 void m2Data::OnCreatePrevImage()
 {
   auto center = m_Controls.spnBxMz->value();
-  auto offset = m_Controls.spnBxTol->value();
+  this->OnGenerateImageData(center - GuiToTolerance(center), FROM_GUI);
+}
+
+double m2Data::GuiToTolerance(double center)
+{
+  auto tol = m_Controls.spnBxTol->value();
   if (m_Controls.rbtnTolPPM->isChecked())
   {
-    offset = m2::PartPerMillionToFactor(offset) * center;
+    tol = m2::PartPerMillionToFactor(tol) * center;
+  }
+  return tol;
+}
+
+std::vector<m2::IonImageRange> m2Data::GetPrefetchRanges(const m2::SpectrumImageBase *data)
+{
+  const auto center = m_Controls.spnBxMz->value();
+  const auto &peaks = data->GetPeaks();
+  std::vector<double> centers;
+  if (peaks.empty())
+  {
+    const auto offset = GuiToTolerance(center);
+    centers = {center + offset, center - offset};
+  }
+  else
+  {
+    // nearest peak above and below the current center
+    const m2::Peak *next = nullptr;
+    const m2::Peak *prev = nullptr;
+    for (const auto &peak : peaks)
+    {
+      if (peak.GetX() > center && (!next || peak.GetX() < next->GetX()))
+        next = &peak;
+      if (peak.GetX() < center && (!prev || peak.GetX() > prev->GetX()))
+        prev = &peak;
+    }
+    if (next)
+      centers.push_back(next->GetX());
+    if (prev)
+      centers.push_back(prev->GetX());
+  }
+
+  std::vector<m2::IonImageRange> ranges;
+  for (auto c : centers)
+    if (c >= data->GetPropertyValue<double>("x_min") && c <= data->GetPropertyValue<double>("x_max"))
+      ranges.push_back({c, GuiToTolerance(c)});
+  return ranges;
+}
+
+void m2Data::StartPrefetches()
+{
+  if (m_NumberOfNewNodeRequests > 0 || !m_IonImageRequestScheduler.IsIdle())
+    return;
+
+  for (const auto &kv : m_Prefetches)
+  {
+    const auto node = kv.first;
+    const auto prefetch = kv.second;
+    m_IonImagePrefetchScheduler.Submit(node,
+                                       [node, prefetch, this](const m2::CancellationToken &token)
+                                       {
+                                         prefetch->data->PrefetchImages(prefetch->ranges, prefetch->mask, token);
+                                         // not cancelled; a newer prefetch of the node is kept
+                                         QMetaObject::invokeMethod(
+                                           this,
+                                           [node, prefetch, this]()
+                                           {
+                                             auto it = m_Prefetches.find(node);
+                                             if (it != m_Prefetches.end() && it->second == prefetch)
+                                               m_Prefetches.erase(it);
+                                           },
+                                           Qt::QueuedConnection);
+                                       });
   }
-  this->OnGenerateImageData(center - offset, FROM_GUI);
 }
 
 void m2Data::ApplySettingsToNodes(m2Data::NodesVectorType::Pointer v)
@@ -334,9 +400,7 @@ void m2Data::OnGenerateImageData(qreal xRangeCenter, qreal xRangeTol)
 
   if (xRangeTol < 0)
   {
-    xRangeTol = Controls()->spnBxTol->value();
-    bool isPpm = Controls()->rbtnTolPPM->isChecked();
-    xRangeTol = isPpm ? m2::PartPerMillionToFactor(xRangeTol) * xRangeCenter : xRangeTol;
+    xRangeTol = GuiToTolerance(xRangeCenter);
   }
   emit m2::UIUtils::Instance()->RangeChanged(xRangeCenter, xRangeTol);
 
@@ -361,6 +425,13 @@ void m2Data::OnGenerateImageData(qreal xRangeCenter, qreal xRangeTol)
   this->UpdateTextAnnotations(labelText.toStdString());
   this->ApplySettingsToNodes(nodesToProcess);
 
+  const bool initializeNewNode = m_InitializeNewNode;
+  m_InitializeNewNode = false;
+
+  // the prefetches of all nodes would compete with this request for the thread pool; they are kept in
+  // m_Prefetches and continue once no request is left (see StartPrefetches)
+  m_IonImagePrefetchScheduler.CancelAll();
+
   for (mitk::DataNode::Pointer dataNode : *nodesToProcess)
   {
     if (m2::SpectrumImageBase::Pointer data = dynamic_cast<m2::SpectrumImageBase *>(dataNode->GetData()))
@@ -380,19 +451,12 @@ void m2Data::OnGenerateImageData(qreal xRangeCenter, qreal xRangeTol)
       if (maskNode && Controls()->chkBxUseMask->isChecked())
         maskImage = dynamic_cast<mitk::Image *>(maskNode->GetData());
 
-      // The smartpointer will stay alive until all captured copies are relesed. Additional
-      // all connected signals must be disconnected to make sure that the future is not kept
-      // alive after the 'finished-callback' is processed.
-      auto future = std::make_shared<QFutureWatcher<mitk::Image::Pointer>>();
-
       //*************** Worker Finished Callback ******************//
-      // capture holds a copy of the smartpointer, so it will stay alive. Make the lambda mutable to
-      // allow the manipulation of captured varaibles that are copied by '='.
-      const auto futureFinished = [future, dataNode, nodesToProcess, labelText, this]() mutable
+      // runs in the GUI thread; the captured smartpointers keep the node and the image alive
+      const auto finished =
+        [dataNode, data, maskImage, labelText, xRangeCenter, xRangeTol, this](mitk::Image::Pointer image, bool newNode)
       {
-        auto image = future->result();
-
-        if (m_InitializeNewNode)
+        if (newNode)
         {
           auto newImage = OnApplyCastImage(image);
           auto dataNodeNew = mitk::DataNode::New();
@@ -407,43 +471,80 @@ void m2Data::OnGenerateImageData(qreal xRangeCenter, qreal xRangeTol)
         }
         else
         {
+          // the image generation does not touch the range properties, concurrent requests would race
+          data->SetCurrentIonImageRange(xRangeCenter, xRangeTol);
           UpdateLevelWindow(dataNode);
           UpdateSpectrumImageTable(dataNode);
           dataNode->SetProperty("x_range_center", image->GetProperty("x_range_center"));
           dataNode->SetProperty("x_range_tol", image->GetProperty("x_range_tol"));
           this->RequestRenderWindowUpdate();
-        }
-
-        m_InitializeNewNode = false;
-        future->disconnect();
-      };
 
-      //*************** Worker Block******************//
-      const auto futureWorker = [xRangeCenter, xRangeTol, data, maskImage, this]()
-      {
-        // m2::Timer t("Create image @[" + std::to_string(xRangeCenter) + " " + std::to_string(xRangeTol) + "]");
-        if (m_InitializeNewNode)
-        {
-          auto geom = data->GetGeometry()->Clone();
-          auto image = mitk::Image::New();
-          image->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *geom);
-          data->GetImage(xRangeCenter, xRangeTol, maskImage, image);
-          return image;
-        }
-        else
-        {
-          data->GetImage(xRangeCenter, xRangeTol, maskImage, data);
-          mitk::Image::Pointer imagePtr = data.GetPointer();
-          return imagePtr;
+          // Precompute the images that are likely requested next while no ion image is requested (see
+          // StartPrefetches), so the prefetch only uses the shared thread pool if nothing else is requested.
+          const auto ranges = GetPrefetchRanges(data);
+          if (ranges.empty())
+            m_Prefetches.erase(dataNode.GetPointer());
+          else
+            m_Prefetches[dataNode.GetPointer()] = std::make_shared<Prefetch>(Prefetch{data, maskImage, ranges});
+          StartPrefetches();
         }
       };
 
-      //*************** Start Worker ******************//
-
-      connect(future.get(), &QFutureWatcher<mitk::Image::Pointer>::finished, future.get(), futureFinished);
-      future->setFuture(QtConcurrent::run(&m_pool, futureWorker));
+      if (initializeNewNode)
+      {
+        // every request creates its own node and is never superseded
+        auto future = std::make_shared<QFutureWatcher<mitk::Image::Pointer>>();
+        connect(future.get(),
+                &QFutureWatcher<mitk::Image::Pointer>::finished,
+                future.get(),
+                [future, finished, this]() mutable
+                {
+                  finished(future->result(), true);
+                  future->disconnect();
+                  --m_NumberOfNewNodeRequests;
+                  StartPrefetches();
+                });
+        ++m_NumberOfNewNodeRequests;
+        future->setFuture(QtConcurrent::run(&m_pool,
+                                            [xRangeCenter, xRangeTol, data, maskImage]()
+                                            {
+                                              auto geom = data->GetGeometry()->Clone();
+                                              auto image = mitk::Image::New();
+                                              image->Initialize(
+                                                mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *geom);
+                                              data->GetCachedImage(xRangeCenter, xRangeTol, maskImage, image);
+                                              return image;
+                                            }));
+      }
+      else
+      {
+        //*************** Worker Block******************//
+        // Only the latest request of a node is generated: a new request cancels the running one between pixel
+        // blocks and replaces requests that did not start yet (e.g. while scrolling through the spectrum).
+        m_IonImageRequestScheduler.Submit(
+          dataNode.GetPointer(),
+          [xRangeCenter, xRangeTol, data, maskImage, finished, this](const m2::CancellationToken &token)
+          {
+            // large images are generated coarse-to-fine, every refinement is rendered
+            const auto onRefinement = [token, this](unsigned int, unsigned int)
+            {
+              if (!token.IsCancelled())
+                QMetaObject::invokeMethod(
+                  this, [this]() { this->RequestRenderWindowUpdate(); }, Qt::QueuedConnection);
+            };
+            data->GetCachedImage(xRangeCenter, xRangeTol, maskImage, data, token, onRefinement);
+            if (token.IsCancelled())
+              return;
+            mitk::Image::Pointer image = data.GetPointer();
+            QMetaObject::invokeMethod(
+              this, [finished, image]() { finished(image, false); }, Qt::QueuedConnection);
+          });
+      }
     }
   }
+
+  // continues the prefetches if no request was submitted
+  StartPrefetches();
 }
 
 void m2Data::UpdateSpectrumImageTable(const mitk::DataNode *node)
@@ -778,6 +879,9 @@ void m2Data::NodeRemoved(const mitk::DataNode *node)
 {
   if (dynamic_cast<m2::SpectrumImageBase *>(node->GetData()))
   {
+    m_IonImageRequestScheduler.Remove(node);
+    m_IonImagePrefetchScheduler.Remove(node);
+    m_Prefetches.erase(node);
     auto derivations = this->GetDataStorage()->GetDerivations(node);
     for (auto &&d : *derivations)
     {
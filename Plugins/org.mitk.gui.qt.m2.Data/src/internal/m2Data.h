@@ -17,6 +17,8 @@ See LICENSE.txt or https://www.github.com/jtfcordes/m2aia for details.
 #pragma once
 #include "ui_m2Data.h"
 
+#include <map>
+#include <memory>
 #include <regex>
 
 #include <QThreadPool>
@@ -29,6 +31,7 @@ See LICENSE.txt or https://www.github.com/jtfcordes/m2aia for details.
 #include <itkVectorContainer.h>
 #include <m2UIUtils.h>
 #include <m2ImzMLSpectrumImage.h>
+#include <m2IonImageRequestScheduler.h>
 #include <m2SpectrumImageBase.h>
 #include <mitkColorBarAnnotation.h>
 #include <mitkColorSequenceRainbow.h>
@@ -103,6 +106,22 @@ public:
   m2::SmoothingType GuiToSmoothingStrategyType();  
   m2::BaselineCorrectionType GuiToBaselineCorrectionStrategyType();
 
+  /**
+   * @brief The tolerance set in the GUI (Da or ppm) in Da for the given center.
+   */
+  double GuiToTolerance(double center);
+
+  /**
+   * @brief Ranges that are likely requested next: the neighbouring peaks of the current center if data has a peak
+   * list, otherwise the neighbouring windows reached by OnCreateNextImage/OnCreatePrevImage.
+   */
+  std::vector<m2::IonImageRange> GetPrefetchRanges(const m2::SpectrumImageBase *data);
+
+  /**
+   * @brief Submits the prefetches of all nodes (see m_Prefetches) unless an ion image request is running or waiting.
+   */
+  void StartPrefetches();
+
 public slots:
   void OnCreateNextImage();
   void OnCreatePrevImage();
@@ -146,6 +165,18 @@ protected:
   bool m_InitializeNewNode = false;
 
   QThreadPool m_pool;
+  m2::IonImageRequestScheduler m_IonImageRequestScheduler;
+  m2::IonImageRequestScheduler m_IonImagePrefetchScheduler;
+
+  struct Prefetch
+  {
+    m2::SpectrumImageBase::Pointer data;
+    mitk::Image::Pointer mask;
+    std::vector<m2::IonImageRange> ranges;
+  };
+  // latest prefetch of each node until it completed; ion image requests cancel all of them
+  std::map<const mitk::DataNode *, std::shared_ptr<Prefetch>> m_Prefetches;
+  unsigned int m_NumberOfNewNodeRequests = 0;
   m2::SpectrumType m_CurrentOverviewSpectrumType = m2::SpectrumType::Maximum;
 
   // m2::IonImageReference::Pointer m_IonImageReference;
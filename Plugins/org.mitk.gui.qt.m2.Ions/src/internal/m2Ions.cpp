@@ -101,33 +101,43 @@ void m2Ions::UpdateImageList(m2::UIUtils::NodesVectorType::Pointer nodes)
   table->setRowCount(tableRefs.size());
   unsigned tableRowPosition = 0;
 
-  m_TableIndexToIonImageRefMap.clear();
-  for (auto *ref : tableRefs)
+  for (auto node : *nodes)
   {
-    m_TableIndexToIonImageRefMap[tableRowPosition] = ref;
-    for (auto node : *nodes)
+    auto msImage = dynamic_cast<m2::SpectrumImageBase *>(node->GetData());
+    auto &ionImages = m_ContainerMap[node.GetPointer()];
+    auto &ionReferences = msImage->GetIonImageReferenceVector();
+    auto geom = msImage->GetGeometry()->Clone();
+
+    std::vector<m2::IonImageRange> ranges;
+    std::vector<mitk::Image *> outputs;
+    for (auto *ref : tableRefs)
     {
-      auto msImage = dynamic_cast<m2::SpectrumImageBase *>(node->GetData());
-      auto &ionImages = m_ContainerMap[node.GetPointer()];
-      auto &ionReferences = msImage->GetIonImageReferenceVector();
-
       // check if the ref is associated to MS image ion referenes
-      if (std::find(std::begin(ionReferences), std::end(ionReferences), ref) != std::end(ionReferences))
+      if (std::find(std::begin(ionReferences), std::end(ionReferences), ref) == std::end(ionReferences))
+        continue;
+
+      // pre grab the image if it not already exist in the m_Container map
+      // TODO: garbage collection missing
+      if (ionImages[ref].IsNull())
       {
-        // pre grab the image if it not already exist in the m_Container map
-        // TODO: garbage collection missing
-        if (ionImages[ref].IsNull())
-        {
-          auto geom = msImage->GetGeometry()->Clone();
-          auto maskImage = msImage->GetMaskImage();
-          mitk::Image::Pointer ionImage = mitk::Image::New();
-          ionImage->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *geom);
-          msImage->GetImage(ref->mz, ref->tol, maskImage, ionImage);
-          ionImages[ref] = ionImage;
-        }
+        mitk::Image::Pointer ionImage = mitk::Image::New();
+        ionImage->Initialize(mitk::MakeScalarPixelType<m2::DisplayImagePixelType>(), *geom);
+        ionImages[ref] = ionImage;
+        ranges.push_back({ref->mz, ref->tol});
+        outputs.push_back(ionImage);
       }
     }
 
+    // all missing ion images of this node are generated in a single pass
+    if (!ranges.empty())
+      msImage->GetImages(ranges, msImage->GetMaskImage(), outputs);
+  }
+
+  m_TableIndexToIonImageRefMap.clear();
+  for (auto *ref : tableRefs)
+  {
+    m_TableIndexToIonImageRefMap[tableRowPosition] = ref;
+
     auto rangeWidget = new ctkRangeWidget(table);
     rangeWidget->setRange(0, 100);
     table->setCellWidget(tableRowPosition, 2, rangeWidget);
@@ -224,6 +224,8 @@ void m2PeakPickingView::OnStartPCA()
       const auto &peakList = m_PeakList;
 
       std::vector<mitk::Image::Pointer> temporaryImages;
+      std::vector<mitk::Image *> outputImages;
+      std::vector<m2::IonImageRange> ranges;
 
       size_t inputIdx = 0;
       for (size_t row = 0; row < peakList.size(); ++row)
@@ -233,15 +235,16 @@ void m2PeakPickingView::OnStartPCA()
 
         temporaryImages.push_back(mitk::Image::New());
         temporaryImages.back()->Initialize(imageBase);
+        outputImages.push_back(temporaryImages.back());
+        ranges.push_back({peakList[row].GetX(), imageBase->ApplyTolerance(peakList[row].GetX())});
 
-        imageBase->GetImage(peakList[row].GetX(),
-                            imageBase->ApplyTolerance(peakList[row].GetX()),
-                            imageBase->GetMaskImage(),
-                            temporaryImages.back());
         filter->SetInput(inputIdx, temporaryImages.back());
         ++inputIdx;
       }
 
+      // all ion images are generated in a single pass
+      imageBase->GetImages(ranges, imageBase->GetMaskImage(), outputImages);
+
       if (temporaryImages.size() == 0)
       {
         QMessageBox::warning(nullptr,
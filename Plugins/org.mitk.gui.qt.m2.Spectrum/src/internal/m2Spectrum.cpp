@@ -170,12 +170,13 @@ void m2Spectrum::OnPropertyChanged(const itk::Object *caller, const itk::EventOb
         if (specImage->GetSpectrumType().Format == m2::SpectrumFormat::ContinuousProfile)
         {
           auto id = std::stoul(idString);
-          std::vector<double> ys;
-          specImage->GetYValues(id, ys);
+          // the spectrum cache avoids reprocessing when moving between the same pixels
+          const auto spectrum = specImage->GetCachedSpectrum(id);
+          const auto &ys = spectrum->ys;
           auto &provider = m_DataProvider[node];
           QtCharts::QXYSeries *series;
           series = provider->GetGroupSeries("SingleSpectrum");
-          const auto &xs = specImage->GetXAxis();
+          const auto &xs = spectrum->xs;
 
           MITK_INFO << "Provide Data " << xs.size() << " " << ys.size();
           QVector<QPointF> seriesData;